@@ -0,0 +1,86 @@
+#include <cstdlib>
+#include <iomanip>
+#include <mutex>
+#include <cxxabi.h>
+#include "arena.hpp"
+
+namespace cminusminus{
+
+/* Demangled names of every type ever allocated from any arena,
+   indexed by Arena::kindIndex<T>() */
+static std::vector<std::string>& kindNames(){
+	static std::vector<std::string> names;
+	return names;
+}
+
+/* Guards kindNames(): arenas on different threads may meet a 
+   new kind at once, or read the names while another adds one */
+static std::mutex& kindLock(){
+	static std::mutex lock;
+	return lock;
+}
+
+size_t Arena::registerKind(const char * mangledName){
+	std::lock_guard<std::mutex> guard(kindLock());
+	int status = 0;
+	char * demangled = abi::__cxa_demangle(mangledName, nullptr,
+		nullptr, &status);
+	if (status == 0 && demangled != nullptr){
+		kindNames().push_back(demangled);
+	} else {
+		kindNames().push_back(mangledName);
+	}
+	std::free(demangled);
+	return kindNames().size() - 1;
+}
+
+Arena::Arena(size_t chunkSizeIn)
+: myChunkSize(chunkSizeIn), myCur(nullptr), myEnd(nullptr),
+  myReserved(0), myUsed(0){
+}
+
+Arena::~Arena(){
+	for (auto it = myDtors.rbegin(); it != myDtors.rend(); ++it){
+		it->second(it->first);
+	}
+	for (auto chunk : myChunks){
+		delete [] chunk;
+	}
+}
+
+void * Arena::allocateSlow(size_t size, size_t align){
+	size_t need = size + align;
+	size_t chunkSize = need > myChunkSize ? need : myChunkSize;
+	char * chunk = new char[chunkSize];
+	myChunks.push_back(chunk);
+	myReserved += chunkSize;
+	myCur = chunk;
+	myEnd = chunk + chunkSize;
+	return allocate(size, align);
+}
+
+std::vector<Arena::KindUsage> Arena::kinds() const{
+	std::vector<KindUsage> used;
+	std::lock_guard<std::mutex> guard(kindLock());
+	for (size_t i = 0; i < myStats.size(); i++){
+		if (myStats[i].count == 0){ continue; }
+		used.push_back({kindNames()[i], myStats[i].count, myStats[i].bytes});
+	}
+	return used;
+}
+
+void Arena::report(std::ostream& out) const{
+	out << "Arena: " << myChunks.size() << " chunks, "
+	  << myReserved << " bytes reserved, "
+	  << myUsed << " bytes used\n";
+	out << "  " << std::left << std::setw(32) << "kind"
+	  << std::right << std::setw(12) << "count"
+	  << std::setw(14) << "bytes" << "\n";
+	for (const auto& kind : kinds()){
+		out << "  " << std::left << std::setw(32) << kind.name
+		  << std::right << std::setw(12) << kind.count
+		  << std::setw(14) << kind.bytes << "\n";
+	}
+}
+
+} //End namespace cminusminus
@@ -0,0 +1,111 @@
+#ifndef CMINUSMINUS_ARENA_HPP
+#define CMINUSMINUS_ARENA_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+
+namespace cminusminus{
+
+/**
+* \class Arena
+* Bump-pointer allocator that owns every Token and ASTNode
+* built during one compilation. Objects are carved out
+* of large chunks and are never freed individually: the whole
+* arena (running any non-trivial destructors in reverse order)
+* is released at once when the Arena itself is deleted.
+**/
+class Arena{
+public:
+	Arena(size_t chunkSizeIn = 64 * 1024);
+	~Arena();
+	Arena(const Arena&) = delete;
+	Arena& operator=(const Arena&) = delete;
+
+	template <typename T, typename... Args>
+	T * make(Args&&... args){
+		void * mem = allocate(sizeof(T), alignof(T));
+		T * obj = new (mem) T(std::forward<Args>(args)...);
+		if (!std::is_trivially_destructible<T>::value){
+			myDtors.push_back(Finalizer(obj, &destroy<T>));
+		}
+		record(kindIndex<T>(), sizeof(T));
+		return obj;
+	}
+
+	/** Raw, untyped storage (not counted per kind) **/
+	void * allocate(size_t size, size_t align){
+		uintptr_t cur = reinterpret_cast<uintptr_t>(myCur);
+		uintptr_t aligned = (cur + (align - 1)) & ~(align - 1);
+		if (myCur == nullptr
+		  || aligned + size > reinterpret_cast<uintptr_t>(myEnd)){
+			return allocateSlow(size, align);
+		}
+		myCur = reinterpret_cast<char *>(aligned + size);
+		return reinterpret_cast<void *>(aligned);
+	}
+
+	size_t bytesReserved() const { return myReserved; }
+	size_t bytesUsed() const { return myUsed; }
+
+	/** Write a per-kind summary of everything in the arena **/
+	void report(std::ostream& out) const;
+
+	struct KindUsage{
+		std::string name;
+		size_t count;
+		size_t bytes;
+	};
+	/** The same summary as data: each type allocated here (by
+	 * its demangled name), with how many and how many bytes **/
+	std::vector<KindUsage> kinds() const;
+
+private:
+	typedef void (*Dtor)(void *);
+	typedef std::pair<void *, Dtor> Finalizer;
+	struct KindStats{
+		size_t count;
+		size_t bytes;
+	};
+
+	template <typename T>
+	static void destroy(void * obj){ static_cast<T *>(obj)->~T(); }
+
+	/* Each distinct allocated type gets a small dense index the
+	   first time it is seen, so per-kind stats are a vector
+	   index rather than a map lookup */
+	template <typename T>
+	static size_t kindIndex(){
+		static const size_t idx = registerKind(typeid(T).name());
+		return idx;
+	}
+	static size_t registerKind(const char * mangledName);
+
+	void record(size_t kind, size_t bytes){
+		if (kind >= myStats.size()){ myStats.resize(kind + 1, {0, 0}); }
+		myStats[kind].count++;
+		myStats[kind].bytes += bytes;
+		myUsed += bytes;
+	}
+
+	void * allocateSlow(size_t size, size_t align);
+
+	size_t myChunkSize;
+	char * myCur;
+	char * myEnd;
+	size_t myReserved;
+	size_t myUsed;
+	std::vector<char *> myChunks;
+	std::vector<Finalizer> myDtors;
+	std::vector<KindStats> myStats;
+};
+
+} //End namespace cminusminus
+
+#endif
@@ -1,11 +1,17 @@
 #include "ast.hpp"
 
-cminusminus::ProgramNode::ProgramNode(std::list<DeclNode *> * globalsIn)
-: ASTNode(new Position(0,0,0,0)), myGlobals(globalsIn){
+cminusminus::ProgramNode::ProgramNode(Arena * arenaIn,
+  NodeList<DeclNode> * globalsIn)
+: ASTNode(Position()), myArena(arenaIn),
+  myGlobals(globalsIn){
 	if (!globalsIn->empty()){
-		myPos->expand(
+		myPos.expand(
 			myGlobals->front()->pos(),
 			myGlobals->back()->pos()
 		);
 	}
 }
+
+cminusminus::ProgramNode::~ProgramNode(){
+	delete myArena;
+}
@@ -2,35 +2,106 @@
 #define CMINUSMINUS_AST_HPP
 
 #include <ostream>
-#include <list>
+#include <cstring>
 #include "tokens.hpp"
+#include "arena.hpp"
+#include "astimage.hpp"
+#include "unparsewriter.hpp"
 #include <cassert>
 
-
-/* You absolutely will need to add a bunch of ASTNode subclasses */
-
 namespace cminusminus{
 
-/* You may find it useful to forward declare AST subclasses
-   here so that you can use a class before it's full definition
-*/
+/* Forward declarations, so that the classes below can refer
+   to one another before their full definitions */
+class DataType;
 class DeclNode;
 class TypeNode;
 class StmtNode;
+class ExpNode;
 class IDNode;
+class IRBuilder;
+class Opd;
+class SemSymbol;
+class SymbolIndex;
+class SymbolTable;
+class TypeAnalysis;
+
+/**
+* \class NodeList
+* A list of child nodes (globals, statements, formals, ...) as
+* one contiguous array of pointers carved out of the Arena. The
+* grammar appends to it as a list rule is reduced; when it fills
+* up it moves to an array twice the size, leaving the old one
+* in the arena. Walking a list is a linear scan rather than a 
+* chain of separately allocated links.
+**/
+template <typename T>
+class NodeList{
+public:
+	NodeList(Arena * arenaIn)
+	: myArena(arenaIn), myItems(nullptr), mySize(0), myCap(0){ }
+	void push_back(T * item){
+		if (mySize == myCap){ grow(myCap == 0 ? 4 : myCap * 2); }
+		myItems[mySize++] = item;
+	}
+	/** Make room for n items in all, when that is known ahead **/
+	void reserve(size_t n){
+		if (n > myCap){ grow(n); }
+	}
+	size_t size() const { return mySize; }
+	bool empty() const { return mySize == 0; }
+	T * operator[](size_t i) const { return myItems[i]; }
+	T * front() const { return myItems[0]; }
+	T * back() const { return myItems[mySize - 1]; }
+	T * const * begin() const { return myItems; }
+	T * const * end() const { return myItems + mySize; }
+private:
+	void grow(size_t cap){
+		T ** items = static_cast<T **>(
+			myArena->allocate(cap * sizeof(T *), alignof(T *)));
+		if (mySize > 0){
+			std::memcpy(items, myItems, mySize * sizeof(T *));
+		}
+		myItems = items;
+		myCap = cap;
+	}
+	Arena * myArena;
+	T ** myItems;
+	size_t mySize;
+	size_t myCap;
+};
 
 /** 
 * \class ASTNode
-* Base class for all other AST Node types
+* Base class for all other AST Node types.
+* Nodes live in the Arena and are never deleted one at a time,
+* so there is deliberately no virtual destructor: every node 
+* class stays trivially destructible and the arena keeps no 
+* finalizer for it. Nodes hold only pointers, Symbols and 
+* numbers for the same reason.
 **/
 class ASTNode{
 public:
-	ASTNode(Position * p) : myPos(p){ }
-	virtual void unparse(std::ostream& out, int indent) = 0;
-	Position * pos() { return myPos; }
-	std::string posStr() { return pos()->span(); }
+	ASTNode(const Position& p) : myPos(p){ }
+	virtual void unparse(UnparseWriter& out, int indent) = 0;
+	/** Add this subtree to an AST image; returns its NodeRef **/
+	virtual NodeRef flatten(AstImageWriter& image) const = 0;
+	/** Move this subtree lines lines down the file (up if lines
+	 * is negative), after an edit above it **/
+	virtual void shiftLines(long lines){ myPos.shiftLines(lines); }
+	/** Add the names in this subtree to index **/
+	virtual void index(SymbolIndex& index) const { }
+	/** Resolve the names in this subtree against symTab,
+	 * reporting any that are undeclared or declared twice.
+	 * Returns false if there were any such errors **/
+	virtual bool nameAnalysis(SymbolTable * symTab){ return true; }
+	/** Check the types in this subtree (after name analysis),
+	 * reporting errors through ta **/
+	virtual void typeAnalysis(TypeAnalysis * ta){ }
+	const Position& pos() const { return myPos; }
+	std::string posStr() const { return myPos.span(); }
 protected:
-	Position * myPos;
+	Position myPos;
 };
 
 /** 
@@ -38,20 +109,44 @@ protected:
 * Class that contains the entire abstract syntax tree for a program.
 * Note the list of declarations encompasses all global declarations
 * which includes (obviously) all global variables and struct declarations
-* and (perhaps less obviously), all function declarations
+* and (perhaps less obviously), all function declarations.
+* The ProgramNode takes ownership of the arena that holds every
+* other node (and token) of the tree, so deleting the ProgramNode
+* releases the whole compilation's memory at once.
 **/
-class ProgramNode : public ASTNode{
+class ProgramNode final : public ASTNode{
 public:
-	ProgramNode(std::list<DeclNode *> * globalsIn) ;
-	void unparse(std::ostream& out, int indent) override;
+	ProgramNode(Arena * arenaIn, NodeList<DeclNode> * globalsIn);
+	~ProgramNode();
+	void unparse(UnparseWriter& out, int indent) override;
+	NodeRef flatten(AstImageWriter& image) const override;
+	void shiftLines(long lines) override;
+	void index(SymbolIndex& index) const override;
+	bool nameAnalysis(SymbolTable * symTab) override;
+	void typeAnalysis(TypeAnalysis * ta) override;
+	/** Lower the whole program into ir's IRProgram **/
+	void lower(IRBuilder& ir);
+	Arena * arena() const { return myArena; }
+	/** Give up ownership of the arena, which the caller must
+	 * now delete (after this node) **/
+	Arena * releaseArena(){
+		Arena * arena = myArena;
+		myArena = nullptr;
+		return arena;
+	}
+	NodeList<DeclNode> * globals() const { return myGlobals; }
 private:
-	std::list<DeclNode * > * myGlobals;
+	Arena * myArena;
+	NodeList<DeclNode> * myGlobals;
 };
 
 class StmtNode : public ASTNode{
 public:
-	StmtNode(Position * p) : ASTNode(p){ }
-	void unparse(std::ostream& out, int indent) override = 0;
+	StmtNode(const Position& p) : ASTNode(p){ }
+	void unparse(UnparseWriter& out, int indent) override = 0;
+	/** Lower this statement (after type analysis) to three-address
+	 * code at the end of what ir is building **/
+	virtual void lower(IRBuilder& ir) = 0;
 };
 
 
@@ -61,8 +156,8 @@ public:
 **/
 class DeclNode : public StmtNode{
 public:
-	DeclNode(Position * p) : StmtNode(p) { }
-	void unparse(std::ostream& out, int indent) override = 0;
+	DeclNode(const Position& p) : StmtNode(p) { }
+	void unparse(UnparseWriter& out, int indent) override = 0;
 };
 
 /**  \class ExpNode
@@ -71,8 +166,15 @@ public:
 * should inherit from this abstract superclass.
 **/
 class ExpNode : public ASTNode{
+public:
+	/** The type typeAnalysis found (nullptr before it runs) **/
+	const DataType * getDataType() const { return myDataType; }
+	/** Lower this expression to three-address code that works
+	 * out its value; returns the operand that holds it **/
+	virtual Opd lower(IRBuilder& ir) = 0;
 protected:
-	ExpNode(Position * p) : ASTNode(p){ }
+	ExpNode(const Position& p) : ASTNode(p){ }
+	const DataType * myDataType = nullptr;
 };
 
 /**  \class TypeNode
@@ -82,16 +184,21 @@ protected:
 **/
 class TypeNode : public ASTNode{
 protected:
-	TypeNode(Position * p) : ASTNode(p){
+	TypeNode(const Position& p) : ASTNode(p){
 	}
 public:
-	virtual void unparse(std::ostream& out, int indent) = 0;
+	virtual void unparse(UnparseWriter& out, int indent) = 0;
+	/** The type this names **/
+	virtual const DataType * getDataType() const = 0;
 };
 
 class LValNode : public ExpNode{
 public:
-	LValNode(Position * p) : ExpNode(p){}
-	void unparse(std::ostream& out, int indent) override = 0;
+	LValNode(const Position& p) : ExpNode(p){}
+	void unparse(UnparseWriter& out, int indent) override = 0;
+	/** Lower storing src here; returns an operand holding the
+	 * value stored **/
+	virtual Opd lowerStore(IRBuilder& ir, Opd src) = 0;
 };
 
 /** An identifier. Note that IDNodes subclass
@@ -99,12 +206,23 @@ public:
 **/
 class IDNode : public LValNode{
 public:
-	IDNode(Position * p, std::string nameIn) 
+	IDNode(const Position& p, Symbol nameIn) 
 	: LValNode(p), name(nameIn){ }
-	void unparse(std::ostream& out, int indent);
+	void unparse(UnparseWriter& out, int indent);
+	NodeRef flatten(AstImageWriter& image) const override;
+	void index(SymbolIndex& index) const override;
+	bool nameAnalysis(SymbolTable * symTab) override;
+	void typeAnalysis(TypeAnalysis * ta) override;
+	Opd lower(IRBuilder& ir) override;
+	Opd lowerStore(IRBuilder& ir, Opd src) override;
+	Symbol getName() const { return name; }
+	/** The declaration name analysis found for this name **/
+	void attachSymbol(SemSymbol * symbolIn){ mySymbol = symbolIn; }
+	SemSymbol * getSymbol() const { return mySymbol; }
 private:
-	/** The name of the identifier **/
-	std::string name;
+	/** The (interned) name of the identifier **/
+	Symbol name;
+	SemSymbol * mySymbol = nullptr;
 };
 
  
@@ -112,21 +230,567 @@ private:
 **/
 class VarDeclNode : public DeclNode{
 public:
-	VarDeclNode(Position * p, TypeNode * type, IDNode * id) 
+	VarDeclNode(const Position& p, TypeNode * type, IDNode * id) 
 	: DeclNode(p), myType(type), myId(id){
 		assert (myType != nullptr);
 		assert (myId != nullptr);
 	}
-	void unparse(std::ostream& out, int indent);
-private:
+	void unparse(UnparseWriter& out, int indent);
+	NodeRef flatten(AstImageWriter& image) const override;
+	void shiftLines(long lines) override;
+	void index(SymbolIndex& index) const override;
+	bool nameAnalysis(SymbolTable * symTab) override;
+	void lower(IRBuilder& ir) override;
+	TypeNode * getType() const { return myType; }
+	IDNode * getId() const { return myId; }
+protected:
 	TypeNode * myType;
 	IDNode * myId;
 };
 
 class IntTypeNode : public TypeNode{
 public:
-	IntTypeNode(Position * p) : TypeNode(p){ }
-	void unparse(std::ostream& out, int indent);
+	IntTypeNode(const Position& p) : TypeNode(p){ }
+	void unparse(UnparseWriter& out, int indent);
+	const DataType * getDataType() const override;
+	NodeRef flatten(AstImageWriter& image) const override;
+};
+
+class BoolTypeNode : public TypeNode{
+public:
+	BoolTypeNode(const Position& p) : TypeNode(p){ }
+	void unparse(UnparseWriter& out, int indent);
+	const DataType * getDataType() const override;
+	NodeRef flatten(AstImageWriter& image) const override;
+};
+
+class ShortTypeNode : public TypeNode{
+public:
+	ShortTypeNode(const Position& p) : TypeNode(p){ }
+	void unparse(UnparseWriter& out, int indent);
+	const DataType * getDataType() const override;
+	NodeRef flatten(AstImageWriter& image) const override;
+};
+
+class StringTypeNode : public TypeNode{
+public:
+	StringTypeNode(const Position& p) : TypeNode(p){ }
+	void unparse(UnparseWriter& out, int indent);
+	const DataType * getDataType() const override;
+	NodeRef flatten(AstImageWriter& image) const override;
+};
+
+class VoidTypeNode : public TypeNode{
+public:
+	VoidTypeNode(const Position& p) : TypeNode(p){ }
+	void unparse(UnparseWriter& out, int indent);
+	const DataType * getDataType() const override;
+	NodeRef flatten(AstImageWriter& image) const override;
+};
+
+/** A pointer type, e.g. the "ptr int" in "ptr int p;" **/
+class PtrTypeNode : public TypeNode{
+public:
+	PtrTypeNode(const Position& p, TypeNode * baseIn)
+	: TypeNode(p), myBase(baseIn){ }
+	void unparse(UnparseWriter& out, int indent);
+	const DataType * getDataType() const override;
+	NodeRef flatten(AstImageWriter& image) const override;
+	void shiftLines(long lines) override;
+private:
+	TypeNode * myBase;
+};
+
+/** A formal parameter. It is a variable declaration that is
+ * unparsed without the trailing semicolon.
+**/
+class FormalDeclNode : public VarDeclNode{
+public:
+	FormalDeclNode(const Position& p, TypeNode * type, IDNode * id)
+	: VarDeclNode(p, type, id){ }
+	void unparse(UnparseWriter& out, int indent);
+	NodeRef flatten(AstImageWriter& image) const override;
+	void index(SymbolIndex& index) const override;
+};
+
+class FnDeclNode : public DeclNode{
+public:
+	FnDeclNode(const Position& p, TypeNode * retTypeIn, IDNode * idIn,
+	  NodeList<FormalDeclNode> * formalsIn, NodeList<StmtNode> * bodyIn)
+	: DeclNode(p), myRetType(retTypeIn), myId(idIn),
+	  myFormals(formalsIn), myBody(bodyIn){ }
+	void unparse(UnparseWriter& out, int indent);
+	NodeRef flatten(AstImageWriter& image) const override;
+	void shiftLines(long lines) override;
+	void index(SymbolIndex& index) const override;
+	bool nameAnalysis(SymbolTable * symTab) override;
+	void typeAnalysis(TypeAnalysis * ta) override;
+	void lower(IRBuilder& ir) override;
+private:
+	TypeNode * myRetType;
+	IDNode * myId;
+	NodeList<FormalDeclNode> * myFormals;
+	NodeList<StmtNode> * myBody;
+};
+
+/** A dereference, e.g. "@p" **/
+class DerefNode : public LValNode{
+public:
+	DerefNode(const Position& p, IDNode * idIn)
+	: LValNode(p), myId(idIn){ }
+	void unparse(UnparseWriter& out, int indent);
+	NodeRef flatten(AstImageWriter& image) const override;
+	void shiftLines(long lines) override;
+	void index(SymbolIndex& index) const override;
+	bool nameAnalysis(SymbolTable * symTab) override;
+	void typeAnalysis(TypeAnalysis * ta) override;
+	Opd lower(IRBuilder& ir) override;
+	Opd lowerStore(IRBuilder& ir, Opd src) override;
+private:
+	IDNode * myId;
+};
+
+/** Taking an address, e.g. "&a" **/
+class RefNode : public ExpNode{
+public:
+	RefNode(const Position& p, IDNode * idIn)
+	: ExpNode(p), myId(idIn){ }
+	void unparse(UnparseWriter& out, int indent);
+	NodeRef flatten(AstImageWriter& image) const override;
+	void shiftLines(long lines) override;
+	void index(SymbolIndex& index) const override;
+	bool nameAnalysis(SymbolTable * symTab) override;
+	void typeAnalysis(TypeAnalysis * ta) override;
+	Opd lower(IRBuilder& ir) override;
+private:
+	IDNode * myId;
+};
+
+class IntLitNode : public ExpNode{
+public:
+	IntLitNode(const Position& p, int numIn)
+	: ExpNode(p), myNum(numIn){ }
+	void unparse(UnparseWriter& out, int indent);
+	NodeRef flatten(AstImageWriter& image) const override;
+	void typeAnalysis(TypeAnalysis * ta) override;
+	Opd lower(IRBuilder& ir) override;
+private:
+	int myNum;
+};
+
+class ShortLitNode : public ExpNode{
+public:
+	ShortLitNode(const Position& p, int numIn)
+	: ExpNode(p), myNum(numIn){ }
+	void unparse(UnparseWriter& out, int indent);
+	NodeRef flatten(AstImageWriter& image) const override;
+	void typeAnalysis(TypeAnalysis * ta) override;
+	Opd lower(IRBuilder& ir) override;
+private:
+	int myNum;
+};
+
+/** A string literal. The text (quotes and escapes included)
+ * belongs to the StrToken, which lives in the same arena as
+ * the node, so the node only points at it.
+**/
+class StrLitNode : public ExpNode{
+public:
+	StrLitNode(const Position& p, const std::string * strIn)
+	: ExpNode(p), myStr(strIn){ }
+	void unparse(UnparseWriter& out, int indent);
+	NodeRef flatten(AstImageWriter& image) const override;
+	void typeAnalysis(TypeAnalysis * ta) override;
+	Opd lower(IRBuilder& ir) override;
+private:
+	const std::string * myStr;
+};
+
+class TrueNode : public ExpNode{
+public:
+	TrueNode(const Position& p) : ExpNode(p){ }
+	void unparse(UnparseWriter& out, int indent);
+	NodeRef flatten(AstImageWriter& image) const override;
+	void typeAnalysis(TypeAnalysis * ta) override;
+	Opd lower(IRBuilder& ir) override;
+};
+
+class FalseNode : public ExpNode{
+public:
+	FalseNode(const Position& p) : ExpNode(p){ }
+	void unparse(UnparseWriter& out, int indent);
+	NodeRef flatten(AstImageWriter& image) const override;
+	void typeAnalysis(TypeAnalysis * ta) override;
+	Opd lower(IRBuilder& ir) override;
+};
+
+/** An assignment used as an expression. Unparsed in
+ * parentheses, except as the whole of an assignment statement
+**/
+class AssignExpNode : public ExpNode{
+public:
+	AssignExpNode(const Position& p, LValNode * dstIn, ExpNode * srcIn)
+	: ExpNode(p), myDst(dstIn), mySrc(srcIn){ }
+	void unparse(UnparseWriter& out, int indent);
+	/** The assignment without the enclosing parentheses **/
+	void unparseBare(UnparseWriter& out);
+	NodeRef flatten(AstImageWriter& image) const override;
+	void shiftLines(long lines) override;
+	void index(SymbolIndex& index) const override;
+	bool nameAnalysis(SymbolTable * symTab) override;
+	void typeAnalysis(TypeAnalysis * ta) override;
+	Opd lower(IRBuilder& ir) override;
+private:
+	LValNode * myDst;
+	ExpNode * mySrc;
+};
+
+class CallExpNode : public ExpNode{
+public:
+	CallExpNode(const Position& p, IDNode * idIn,
+	  NodeList<ExpNode> * argsIn)
+	: ExpNode(p), myId(idIn), myArgs(argsIn){ }
+	void unparse(UnparseWriter& out, int indent);
+	NodeRef flatten(AstImageWriter& image) const override;
+	void shiftLines(long lines) override;
+	void index(SymbolIndex& index) const override;
+	bool nameAnalysis(SymbolTable * symTab) override;
+	void typeAnalysis(TypeAnalysis * ta) override;
+	Opd lower(IRBuilder& ir) override;
+private:
+	IDNode * myId;
+	NodeList<ExpNode> * myArgs;
+};
+
+/** \class BinaryExpNode
+* Superclass of the binary operators. The subclasses only name
+* their operator (for unparse) and their AST image kind, so
+* they add nothing to the size of a node.
+**/
+class BinaryExpNode : public ExpNode{
+public:
+	void unparse(UnparseWriter& out, int indent) override;
+	NodeRef flatten(AstImageWriter& image) const override;
+	void shiftLines(long lines) override;
+	void index(SymbolIndex& index) const override;
+	bool nameAnalysis(SymbolTable * symTab) override;
+	void typeAnalysis(TypeAnalysis * ta) override;
+	Opd lower(IRBuilder& ir) override;
+protected:
+	BinaryExpNode(const Position& p, ExpNode * lhsIn, ExpNode * rhsIn)
+	: ExpNode(p), myLhs(lhsIn), myRhs(rhsIn){ }
+	virtual const char * opStr() const = 0;
+	virtual AstKind imageKind() const = 0;
+private:
+	ExpNode * myLhs;
+	ExpNode * myRhs;
+};
+
+class PlusNode : public BinaryExpNode{
+public:
+	PlusNode(const Position& p, ExpNode * lhs, ExpNode * rhs)
+	: BinaryExpNode(p, lhs, rhs){ }
+protected:
+	const char * opStr() const override { return "+"; }
+	AstKind imageKind() const override { return AST_PLUS; }
+};
+
+class MinusNode : public BinaryExpNode{
+public:
+	MinusNode(const Position& p, ExpNode * lhs, ExpNode * rhs)
+	: BinaryExpNode(p, lhs, rhs){ }
+protected:
+	const char * opStr() const override { return "-"; }
+	AstKind imageKind() const override { return AST_MINUS; }
+};
+
+class TimesNode : public BinaryExpNode{
+public:
+	TimesNode(const Position& p, ExpNode * lhs, ExpNode * rhs)
+	: BinaryExpNode(p, lhs, rhs){ }
+protected:
+	const char * opStr() const override { return "*"; }
+	AstKind imageKind() const override { return AST_TIMES; }
+};
+
+class DivideNode : public BinaryExpNode{
+public:
+	DivideNode(const Position& p, ExpNode * lhs, ExpNode * rhs)
+	: BinaryExpNode(p, lhs, rhs){ }
+protected:
+	const char * opStr() const override { return "/"; }
+	AstKind imageKind() const override { return AST_DIVIDE; }
+};
+
+class AndNode : public BinaryExpNode{
+public:
+	AndNode(const Position& p, ExpNode * lhs, ExpNode * rhs)
+	: BinaryExpNode(p, lhs, rhs){ }
+protected:
+	const char * opStr() const override { return "and"; }
+	AstKind imageKind() const override { return AST_AND; }
+};
+
+class OrNode : public BinaryExpNode{
+public:
+	OrNode(const Position& p, ExpNode * lhs, ExpNode * rhs)
+	: BinaryExpNode(p, lhs, rhs){ }
+protected:
+	const char * opStr() const override { return "or"; }
+	AstKind imageKind() const override { return AST_OR; }
+};
+
+class EqualsNode : public BinaryExpNode{
+public:
+	EqualsNode(const Position& p, ExpNode * lhs, ExpNode * rhs)
+	: BinaryExpNode(p, lhs, rhs){ }
+protected:
+	const char * opStr() const override { return "=="; }
+	AstKind imageKind() const override { return AST_EQUALS; }
+};
+
+class NotEqualsNode : public BinaryExpNode{
+public:
+	NotEqualsNode(const Position& p, ExpNode * lhs, ExpNode * rhs)
+	: BinaryExpNode(p, lhs, rhs){ }
+protected:
+	const char * opStr() const override { return "!="; }
+	AstKind imageKind() const override { return AST_NOTEQUALS; }
+};
+
+class LessNode : public BinaryExpNode{
+public:
+	LessNode(const Position& p, ExpNode * lhs, ExpNode * rhs)
+	: BinaryExpNode(p, lhs, rhs){ }
+protected:
+	const char * opStr() const override { return "<"; }
+	AstKind imageKind() const override { return AST_LESS; }
+};
+
+class LessEqNode : public BinaryExpNode{
+public:
+	LessEqNode(const Position& p, ExpNode * lhs, ExpNode * rhs)
+	: BinaryExpNode(p, lhs, rhs){ }
+protected:
+	const char * opStr() const override { return "<="; }
+	AstKind imageKind() const override { return AST_LESSEQ; }
+};
+
+class GreaterNode : public BinaryExpNode{
+public:
+	GreaterNode(const Position& p, ExpNode * lhs, ExpNode * rhs)
+	: BinaryExpNode(p, lhs, rhs){ }
+protected:
+	const char * opStr() const override { return ">"; }
+	AstKind imageKind() const override { return AST_GREATER; }
+};
+
+class GreaterEqNode : public BinaryExpNode{
+public:
+	GreaterEqNode(const Position& p, ExpNode * lhs, ExpNode * rhs)
+	: BinaryExpNode(p, lhs, rhs){ }
+protected:
+	const char * opStr() const override { return ">="; }
+	AstKind imageKind() const override { return AST_GREATEREQ; }
+};
+
+/** \class UnaryExpNode
+* Superclass of the unary operators, organized like
+* BinaryExpNode
+**/
+class UnaryExpNode : public ExpNode{
+public:
+	void unparse(UnparseWriter& out, int indent) override;
+	NodeRef flatten(AstImageWriter& image) const override;
+	void shiftLines(long lines) override;
+	void index(SymbolIndex& index) const override;
+	bool nameAnalysis(SymbolTable * symTab) override;
+	void typeAnalysis(TypeAnalysis * ta) override;
+	Opd lower(IRBuilder& ir) override;
+protected:
+	UnaryExpNode(const Position& p, ExpNode * expIn)
+	: ExpNode(p), myExp(expIn){ }
+	virtual const char * opStr() const = 0;
+	virtual AstKind imageKind() const = 0;
+private:
+	ExpNode * myExp;
+};
+
+class NegNode : public UnaryExpNode{
+public:
+	NegNode(const Position& p, ExpNode * exp) : UnaryExpNode(p, exp){ }
+protected:
+	const char * opStr() const override { return "-"; }
+	AstKind imageKind() const override { return AST_NEG; }
+};
+
+class NotNode : public UnaryExpNode{
+public:
+	NotNode(const Position& p, ExpNode * exp) : UnaryExpNode(p, exp){ }
+protected:
+	const char * opStr() const override { return "!"; }
+	AstKind imageKind() const override { return AST_NOT; }
+};
+
+class AssignStmtNode : public StmtNode{
+public:
+	AssignStmtNode(const Position& p, AssignExpNode * expIn)
+	: StmtNode(p), myExp(expIn){ }
+	void unparse(UnparseWriter& out, int indent);
+	NodeRef flatten(AstImageWriter& image) const override;
+	void shiftLines(long lines) override;
+	void index(SymbolIndex& index) const override;
+	bool nameAnalysis(SymbolTable * symTab) override;
+	void typeAnalysis(TypeAnalysis * ta) override;
+	void lower(IRBuilder& ir) override;
+private:
+	AssignExpNode * myExp;
+};
+
+class PostIncStmtNode : public StmtNode{
+public:
+	PostIncStmtNode(const Position& p, LValNode * lvalIn)
+	: StmtNode(p), myLVal(lvalIn){ }
+	void unparse(UnparseWriter& out, int indent);
+	NodeRef flatten(AstImageWriter& image) const override;
+	void shiftLines(long lines) override;
+	void index(SymbolIndex& index) const override;
+	bool nameAnalysis(SymbolTable * symTab) override;
+	void typeAnalysis(TypeAnalysis * ta) override;
+	void lower(IRBuilder& ir) override;
+private:
+	LValNode * myLVal;
+};
+
+class PostDecStmtNode : public StmtNode{
+public:
+	PostDecStmtNode(const Position& p, LValNode * lvalIn)
+	: StmtNode(p), myLVal(lvalIn){ }
+	void unparse(UnparseWriter& out, int indent);
+	NodeRef flatten(AstImageWriter& image) const override;
+	void shiftLines(long lines) override;
+	void index(SymbolIndex& index) const override;
+	bool nameAnalysis(SymbolTable * symTab) override;
+	void typeAnalysis(TypeAnalysis * ta) override;
+	void lower(IRBuilder& ir) override;
+private:
+	LValNode * myLVal;
+};
+
+class ReadStmtNode : public StmtNode{
+public:
+	ReadStmtNode(const Position& p, LValNode * dstIn)
+	: StmtNode(p), myDst(dstIn){ }
+	void unparse(UnparseWriter& out, int indent);
+	NodeRef flatten(AstImageWriter& image) const override;
+	void shiftLines(long lines) override;
+	void index(SymbolIndex& index) const override;
+	bool nameAnalysis(SymbolTable * symTab) override;
+	void typeAnalysis(TypeAnalysis * ta) override;
+	void lower(IRBuilder& ir) override;
+private:
+	LValNode * myDst;
+};
+
+class WriteStmtNode : public StmtNode{
+public:
+	WriteStmtNode(const Position& p, ExpNode * srcIn)
+	: StmtNode(p), mySrc(srcIn){ }
+	void unparse(UnparseWriter& out, int indent);
+	NodeRef flatten(AstImageWriter& image) const override;
+	void shiftLines(long lines) override;
+	void index(SymbolIndex& index) const override;
+	bool nameAnalysis(SymbolTable * symTab) override;
+	void typeAnalysis(TypeAnalysis * ta) override;
+	void lower(IRBuilder& ir) override;
+private:
+	ExpNode * mySrc;
+};
+
+class WhileStmtNode : public StmtNode{
+public:
+	WhileStmtNode(const Position& p, ExpNode * condIn,
+	  NodeList<StmtNode> * bodyIn)
+	: StmtNode(p), myCond(condIn), myBody(bodyIn){ }
+	void unparse(UnparseWriter& out, int indent);
+	NodeRef flatten(AstImageWriter& image) const override;
+	void shiftLines(long lines) override;
+	void index(SymbolIndex& index) const override;
+	bool nameAnalysis(SymbolTable * symTab) override;
+	void typeAnalysis(TypeAnalysis * ta) override;
+	void lower(IRBuilder& ir) override;
+private:
+	ExpNode * myCond;
+	NodeList<StmtNode> * myBody;
+};
+
+class IfStmtNode : public StmtNode{
+public:
+	IfStmtNode(const Position& p, ExpNode * condIn,
+	  NodeList<StmtNode> * bodyIn)
+	: StmtNode(p), myCond(condIn), myBody(bodyIn){ }
+	void unparse(UnparseWriter& out, int indent);
+	NodeRef flatten(AstImageWriter& image) const override;
+	void shiftLines(long lines) override;
+	void index(SymbolIndex& index) const override;
+	bool nameAnalysis(SymbolTable * symTab) override;
+	void typeAnalysis(TypeAnalysis * ta) override;
+	void lower(IRBuilder& ir) override;
+private:
+	ExpNode * myCond;
+	NodeList<StmtNode> * myBody;
+};
+
+class IfElseStmtNode : public StmtNode{
+public:
+	IfElseStmtNode(const Position& p, ExpNode * condIn,
+	  NodeList<StmtNode> * bodyTrueIn, NodeList<StmtNode> * bodyFalseIn)
+	: StmtNode(p), myCond(condIn),
+	  myBodyTrue(bodyTrueIn), myBodyFalse(bodyFalseIn){ }
+	void unparse(UnparseWriter& out, int indent);
+	NodeRef flatten(AstImageWriter& image) const override;
+	void shiftLines(long lines) override;
+	void index(SymbolIndex& index) const override;
+	bool nameAnalysis(SymbolTable * symTab) override;
+	void typeAnalysis(TypeAnalysis * ta) override;
+	void lower(IRBuilder& ir) override;
+private:
+	ExpNode * myCond;
+	NodeList<StmtNode> * myBodyTrue;
+	NodeList<StmtNode> * myBodyFalse;
+};
+
+/** A return statement; the expression is nullptr for
+ * a bare "return;"
+**/
+class ReturnStmtNode : public StmtNode{
+public:
+	ReturnStmtNode(const Position& p, ExpNode * expIn)
+	: StmtNode(p), myExp(expIn){ }
+	void unparse(UnparseWriter& out, int indent);
+	NodeRef flatten(AstImageWriter& image) const override;
+	void shiftLines(long lines) override;
+	void index(SymbolIndex& index) const override;
+	bool nameAnalysis(SymbolTable * symTab) override;
+	void typeAnalysis(TypeAnalysis * ta) override;
+	void lower(IRBuilder& ir) override;
+private:
+	ExpNode * myExp;
+};
+
+class CallStmtNode : public StmtNode{
+public:
+	CallStmtNode(const Position& p, CallExpNode * callIn)
+	: StmtNode(p), myCall(callIn){ }
+	void unparse(UnparseWriter& out, int indent);
+	NodeRef flatten(AstImageWriter& image) const override;
+	void shiftLines(long lines) override;
+	void index(SymbolIndex& index) const override;
+	bool nameAnalysis(SymbolTable * symTab) override;
+	void typeAnalysis(TypeAnalysis * ta) override;
+	void lower(IRBuilder& ir) override;
+private:
+	CallExpNode * myCall;
 };
 
 } //End namespace cminusminus
@@ -0,0 +1,505 @@
+#include <cstring>
+#include "astimage.hpp"
+
+namespace cminusminus{
+
+static const char MAGIC[4] = {'C', 'M', 'M', 'A'};
+
+/* What each field of a kind holds; the first NONE ends the
+   kind's fields. Loading checks every field against this */
+enum FieldType { NONE, REF, OPTREF, LIST, NAME, VALUE };
+static const size_t MAX_FIELDS = 4;
+static const FieldType SCHEMA[AST_KIND_COUNT][MAX_FIELDS] = {
+	/* AST_PROGRAM */    {LIST, NONE, NONE, NONE},
+	/* AST_VARDECL */    {REF, REF, NONE, NONE},
+	/* AST_FNDECL */     {REF, REF, LIST, LIST},
+	/* AST_FORMALDECL */ {REF, REF, NONE, NONE},
+	/* AST_INTTYPE */    {NONE, NONE, NONE, NONE},
+	/* AST_BOOLTYPE */   {NONE, NONE, NONE, NONE},
+	/* AST_SHORTTYPE */  {NONE, NONE, NONE, NONE},
+	/* AST_STRINGTYPE */ {NONE, NONE, NONE, NONE},
+	/* AST_VOIDTYPE */   {NONE, NONE, NONE, NONE},
+	/* AST_PTRTYPE */    {REF, NONE, NONE, NONE},
+	/* AST_ID */         {NAME, NONE, NONE, NONE},
+	/* AST_DEREF */      {REF, NONE, NONE, NONE},
+	/* AST_REF */        {REF, NONE, NONE, NONE},
+	/* AST_INTLIT */     {VALUE, NONE, NONE, NONE},
+	/* AST_SHORTLIT */   {VALUE, NONE, NONE, NONE},
+	/* AST_STRLIT */     {NAME, NONE, NONE, NONE},
+	/* AST_TRUE */       {NONE, NONE, NONE, NONE},
+	/* AST_FALSE */      {NONE, NONE, NONE, NONE},
+	/* AST_ASSIGNEXP */  {REF, REF, NONE, NONE},
+	/* AST_CALLEXP */    {REF, LIST, NONE, NONE},
+	/* AST_PLUS */       {REF, REF, NONE, NONE},
+	/* AST_MINUS */      {REF, REF, NONE, NONE},
+	/* AST_TIMES */      {REF, REF, NONE, NONE},
+	/* AST_DIVIDE */     {REF, REF, NONE, NONE},
+	/* AST_AND */        {REF, REF, NONE, NONE},
+	/* AST_OR */         {REF, REF, NONE, NONE},
+	/* AST_EQUALS */     {REF, REF, NONE, NONE},
+	/* AST_NOTEQUALS */  {REF, REF, NONE, NONE},
+	/* AST_LESS */       {REF, REF, NONE, NONE},
+	/* AST_LESSEQ */     {REF, REF, NONE, NONE},
+	/* AST_GREATER */    {REF, REF, NONE, NONE},
+	/* AST_GREATEREQ */  {REF, REF, NONE, NONE},
+	/* AST_NEG */        {REF, NONE, NONE, NONE},
+	/* AST_NOT */        {REF, NONE, NONE, NONE},
+	/* AST_ASSIGNSTMT */ {REF, NONE, NONE, NONE},
+	/* AST_POSTINC */    {REF, NONE, NONE, NONE},
+	/* AST_POSTDEC */    {REF, NONE, NONE, NONE},
+	/* AST_READ */       {REF, NONE, NONE, NONE},
+	/* AST_WRITE */      {REF, NONE, NONE, NONE},
+	/* AST_WHILE */      {REF, LIST, NONE, NONE},
+	/* AST_IF */         {REF, LIST, NONE, NONE},
+	/* AST_IFELSE */     {REF, LIST, LIST, NONE},
+	/* AST_RETURN */     {OPTREF, NONE, NONE, NONE},
+	/* AST_CALLSTMT */   {REF, NONE, NONE, NONE},
+};
+
+/* The operator of each of AST_PLUS ... AST_NOT */
+static const char * opStr(AstKind kind){
+	switch (kind){
+	case AST_PLUS: return "+";
+	case AST_MINUS: return "-";
+	case AST_TIMES: return "*";
+	case AST_DIVIDE: return "/";
+	case AST_AND: return "and";
+	case AST_OR: return "or";
+	case AST_EQUALS: return "==";
+	case AST_NOTEQUALS: return "!=";
+	case AST_LESS: return "<";
+	case AST_LESSEQ: return "<=";
+	case AST_GREATER: return ">";
+	case AST_GREATEREQ: return ">=";
+	case AST_NEG: return "-";
+	case AST_NOT: return "!";
+	default: return "?";
+	}
+}
+
+static size_t fieldCount(size_t kind){
+	size_t n = 0;
+	while (n < MAX_FIELDS && SCHEMA[kind][n] != NONE){ n++; }
+	return n;
+}
+
+static size_t recordWords(size_t kind){
+	return AST_POS_WORDS + fieldCount(kind);
+}
+
+AstImageWriter::AstImageWriter(){
+	myOffsets.push_back(0);
+}
+
+NodeRef AstImageWriter::add(AstKind kind, const Position& pos,
+  uint32_t a, uint32_t b, uint32_t c, uint32_t d){
+	std::vector<uint32_t>& records = myRecords[kind];
+	uint32_t index = static_cast<uint32_t>(records.size() / recordWords(kind));
+	const uint32_t words[AST_POS_WORDS + MAX_FIELDS] = {
+		static_cast<uint32_t>(pos.line()),
+		static_cast<uint32_t>(pos.col()),
+		static_cast<uint32_t>(pos.endLine()),
+		static_cast<uint32_t>(pos.endCol()),
+		a, b, c, d
+	};
+	records.insert(records.end(), words, words + recordWords(kind));
+	return makeRef(kind, index);
+}
+
+uint32_t AstImageWriter::addList(const std::vector<NodeRef>& refs){
+	uint32_t list = static_cast<uint32_t>(myLists.size());
+	myLists.push_back(static_cast<uint32_t>(refs.size()));
+	myLists.insert(myLists.end(), refs.begin(), refs.end());
+	return list;
+}
+
+uint32_t AstImageWriter::addName(Symbol sym){
+	if (sym.id() >= mySymIndex.size()){
+		mySymIndex.resize(sym.id() + 1, 0);
+	}
+	if (mySymIndex[sym.id()] == 0){
+		mySymIndex[sym.id()] = addString(sym.str()) + 1;
+	}
+	return mySymIndex[sym.id()] - 1;
+}
+
+uint32_t AstImageWriter::addString(const std::string& s){
+	myStrings += s;
+	myOffsets.push_back(static_cast<uint32_t>(myStrings.size()));
+	return static_cast<uint32_t>(myOffsets.size() - 2);
+}
+
+static void putWords(std::ostream& out, const uint32_t * words, size_t n){
+	out.write(reinterpret_cast<const char *>(words),
+		static_cast<std::streamsize>(n * sizeof(uint32_t)));
+}
+
+void AstImageWriter::write(std::ostream& out) const{
+	std::vector<uint32_t> header;
+	header.push_back(ASTIMAGE_VERSION);
+	header.push_back(AST_KIND_COUNT);
+	for (size_t k = 0; k < AST_KIND_COUNT; k++){
+		header.push_back(static_cast<uint32_t>(
+			myRecords[k].size() / recordWords(k)));
+	}
+	header.push_back(static_cast<uint32_t>(myLists.size()));
+	header.push_back(static_cast<uint32_t>(myOffsets.size() - 1));
+	header.push_back(static_cast<uint32_t>(myStrings.size()));
+
+	out.write(MAGIC, sizeof(MAGIC));
+	putWords(out, header.data(), header.size());
+	for (const auto& records : myRecords){
+		putWords(out, records.data(), records.size());
+	}
+	putWords(out, myLists.data(), myLists.size());
+	putWords(out, myOffsets.data(), myOffsets.size());
+	out.write(myStrings.data(), static_cast<std::streamsize>(myStrings.size()));
+	out.flush();
+}
+
+bool AstImage::isAstImage(const SourceFile * src){
+	return src->size() >= sizeof(MAGIC)
+	  && std::memcmp(src->data(), MAGIC, sizeof(MAGIC)) == 0;
+}
+
+const uint32_t * AstImage::record(NodeRef ref) const{
+	size_t kind = refKind(ref);
+	return myRecords[kind] + refIndex(ref) * recordWords(kind);
+}
+
+bool AstImage::validRef(NodeRef ref) const{
+	return refKind(ref) < AST_KIND_COUNT
+	  && refIndex(ref) < myCounts[refKind(ref)];
+}
+
+bool AstImage::validList(uint32_t list) const{
+	return list < myNumListWords
+	  && myLists[list] <= myNumListWords - list - 1;
+}
+
+AstImage * AstImage::open(const SourceFile * src){
+	const size_t headerWords = 2 + AST_KIND_COUNT + 3;
+	const size_t headerBytes = sizeof(MAGIC) + headerWords * sizeof(uint32_t);
+	if (!isAstImage(src) || src->size() < headerBytes){
+		return nullptr;
+	}
+	uint32_t header[headerWords];
+	std::memcpy(header, src->data() + sizeof(MAGIC), sizeof(header));
+	if (header[0] != ASTIMAGE_VERSION || header[1] != AST_KIND_COUNT){
+		return nullptr;
+	}
+
+	AstImage * image = new AstImage();
+	size_t recordBytes = 0;
+	for (size_t k = 0; k < AST_KIND_COUNT; k++){
+		image->myCounts[k] = header[2 + k];
+		recordBytes += header[2 + k] * recordWords(k) * sizeof(uint32_t);
+	}
+	image->myNumListWords = header[2 + AST_KIND_COUNT];
+	image->myNumStrings = header[3 + AST_KIND_COUNT];
+	size_t stringBytes = header[4 + AST_KIND_COUNT];
+	size_t need = headerBytes
+	  + recordBytes
+	  + image->myNumListWords * sizeof(uint32_t)
+	  + (image->myNumStrings + 1) * sizeof(uint32_t)
+	  + stringBytes;
+	if (image->myCounts[AST_PROGRAM] != 1 || need != src->size()){
+		delete image;
+		return nullptr;
+	}
+
+	const char * cur = src->data() + headerBytes;
+	for (size_t k = 0; k < AST_KIND_COUNT; k++){
+		image->myRecords[k] = reinterpret_cast<const uint32_t *>(cur);
+		cur += image->myCounts[k] * recordWords(k) * sizeof(uint32_t);
+	}
+	image->myLists = reinterpret_cast<const uint32_t *>(cur);
+	cur += image->myNumListWords * sizeof(uint32_t);
+	image->myOffsets = reinterpret_cast<const uint32_t *>(cur);
+	cur += (image->myNumStrings + 1) * sizeof(uint32_t);
+	image->myStrings = cur;
+
+	//Validate once up front so unparse never reads out of bounds.
+	// Every node may have at most one parent and the root none,
+	// so the part reachable from the root is a tree
+	bool ok = image->myOffsets[0] == 0
+	  && image->myOffsets[image->myNumStrings] == stringBytes;
+	for (size_t i = 0; ok && i < image->myNumStrings; i++){
+		ok = image->myOffsets[i] <= image->myOffsets[i + 1];
+	}
+	std::vector<char> parents[AST_KIND_COUNT];
+	for (size_t k = 0; k < AST_KIND_COUNT; k++){
+		parents[k].assign(image->myCounts[k], 0);
+	}
+	auto adopt = [&](NodeRef ref){
+		if (!image->validRef(ref)){ return false; }
+		char& seen = parents[refKind(ref)][refIndex(ref)];
+		if (seen != 0 || ref == makeRef(AST_PROGRAM, 0)){ return false; }
+		seen = 1;
+		return true;
+	};
+	for (size_t k = 0; ok && k < AST_KIND_COUNT; k++){
+		for (size_t i = 0; ok && i < image->myCounts[k]; i++){
+			NodeRef self = makeRef(static_cast<AstKind>(k),
+				static_cast<uint32_t>(i));
+			for (size_t f = 0; ok && f < fieldCount(k); f++){
+				uint32_t value = image->field(self, f);
+				switch (SCHEMA[k][f]){
+				case REF:
+					ok = adopt(value);
+					break;
+				case OPTREF:
+					ok = value == AST_NO_REF || adopt(value);
+					break;
+				case LIST:
+					ok = image->validList(value);
+					for (uint32_t j = 0; ok && j < image->myLists[value]; j++){
+						ok = adopt(image->myLists[value + 1 + j]);
+					}
+					break;
+				case NAME:
+					ok = value < image->myNumStrings;
+					break;
+				case VALUE:
+				case NONE:
+					break;
+				}
+			}
+		}
+	}
+	if (!ok){
+		delete image;
+		return nullptr;
+	}
+	return image;
+}
+
+/*
+The cases below mirror the unparse methods in unparse.cpp, and
+need to change along with them.
+*/
+
+void AstImage::unparse(UnparseWriter& out, int indent) const{
+	unparseNode(out, makeRef(AST_PROGRAM, 0), indent);
+}
+
+static void doIndent(UnparseWriter& out, int indent){
+	out.indent(indent);
+}
+
+void AstImage::putName(UnparseWriter& out, uint32_t idx) const{
+	out.put(myStrings + myOffsets[idx],
+		myOffsets[idx + 1] - myOffsets[idx]);
+}
+
+void AstImage::unparseList(UnparseWriter& out, uint32_t list,
+  int indent) const{
+	for (uint32_t j = 0; j < myLists[list]; j++){
+		unparseNode(out, myLists[list + 1 + j], indent);
+	}
+}
+
+void AstImage::unparseBlock(UnparseWriter& out, uint32_t list,
+  int indent) const{
+	out << "{\n";
+	unparseList(out, list, indent + 1);
+	doIndent(out, indent);
+	out << "}";
+}
+
+void AstImage::unparseAssign(UnparseWriter& out, NodeRef ref) const{
+	//Loading only checks that a field holds some node, so
+	// anything other than an assignment falls back to unparseNode
+	if (refKind(ref) != AST_ASSIGNEXP){
+		unparseNode(out, ref, 0);
+		return;
+	}
+	unparseNode(out, field(ref, 0), 0);
+	out << " = ";
+	unparseNode(out, field(ref, 1), 0);
+}
+
+void AstImage::unparseNode(UnparseWriter& out, NodeRef ref,
+  int indent) const{
+	AstKind kind = refKind(ref);
+	switch (kind){
+	case AST_PROGRAM:
+		unparseList(out, field(ref, 0), indent);
+		break;
+	case AST_VARDECL:
+		doIndent(out, indent);
+		unparseNode(out, field(ref, 0), 0);
+		out << " ";
+		unparseNode(out, field(ref, 1), 0);
+		out << ";\n";
+		break;
+	case AST_FNDECL: {
+		doIndent(out, indent);
+		unparseNode(out, field(ref, 0), 0);
+		out << " ";
+		unparseNode(out, field(ref, 1), 0);
+		out << "(";
+		uint32_t formals = field(ref, 2);
+		for (uint32_t j = 0; j < myLists[formals]; j++){
+			if (j > 0){ out << ", "; }
+			unparseNode(out, myLists[formals + 1 + j], 0);
+		}
+		out << ")";
+		unparseBlock(out, field(ref, 3), indent);
+		out << "\n";
+		break;
+	}
+	case AST_FORMALDECL:
+		unparseNode(out, field(ref, 0), 0);
+		out << " ";
+		unparseNode(out, field(ref, 1), 0);
+		break;
+	case AST_INTTYPE:
+		out << "int";
+		break;
+	case AST_BOOLTYPE:
+		out << "bool";
+		break;
+	case AST_SHORTTYPE:
+		out << "short";
+		break;
+	case AST_STRINGTYPE:
+		out << "string";
+		break;
+	case AST_VOIDTYPE:
+		out << "void";
+		break;
+	case AST_PTRTYPE:
+		out << "ptr ";
+		unparseNode(out, field(ref, 0), 0);
+		break;
+	case AST_ID:
+	case AST_STRLIT:
+		putName(out, field(ref, 0));
+		break;
+	case AST_DEREF:
+		out << "@";
+		unparseNode(out, field(ref, 0), 0);
+		break;
+	case AST_REF:
+		out << "&";
+		unparseNode(out, field(ref, 0), 0);
+		break;
+	case AST_INTLIT:
+		out << static_cast<int32_t>(field(ref, 0));
+		break;
+	case AST_SHORTLIT:
+		out << static_cast<int32_t>(field(ref, 0)) << "S";
+		break;
+	case AST_TRUE:
+		out << "true";
+		break;
+	case AST_FALSE:
+		out << "false";
+		break;
+	case AST_ASSIGNEXP:
+		out << "(";
+		unparseAssign(out, ref);
+		out << ")";
+		break;
+	case AST_CALLEXP: {
+		unparseNode(out, field(ref, 0), 0);
+		out << "(";
+		uint32_t args = field(ref, 1);
+		for (uint32_t j = 0; j < myLists[args]; j++){
+			if (j > 0){ out << ", "; }
+			unparseNode(out, myLists[args + 1 + j], 0);
+		}
+		out << ")";
+		break;
+	}
+	case AST_PLUS:
+	case AST_MINUS:
+	case AST_TIMES:
+	case AST_DIVIDE:
+	case AST_AND:
+	case AST_OR:
+	case AST_EQUALS:
+	case AST_NOTEQUALS:
+	case AST_LESS:
+	case AST_LESSEQ:
+	case AST_GREATER:
+	case AST_GREATEREQ:
+		out << "(";
+		unparseNode(out, field(ref, 0), 0);
+		out << " " << opStr(kind) << " ";
+		unparseNode(out, field(ref, 1), 0);
+		out << ")";
+		break;
+	case AST_NEG:
+	case AST_NOT:
+		out << "(" << opStr(kind);
+		unparseNode(out, field(ref, 0), 0);
+		out << ")";
+		break;
+	case AST_ASSIGNSTMT:
+		doIndent(out, indent);
+		unparseAssign(out, field(ref, 0));
+		out << ";\n";
+		break;
+	case AST_POSTINC:
+		doIndent(out, indent);
+		unparseNode(out, field(ref, 0), 0);
+		out << "++;\n";
+		break;
+	case AST_POSTDEC:
+		doIndent(out, indent);
+		unparseNode(out, field(ref, 0), 0);
+		out << "--;\n";
+		break;
+	case AST_READ:
+		doIndent(out, indent);
+		out << "read ";
+		unparseNode(out, field(ref, 0), 0);
+		out << ";\n";
+		break;
+	case AST_WRITE:
+		doIndent(out, indent);
+		out << "write ";
+		unparseNode(out, field(ref, 0), 0);
+		out << ";\n";
+		break;
+	case AST_WHILE:
+	case AST_IF:
+		doIndent(out, indent);
+		out << (kind == AST_WHILE ? "while (" : "if (");
+		unparseNode(out, field(ref, 0), 0);
+		out << ")";
+		unparseBlock(out, field(ref, 1), indent);
+		out << "\n";
+		break;
+	case AST_IFELSE:
+		doIndent(out, indent);
+		out << "if (";
+		unparseNode(out, field(ref, 0), 0);
+		out << ")";
+		unparseBlock(out, field(ref, 1), indent);
+		out << " else ";
+		unparseBlock(out, field(ref, 2), indent);
+		out << "\n";
+		break;
+	case AST_RETURN:
+		doIndent(out, indent);
+		out << "return";
+		if (field(ref, 0) != AST_NO_REF){
+			out << " ";
+			unparseNode(out, field(ref, 0), 0);
+		}
+		out << ";\n";
+		break;
+	case AST_CALLSTMT:
+		doIndent(out, indent);
+		unparseNode(out, field(ref, 0), 0);
+		out << ";\n";
+		break;
+	case AST_KIND_COUNT:
+		break;
+	}
+}
+
+} //End namespace cminusminus
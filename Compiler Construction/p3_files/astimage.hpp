@@ -0,0 +1,206 @@
+#ifndef CMINUSMINUS_ASTIMAGE_HPP
+#define CMINUSMINUS_ASTIMAGE_HPP
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "position.hpp"
+#include "source.hpp"
+#include "symbol.hpp"
+#include "unparsewriter.hpp"
+
+namespace cminusminus{
+
+/*
+Binary AST image (-A) layout, all fields little-endian:
+
+   char     magic[4]            "CMMA"
+   uint32   version             ASTIMAGE_VERSION
+   uint32   numKinds            AST_KIND_COUNT
+   uint32   counts[numKinds]    records of each kind
+   uint32   numListWords
+   uint32   numStrings
+   uint32   stringBytes
+   uint32   records[...]        all of kind 0, then kind 1, ...
+   uint32   lists[numListWords]
+   uint32   stringOffsets[numStrings + 1]
+   char     strings[stringBytes]
+
+A record is the node's line, col, endLine and endCol followed by
+the fields of its kind (listed with AstKind), so all records of
+one kind have the same width. A child is a NodeRef: its kind in
+the top 8 bits and its index among the records of that kind 
+below. A list field is an index
+into lists, where a count is followed by that many NodeRefs.
+The root is ProgramNode record 0.
+*/
+static const uint32_t ASTIMAGE_VERSION = 2;
+
+/* The fields of each kind:
+     AST_PROGRAM     list of global declarations
+     AST_VARDECL     type, id
+     AST_FNDECL      return type, id, list of formals, list of 
+                     body statements
+     AST_FORMALDECL  type, id
+     AST_*TYPE       (none), except AST_PTRTYPE: the base type
+     AST_ID          string table index of the name
+     AST_DEREF       id
+     AST_REF         id
+     AST_INTLIT      the value
+     AST_SHORTLIT    the value
+     AST_STRLIT      string table index of the literal's text
+     AST_TRUE        (none)
+     AST_FALSE       (none)
+     AST_ASSIGNEXP   lval, expression
+     AST_CALLEXP     id, list of arguments
+     AST_PLUS ... AST_GREATEREQ   lhs, rhs
+     AST_NEG, AST_NOT             operand
+     AST_ASSIGNSTMT  an AST_ASSIGNEXP
+     AST_POSTINC     lval
+     AST_POSTDEC     lval
+     AST_READ        lval
+     AST_WRITE       expression
+     AST_WHILE       condition, list of body statements
+     AST_IF          condition, list of body statements
+     AST_IFELSE      condition, list for the true branch,
+                     list for the false branch
+     AST_RETURN      expression, or AST_NO_REF
+     AST_CALLSTMT    an AST_CALLEXP */
+enum AstKind : uint32_t {
+	AST_PROGRAM,
+	AST_VARDECL,
+	AST_FNDECL,
+	AST_FORMALDECL,
+	AST_INTTYPE,
+	AST_BOOLTYPE,
+	AST_SHORTTYPE,
+	AST_STRINGTYPE,
+	AST_VOIDTYPE,
+	AST_PTRTYPE,
+	AST_ID,
+	AST_DEREF,
+	AST_REF,
+	AST_INTLIT,
+	AST_SHORTLIT,
+	AST_STRLIT,
+	AST_TRUE,
+	AST_FALSE,
+	AST_ASSIGNEXP,
+	AST_CALLEXP,
+	AST_PLUS,
+	AST_MINUS,
+	AST_TIMES,
+	AST_DIVIDE,
+	AST_AND,
+	AST_OR,
+	AST_EQUALS,
+	AST_NOTEQUALS,
+	AST_LESS,
+	AST_LESSEQ,
+	AST_GREATER,
+	AST_GREATEREQ,
+	AST_NEG,
+	AST_NOT,
+	AST_ASSIGNSTMT,
+	AST_POSTINC,
+	AST_POSTDEC,
+	AST_READ,
+	AST_WRITE,
+	AST_WHILE,
+	AST_IF,
+	AST_IFELSE,
+	AST_RETURN,
+	AST_CALLSTMT,
+	AST_KIND_COUNT
+};
+
+/* Words in the position part of a record */
+static const size_t AST_POS_WORDS = 4;
+
+typedef uint32_t NodeRef;
+
+inline NodeRef makeRef(AstKind kind, uint32_t index){
+	return (static_cast<uint32_t>(kind) << 24) | index;
+}
+inline AstKind refKind(NodeRef ref){ return static_cast<AstKind>(ref >> 24); }
+inline uint32_t refIndex(NodeRef ref){ return ref & 0xFFFFFF; }
+
+/* An optional child that is absent */
+static const NodeRef AST_NO_REF = 0xFFFFFFFF;
+
+/**
+* \class AstImageWriter
+* Builds an AST image as ASTNode::flatten walks the tree: each
+* node adds its children first, then its own record
+**/
+class AstImageWriter{
+public:
+	AstImageWriter();
+	/** Add a node; fields beyond the kind's field count are 
+	 * ignored **/
+	NodeRef add(AstKind kind, const Position& pos, uint32_t a = 0,
+	  uint32_t b = 0, uint32_t c = 0, uint32_t d = 0);
+	/** Returns the list field value for refs **/
+	uint32_t addList(const std::vector<NodeRef>& refs);
+	/** Returns the string table index for sym's spelling **/
+	uint32_t addName(Symbol sym);
+	/** Returns the string table index for a new copy of s **/
+	uint32_t addString(const std::string& s);
+	void write(std::ostream& out) const;
+private:
+	std::vector<uint32_t> myRecords[AST_KIND_COUNT];
+	std::vector<uint32_t> myLists;
+	std::vector<uint32_t> myOffsets;
+	std::string myStrings;
+	/* String table index + 1 for each Symbol id seen so far */
+	std::vector<uint32_t> mySymIndex;
+};
+
+/**
+* \class AstImage
+* Read-only view of an AST image held in a SourceFile (normally
+* an mmapped file). Records, lists and names are used in place;
+* loading allocates nothing per node.
+**/
+class AstImage{
+public:
+	/** True if src starts with the AST image magic **/
+	static bool isAstImage(const SourceFile * src);
+	/** Returns nullptr if src is not a well-formed image **/
+	static AstImage * open(const SourceFile * src);
+
+	size_t count(AstKind kind) const { return myCounts[kind]; }
+	Position pos(NodeRef ref) const {
+		const uint32_t * rec = record(ref);
+		return Position(rec[0], rec[1], rec[2], rec[3]);
+	}
+	/** Field i (counting from 0) of the node ref **/
+	uint32_t field(NodeRef ref, size_t i) const {
+		return record(ref)[AST_POS_WORDS + i];
+	}
+	/** Same text as ProgramNode::unparse on the original tree **/
+	void unparse(UnparseWriter& out, int indent) const;
+private:
+	AstImage(){ }
+	const uint32_t * record(NodeRef ref) const;
+	void unparseNode(UnparseWriter& out, NodeRef ref, int indent) const;
+	void unparseList(UnparseWriter& out, uint32_t list, int indent) const;
+	void unparseBlock(UnparseWriter& out, uint32_t list, int indent) const;
+	void unparseAssign(UnparseWriter& out, NodeRef ref) const;
+	void putName(UnparseWriter& out, uint32_t idx) const;
+	bool validRef(NodeRef ref) const;
+	bool validList(uint32_t list) const;
+
+	const uint32_t * myRecords[AST_KIND_COUNT];
+	uint32_t myCounts[AST_KIND_COUNT];
+	const uint32_t * myLists;
+	size_t myNumListWords;
+	const uint32_t * myOffsets;
+	size_t myNumStrings;
+	const char * myStrings;
+};
+
+} //End namespace cminusminus
+
+#endif
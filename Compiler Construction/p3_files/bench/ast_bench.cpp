@@ -0,0 +1,87 @@
+/*
+Builds the globals of a program of N declarations ("int v<i>;",
+1M by default) two ways and walks each:
+  - before: a std::list<DeclNode *> grown with push_back
+  - after: a NodeList<DeclNode> in the arena
+Reports build and walk times for each, then unparses the whole
+ProgramNode to check the tree is usable.
+*/
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <list>
+#include <sstream>
+#include "ast.hpp"
+
+using namespace cminusminus;
+
+static double secondsSince(std::chrono::steady_clock::time_point start){
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double>(end - start).count();
+}
+
+/* Stands in for a traversal: touch each node's position */
+template <typename List>
+static size_t walk(const List& decls){
+	size_t sum = 0;
+	for (auto decl : decls){ sum += decl->pos().line(); }
+	return sum;
+}
+
+int main(int argc, char ** argv){
+	size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+	Arena * arena = new Arena();
+	Interner& names = Interner::global();
+	std::vector<DeclNode *> decls;
+	decls.reserve(count);
+	for (size_t i = 0; i < count; i++){
+		Position pos(i + 1, 1, i + 1, 8);
+		IntTypeNode * type = arena->make<IntTypeNode>(pos);
+		IDNode * id = arena->make<IDNode>(pos,
+			names.intern("v" + std::to_string(i % 50000)));
+		decls.push_back(arena->make<VarDeclNode>(pos, type, id));
+	}
+
+	auto t0 = std::chrono::steady_clock::now();
+	std::list<DeclNode *> before;
+	for (auto decl : decls){ before.push_back(decl); }
+	double beforeBuild = secondsSince(t0);
+
+	t0 = std::chrono::steady_clock::now();
+	NodeList<DeclNode> * after = arena->make<NodeList<DeclNode>>(arena);
+	for (auto decl : decls){ after->push_back(decl); }
+	double afterBuild = secondsSince(t0);
+
+	const int rounds = 10;
+	size_t beforeSum = 0;
+	size_t afterSum = 0;
+	t0 = std::chrono::steady_clock::now();
+	for (int r = 0; r < rounds; r++){ beforeSum += walk(before); }
+	double beforeWalk = secondsSince(t0) / rounds;
+	t0 = std::chrono::steady_clock::now();
+	for (int r = 0; r < rounds; r++){ afterSum += walk(*after); }
+	double afterWalk = secondsSince(t0) / rounds;
+	if (beforeSum != afterSum){
+		std::cerr << "lists differ\n";
+		return 1;
+	}
+
+	ProgramNode * program = new ProgramNode(arena, after);
+	std::ostringstream out;
+	t0 = std::chrono::steady_clock::now();
+	{
+		UnparseWriter writer(out);
+		program->unparse(writer, 0);
+	}
+	double unparseSecs = secondsSince(t0);
+
+	std::cout << count << " declarations\n"
+	<< "std::list: build " << beforeBuild * 1000 << " ms, walk "
+	<< beforeWalk * 1000 << " ms\n"
+	<< "NodeList:  build " << afterBuild * 1000 << " ms, walk "
+	<< afterWalk * 1000 << " ms\n"
+	<< "unparse:   " << unparseSecs * 1000 << " ms, "
+	<< out.str().size() << " bytes\n";
+	delete program;
+	return 0;
+}
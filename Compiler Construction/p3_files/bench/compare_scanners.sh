@@ -0,0 +1,77 @@
+#!/bin/sh
+# Builds cmmc once with the flex scanner and once with the
+# hand-coded scanner. Checks that the two give the same -t token
+# stream and the same error reports on every p2_files/Tests input
+# and on a file that hits each of the scanner's errors, then
+# compares -t throughput and output on a generated C-- file of
+# SIZE_MB megabytes (default 32).
+# A variant that fails to build (e.g. flex not installed) is
+# skipped. Set CXX="g++ -O2" to time optimized builds, and
+# MAKEARGS to pass anything else to make (e.g. LEXER_TOOL=...).
+cd "$(dirname "$0")/.." || exit 1
+SIZE_MB=${1:-32}
+INPUT=bench/scan_input.cmm
+TESTS=../p2_files/Tests
+ERRORS=bench/lexerrors.cmm
+
+# None of the p2_files/Tests inputs has a lexical error, so this
+# file has one of each, plus CRLF line ends and a string cut off by EOF
+printf '%s\n' \
+	'int x; $ ` ~ \' \
+	'"open' \
+	'"b\q" "b\qopen' \
+	'"b\q\"' > $ERRORS
+printf '%s\r\n' \
+	'x = 99999999999 + 00000000000012 + 2147483648 + 40000S + 0000000000000000001S + 99999999999S;' \
+	'write "ok\t\n\"\\";	# trailing comment' >> $ERRORS
+printf '%s\n' 'if (x >= 1 && x != 2 || !x) { x--; x++; }' >> $ERRORS
+printf '"eof' >> $ERRORS
+
+awk -v target=$((SIZE_MB * 1024 * 1024)) 'BEGIN {
+	n = 0; bytes = 0;
+	while (bytes < target) {
+		line = sprintf("int f%d(int a, string s) {\n\tint x_%d;\n\tx_%d = a * %d + 7S; # calc\n\tif (x_%d >= 10) { write \"big\\n\"; }\n\treturn x_%d;\n}\n", n, n, n, n % 1000, n, n);
+		printf "%s", line;
+		bytes += length(line);
+		n++;
+	}
+}' > $INPUT
+
+for variant in flex hand; do
+	make clean > /dev/null
+	if ! make SCANNER=$variant $MAKEARGS cmmc > /dev/null 2>&1; then
+		echo "$variant: build failed, skipped"
+		continue
+	fi
+	for test in $TESTS/*.cmm $ERRORS; do
+		name=$(basename $test .cmm)
+		./cmmc $test -t bench/scan_$name.tokens.$variant \
+			2> bench/scan_$name.err.$variant
+	done
+	start=$(date +%s.%N)
+	./cmmc $INPUT -t bench/scan_tokens.$variant
+	end=$(date +%s.%N)
+	echo "$variant: $(echo "$start $end $SIZE_MB" | \
+		awk '{ printf "%.1f MB/s", $3 / ($2 - $1) }')"
+done
+
+if [ -f bench/scan_tokens.flex ] && [ -f bench/scan_tokens.hand ]; then
+	same=0
+	total=0
+	for test in $TESTS/*.cmm $ERRORS; do
+		name=$(basename $test .cmm)
+		total=$((total + 1))
+		if cmp -s bench/scan_$name.tokens.flex bench/scan_$name.tokens.hand \
+		  && cmp -s bench/scan_$name.err.flex bench/scan_$name.err.hand; then
+			same=$((same + 1))
+		else
+			echo "$name: flex and hand differ"
+			diff bench/scan_$name.tokens.flex bench/scan_$name.tokens.hand | head -5
+			diff bench/scan_$name.err.flex bench/scan_$name.err.hand | head -5
+		fi
+	done
+	echo "$same of $total inputs: token streams and errors identical"
+	cmp bench/scan_tokens.flex bench/scan_tokens.hand \
+		&& echo "token streams identical on $INPUT"
+fi
+rm -f $INPUT $ERRORS bench/scan_*
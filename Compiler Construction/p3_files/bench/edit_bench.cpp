@@ -0,0 +1,223 @@
+/*
+Types into a C-- file the way an editor would: whole globals
+typed in one key at a time (so the text is broken until each is
+done), and random keys, deletes, new lines and deleted lines,
+each taken back by the next edit. After every edit the incremental
+parse is checked against a full parse of the same text: the
+same messages and, when it parses, the same AST image (which
+holds every node's position). A few fixed edits that once went
+wrong are checked the same way first. Reports the time per edit,
+and for program() to bring the tree up to date after it, against
+the time for a full parse.
+
+  edit_bench <file.cmm> [edits, 2000 by default] [seed]
+*/
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include "astimage.hpp"
+#include "incremental.hpp"
+
+using namespace cminusminus;
+
+static double secondsSince(std::chrono::steady_clock::time_point start){
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double>(end - start).count();
+}
+
+static unsigned long long rngState = 1;
+
+static size_t pick(size_t n){
+	rngState = rngState * 6364136223846793005ULL + 1442695040888963407ULL;
+	return n == 0 ? 0 : static_cast<size_t>((rngState >> 33) % n);
+}
+
+static const char * const TYPED[] = {
+	"int zq;\n",
+	"bool flag;\n",
+	"void f(int a, int b){\n\ta = b + 1;\n\treturn;\n}\n",
+	"int g(){\n\twhile (x < 3){\n\t\tx++;\n\t}\n\treturn 2;\n}\n",
+	"# a comment\n",
+	"string s;\n",
+	"int split\n;\n",
+};
+static const char KEYS[] = "abcxyz019 +-*/(){};=<>!&|\"\t";
+
+static std::string image(ProgramNode * program){
+	AstImageWriter image;
+	program->flatten(image);
+	std::ostringstream out;
+	image.write(out);
+	return out.str();
+}
+
+/* Edits that once left the incremental parse out of step with a
+   full parse, each made to its own text before the random ones:
+   the text, then the offset, bytes removed and text inserted */
+struct FixedEdit{
+	const char * text;
+	size_t offset;
+	size_t removed;
+	const char * inserted;
+};
+static const FixedEdit FIXED[] = {
+	//A declaration whose semicolon is on a later line
+	{"int x\n;\nint y;\n", 6, 0, " "},
+	{"int x\n;\nint y;\n", 5, 0, "\n"},
+};
+
+/* Whether session's messages and tree are those of a full parse
+   (with full) of the same text; says how they differ if not */
+static bool sameAsFull(IncrementalParser& session, IncrementalParser& full,
+  ProgramNode * program){
+	bool same = session.errors() == full.errors()
+	  && session.syntaxOutput() == full.syntaxOutput()
+	  && (program == nullptr) == (full.program() == nullptr);
+	if (same && program != nullptr){
+		same = image(program) == image(full.program());
+	}
+	if (!same){
+		std::cerr << "incremental:\n" << session.errors()
+		<< session.syntaxOutput() << "full:\n" << full.errors()
+		<< full.syntaxOutput();
+	}
+	return same;
+}
+
+static size_t lineStart(const std::string& text, size_t offset){
+	size_t nl = offset == 0 ? std::string::npos
+	  : text.rfind('\n', offset - 1);
+	return nl == std::string::npos ? 0 : nl + 1;
+}
+
+/* The first line from offset on that starts a global (in the
+   files gencmm writes, the lines that start with a letter), or
+   the end of the text */
+static size_t globalStart(const std::string& text, size_t offset){
+	size_t at = lineStart(text, offset);
+	while (at < text.size() && !(text[at] >= 'a' && text[at] <= 'z')){
+		size_t nl = text.find('\n', at);
+		at = nl == std::string::npos ? text.size() : nl + 1;
+	}
+	return at;
+}
+
+int main(int argc, char ** argv){
+	if (argc < 2){
+		std::cerr << "usage: edit_bench <file.cmm> [edits] [seed]\n";
+		return 1;
+	}
+	std::ifstream in(argv[1]);
+	std::ostringstream text;
+	text << in.rdbuf();
+	size_t numEdits = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 2000;
+	rngState = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 1;
+
+	IncrementalParser session;
+	IncrementalParser full;
+	for (const FixedEdit& fixed : FIXED){
+		session.reset(fixed.text);
+		session.edit(fixed.offset, fixed.removed, fixed.inserted);
+		full.reset(session.text());
+		if (!sameAsFull(session, full, session.program())){
+			std::cerr << "fixed edit (" << fixed.offset << ", "
+			<< fixed.removed << ", \"" << fixed.inserted << "\") to \""
+			<< fixed.text << "\" differs from a full parse\n";
+			return 1;
+		}
+	}
+	session.reset(text.str());
+
+	//What is left of a global being typed in, one key per edit
+	std::string typing;
+	size_t typingAt = 0;
+	//The edit that takes back the last one
+	bool undo = false;
+	size_t undoAt = 0;
+	size_t undoRemoved = 0;
+	std::string undoInserted;
+	double editSecs = 0;
+	double treeSecs = 0;
+	double fullSecs = 0;
+	size_t bytesLexed = 0;
+	size_t fullParses = 0;
+	size_t broken = 0;
+	for (size_t n = 0; n < numEdits; n++){
+		const std::string& cur = session.text();
+		size_t offset = pick(cur.size() + 1);
+		size_t removed = 0;
+		std::string inserted;
+		if (undo){
+			offset = undoAt;
+			removed = undoRemoved;
+			inserted = undoInserted;
+			undo = false;
+		} else if (!typing.empty()){
+			offset = typingAt++;
+			inserted = typing.substr(0, 1);
+			typing.erase(0, 1);
+		} else {
+			undo = true;
+			switch (pick(6)){
+			case 0:
+				inserted = std::string(1, KEYS[pick(sizeof(KEYS) - 1)]);
+				break;
+			case 1:
+				removed = offset < cur.size() ? 1 : 0;
+				break;
+			case 2:
+				inserted = "\n";
+				break;
+			case 3: {
+				//Delete a whole line
+				offset = lineStart(cur, offset);
+				size_t nl = cur.find('\n', offset);
+				removed = (nl == std::string::npos ? cur.size() : nl + 1) - offset;
+				break;
+			}
+			default:
+				//Start typing a global in before another one
+				offset = globalStart(cur, offset);
+				typing = TYPED[pick(sizeof(TYPED) / sizeof(TYPED[0]))];
+				inserted = typing.substr(0, 1);
+				typing.erase(0, 1);
+				typingAt = offset + 1;
+				undo = false;
+			}
+			undoAt = offset;
+			undoRemoved = inserted.size();
+			undoInserted = cur.substr(offset, removed);
+		}
+
+		auto t0 = std::chrono::steady_clock::now();
+		bool parsed = session.edit(offset, removed, inserted);
+		editSecs += secondsSince(t0);
+		bytesLexed += session.lastWork().bytesLexed;
+		fullParses += session.lastWork().full ? 1 : 0;
+		broken += parsed ? 0 : 1;
+		t0 = std::chrono::steady_clock::now();
+		ProgramNode * program = session.program();
+		treeSecs += secondsSince(t0);
+
+		t0 = std::chrono::steady_clock::now();
+		full.reset(session.text());
+		fullSecs += secondsSince(t0);
+		if (!sameAsFull(session, full, program)){
+			std::cerr << "edit " << n << " (" << offset << ", " << removed
+			<< ", \"" << inserted << "\") differs from a full parse\n";
+			return 1;
+		}
+	}
+
+	std::cout << numEdits << " edits to " << session.text().size()
+	<< " bytes (" << broken << " left it broken, " << fullParses
+	<< " parsed everything)\n"
+	<< "edit: " << editSecs * 1e6 / static_cast<double>(numEdits)
+	<< " us, " << bytesLexed / numEdits << " bytes lexed\n"
+	<< "tree: " << treeSecs * 1e6 / static_cast<double>(numEdits) << " us\n"
+	<< "full: " << fullSecs * 1e6 / static_cast<double>(numEdits) << " us\n";
+	return 0;
+}
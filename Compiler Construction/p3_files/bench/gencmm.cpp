@@ -0,0 +1,425 @@
+/*
+Writes a synthetic C-- program that follows p2_files/cmm.grammar,
+for benchmarking. The output depends only on the options (the
+random numbers come from our own generator, not <random>), so a
+corpus can be regenerated byte for byte anywhere.
+
+  gencmm [options] [-o <file>]     (stdout without -o)
+    --size <n>[K|M|G]   stop after about this many bytes (64K)
+    --depth <n>         deepest nesting of if/while blocks (3)
+    --exp-depth <n>     deepest nesting of expressions (3)
+    --ids <n>           distinct variable names (1000)
+    --literals <i,s,t,b>  relative weights of int, short, string
+                        and true/false literals (6,2,1,1)
+    --seed <n>          (1)
+
+The programs are syntactically valid; they are not meant to pass
+name analysis or type checking.
+*/
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace {
+
+struct Options{
+	uint64_t size = 64 * 1024;
+	unsigned depth = 3;
+	unsigned expDepth = 3;
+	unsigned ids = 1000;
+	unsigned literalWeights[4] = {6, 2, 1, 1};
+	uint64_t seed = 1;
+	const char * outPath = nullptr;
+};
+
+/* splitmix64: small, fast and the same on every platform */
+class Random{
+public:
+	explicit Random(uint64_t seed) : myState(seed){ }
+	uint64_t next(){
+		uint64_t z = (myState += 0x9E3779B97F4A7C15ull);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+		return z ^ (z >> 31);
+	}
+	/** Uniform in [0, n) **/
+	unsigned below(unsigned n){ return static_cast<unsigned>(next() % n); }
+	bool chance(unsigned percent){ return below(100) < percent; }
+private:
+	uint64_t myState;
+};
+
+class Generator{
+public:
+	Generator(const Options& opts, FILE * out)
+	: myOpts(opts), myOut(out), myRandom(opts.seed), myBytes(0),
+	  myFunctions(0){ }
+	~Generator(){ flush(); }
+
+	void program(){
+		while (myBytes + myBuf.size() < myOpts.size){
+			if (myRandom.chance(25)){
+				varDecl(0);
+			} else {
+				fnDecl();
+			}
+			if (myBuf.size() >= (1 << 20)){ flush(); }
+		}
+	}
+
+private:
+	void flush(){
+		fwrite(myBuf.data(), 1, myBuf.size(), myOut);
+		myBytes += myBuf.size();
+		myBuf.clear();
+	}
+
+	void indent(unsigned level){ myBuf.append(level, '\t'); }
+
+	/* Names look like program variables (count7, buf12, ...)
+	   and never collide with a keyword */
+	void varName(){
+		static const char * const WORDS[] = {
+			"count", "total", "idx", "buf", "tmp", "val", "sum",
+			"flag", "len", "acc", "node", "res", "x", "y", "cur"
+		};
+		const unsigned numWords = sizeof(WORDS) / sizeof(WORDS[0]);
+		unsigned id = myRandom.below(myOpts.ids);
+		myBuf += WORDS[id % numWords];
+		myBuf += std::to_string(id / numWords);
+	}
+
+	void fnName(unsigned fn){
+		myBuf += "fn";
+		myBuf += std::to_string(fn);
+	}
+
+	void type(bool allowVoid){
+		static const char * const PRIMS[] = {
+			"int", "bool", "string", "short", "void"
+		};
+		if (myRandom.chance(10)){ myBuf += "ptr "; }
+		myBuf += PRIMS[myRandom.below(allowVoid ? 5 : 4)];
+	}
+
+	void varDecl(unsigned level){
+		indent(level);
+		type(false);
+		myBuf += ' ';
+		varName();
+		myBuf += ";\n";
+	}
+
+	void fnDecl(){
+		unsigned fn = myFunctions++;
+		type(true);
+		myBuf += ' ';
+		fnName(fn);
+		myBuf += '(';
+		unsigned numFormals = myRandom.below(4);
+		for (unsigned i = 0; i < numFormals; i++){
+			if (i > 0){ myBuf += ", "; }
+			type(false);
+			myBuf += ' ';
+			varName();
+		}
+		myBuf += "){\n";
+		stmtList(1);
+		myBuf += "}\n";
+	}
+
+	void stmtList(unsigned level){
+		unsigned numStmts = 1 + myRandom.below(level == 1 ? 8 : 4);
+		for (unsigned i = 0; i < numStmts; i++){ stmt(level); }
+	}
+
+	void block(unsigned level){
+		myBuf += "{\n";
+		stmtList(level + 1);
+		indent(level);
+		myBuf += '}';
+	}
+
+	void lval(){
+		if (myRandom.chance(10)){ myBuf += '@'; }
+		varName();
+	}
+
+	void stmt(unsigned level){
+		//Blocks only while there is nesting depth left
+		unsigned kinds = level <= myOpts.depth ? 12 : 9;
+		unsigned kind = myRandom.below(kinds);
+		if (kind == 0){
+			varDecl(level);
+			return;
+		}
+		indent(level);
+		switch (kind){
+		case 1: case 2: case 3:
+			lval();
+			myBuf += " = ";
+			exp(0);
+			break;
+		case 4:
+			lval();
+			myBuf += myRandom.chance(50) ? "++" : "--";
+			break;
+		case 5:
+			myBuf += "read ";
+			lval();
+			break;
+		case 6:
+			myBuf += "write ";
+			exp(0);
+			break;
+		case 7:
+			myBuf += "return";
+			if (myRandom.chance(70)){
+				myBuf += ' ';
+				exp(0);
+			}
+			break;
+		case 8:
+			call(0);
+			break;
+		case 9:
+			myBuf += "while (";
+			exp(0);
+			myBuf += ")";
+			block(level);
+			myBuf += '\n';
+			return;
+		default:
+			myBuf += "if (";
+			exp(0);
+			myBuf += ")";
+			block(level);
+			if (kind == 11){
+				myBuf += " else ";
+				block(level);
+			}
+			myBuf += '\n';
+			return;
+		}
+		myBuf += ";\n";
+	}
+
+	void call(unsigned depth){
+		fnName(myFunctions == 0 ? 0 : myRandom.below(myFunctions));
+		myBuf += '(';
+		unsigned numArgs = myRandom.below(4);
+		for (unsigned i = 0; i < numArgs; i++){
+			if (i > 0){ myBuf += ", "; }
+			exp(depth + 1);
+		}
+		myBuf += ')';
+	}
+
+	void literal(){
+		const unsigned * w = myOpts.literalWeights;
+		unsigned pick = myRandom.below(w[0] + w[1] + w[2] + w[3]);
+		if (pick < w[0]){
+			myBuf += std::to_string(myRandom.below(100000));
+		} else if ((pick -= w[0]) < w[1]){
+			myBuf += std::to_string(myRandom.below(32768));
+			myBuf += 'S';
+		} else if ((pick -= w[1]) < w[2]){
+			static const char * const STRINGS[] = {
+				"\"\"", "\"hello\"", "\"a\\tb\"", "\"line\\n\"",
+				"\"say \\\"hi\\\"\"", "\"path\\\\to\""
+			};
+			myBuf += STRINGS[myRandom.below(6)];
+		} else {
+			myBuf += myRandom.chance(50) ? "true" : "false";
+		}
+	}
+
+	void term(unsigned depth){
+		bool leaf = depth >= myOpts.expDepth;
+		switch (myRandom.below(leaf ? 3 : 5)){
+		case 0:
+			lval();
+			break;
+		case 1:
+			literal();
+			break;
+		case 2:
+			if (myRandom.chance(50)){
+				myBuf += '&';
+				varName();
+			} else {
+				literal();
+			}
+			break;
+		case 3:
+			myBuf += '(';
+			exp(depth + 1);
+			myBuf += ')';
+			break;
+		default:
+			call(depth);
+			break;
+		}
+	}
+
+	/* What exp() wrote, as far as the operators around it care */
+	enum Shape { ATOM, OPERATORS, COMPARE };
+
+	/* The comparison operators do not associate (a < b < c is a
+	   syntax error), so anything that could put two of them side
+	   by side gets parenthesized */
+	void operand(unsigned depth, bool compare){
+		size_t start = myBuf.size();
+		Shape shape = exp(depth);
+		if (shape == COMPARE || (compare && shape == OPERATORS)){
+			myBuf.insert(start, 1, '(');
+			myBuf += ')';
+		}
+	}
+
+	Shape exp(unsigned depth){
+		static const char * const OPS[] = {
+			" + ", " - ", " * ", " / ", " and ", " or ", " == ",
+			" != ", " < ", " <= ", " > ", " >= "
+		};
+		const unsigned FIRST_COMPARE = 6;
+		if (depth >= myOpts.expDepth){
+			term(depth);
+			return ATOM;
+		}
+		switch (myRandom.below(8)){
+		case 0: case 1: case 2: {
+			unsigned op = myRandom.below(12);
+			bool compare = op >= FIRST_COMPARE;
+			operand(depth + 1, compare);
+			myBuf += OPS[op];
+			operand(depth + 1, compare);
+			return compare ? COMPARE : OPERATORS;
+		}
+		case 3: {
+			//! binds tighter than anything, so whatever follows
+			// it is still exposed to the operators around it
+			myBuf += '!';
+			Shape shape = exp(depth + 1);
+			return shape == COMPARE ? COMPARE : OPERATORS;
+		}
+		case 4:
+			myBuf += '-';
+			term(depth + 1);
+			return OPERATORS;
+		case 5:
+			//Parenthesized so that the assignment stays one 
+			// operand of whatever operator comes next
+			myBuf += '(';
+			lval();
+			myBuf += " = ";
+			exp(depth + 1);
+			myBuf += ')';
+			return ATOM;
+		default:
+			term(depth);
+			return ATOM;
+		}
+	}
+
+	const Options& myOpts;
+	FILE * myOut;
+	Random myRandom;
+	std::string myBuf;
+	uint64_t myBytes;
+	unsigned myFunctions;
+};
+
+void usage(){
+	fprintf(stderr, "usage: gencmm [--size <n>[K|M|G]] [--depth <n>]"
+		" [--exp-depth <n>] [--ids <n>] [--literals <i,s,t,b>]"
+		" [--seed <n>] [-o <file>]\n");
+}
+
+bool parseSize(const char * text, uint64_t * size){
+	char * end = nullptr;
+	uint64_t n = strtoull(text, &end, 10);
+	switch (*end){
+	case 'K': case 'k': n <<= 10; end++; break;
+	case 'M': case 'm': n <<= 20; end++; break;
+	case 'G': case 'g': n <<= 30; end++; break;
+	default: break;
+	}
+	*size = n;
+	return end != text && *end == '\0';
+}
+
+bool parseCount(const char * text, unsigned * n, unsigned min){
+	char * end = nullptr;
+	unsigned long value = strtoul(text, &end, 10);
+	*n = static_cast<unsigned>(value);
+	return end != text && *end == '\0' && value >= min && value < 1000000000;
+}
+
+bool parseWeights(const char * text, unsigned * weights){
+	unsigned long total = 0;
+	for (int i = 0; i < 4; i++){
+		char * end = nullptr;
+		unsigned long w = strtoul(text, &end, 10);
+		if (end == text || w > 1000){ return false; }
+		if (*end != (i < 3 ? ',' : '\0')){ return false; }
+		weights[i] = static_cast<unsigned>(w);
+		total += w;
+		text = end + 1;
+	}
+	return total > 0;
+}
+
+} //End anonymous namespace
+
+int main(int argc, char ** argv){
+	Options opts;
+	bool ok = true;
+	for (int i = 1; ok && i < argc; i++){
+		const char * arg = argv[i];
+		const char * value = i + 1 < argc ? argv[i + 1] : nullptr;
+		if (value == nullptr){
+			ok = false;
+		} else if (strcmp(arg, "--size") == 0){
+			ok = parseSize(value, &opts.size);
+		} else if (strcmp(arg, "--depth") == 0){
+			ok = parseCount(value, &opts.depth, 0);
+		} else if (strcmp(arg, "--exp-depth") == 0){
+			ok = parseCount(value, &opts.expDepth, 0);
+		} else if (strcmp(arg, "--ids") == 0){
+			ok = parseCount(value, &opts.ids, 1);
+		} else if (strcmp(arg, "--literals") == 0){
+			ok = parseWeights(value, opts.literalWeights);
+		} else if (strcmp(arg, "--seed") == 0){
+			char * end = nullptr;
+			opts.seed = strtoull(value, &end, 10);
+			ok = end != value && *end == '\0';
+		} else if (strcmp(arg, "-o") == 0){
+			opts.outPath = value;
+		} else {
+			ok = false;
+		}
+		i++;
+	}
+	if (!ok){
+		usage();
+		return 1;
+	}
+
+	FILE * out = stdout;
+	if (opts.outPath != nullptr){
+		out = fopen(opts.outPath, "wb");
+		if (out == nullptr){
+			perror(opts.outPath);
+			return 1;
+		}
+	}
+	{
+		Generator gen(opts, out);
+		gen.program();
+	}
+	if (out != stdout){ fclose(out); }
+	return 0;
+}
@@ -0,0 +1,81 @@
+/*
+Measures the input stage that feeds flex's buffer refills:
+  - before: std::ifstream read through istream::read in
+    16 KB blocks (what yyFlexLexer::LexerInput does)
+  - after: SourceFile (mmap) handed over in 1 MB memcpy blocks
+    (what Scanner::LexerInput does now)
+Reports MB/s for each over a generated C-- file.
+*/
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include "source.hpp"
+
+static void generate(const char * path, size_t bytes){
+	std::ofstream out(path);
+	size_t written = 0;
+	size_t i = 0;
+	while (written < bytes){
+		std::string line = "int global_variable_" + std::to_string(i++)
+		  + ";   # a comment\n";
+		out << line;
+		written += line.size();
+	}
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point start){
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double>(end - start).count();
+}
+
+int main(int argc, char ** argv){
+	size_t mb = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 64;
+	const char * path = "generated_input.cmm";
+	generate(path, mb << 20);
+
+	std::vector<char> flexBuf(1 << 20);
+	unsigned long sum = 0;
+
+	auto t0 = std::chrono::steady_clock::now();
+	size_t total = 0;
+	{
+		std::ifstream in(path);
+		while (true){
+			in.read(flexBuf.data(), 16384);
+			std::streamsize got = in.gcount();
+			if (got <= 0){ break; }
+			total += static_cast<size_t>(got);
+			sum += static_cast<unsigned char>(flexBuf[0]);
+		}
+	}
+	double streamSecs = secondsSince(t0);
+
+	t0 = std::chrono::steady_clock::now();
+	size_t totalMapped = 0;
+	{
+		cminusminus::SourceFile * src = cminusminus::SourceFile::open(path);
+		size_t off = 0;
+		while (off < src->size()){
+			size_t n = src->size() - off;
+			if (n > flexBuf.size()){ n = flexBuf.size(); }
+			std::memcpy(flexBuf.data(), src->data() + off, n);
+			off += n;
+			sum += static_cast<unsigned char>(flexBuf[0]);
+		}
+		totalMapped = off;
+		delete src;
+	}
+	double mapSecs = secondsSince(t0);
+
+	double size = static_cast<double>(total) / (1 << 20);
+	std::cout << "input " << size << " MB (checksum " << sum << ")\n";
+	std::cout << "ifstream 16KB reads: " << size / streamSecs << " MB/s\n";
+	std::cout << "SourceFile 1MB blocks: "
+	  << static_cast<double>(totalMapped) / (1 << 20) / mapSecs << " MB/s\n";
+	std::remove(path);
+	return 0;
+}
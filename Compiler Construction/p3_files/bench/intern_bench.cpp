@@ -0,0 +1,114 @@
+/*
+Compares the cost of carrying identifiers around as std::string
+copies (what IDToken/IDNode used to do) against interning them
+into Symbols. Generates a file of N identifiers drawn from a
+few thousand distinct names, then for each identifier:
+  - before: copies the text into a "token" string and again
+    into a "node" string, then compares it with the previous id
+  - after: interns the text once and compares Symbol handles
+Allocations are counted by replacing the global operator new.
+*/
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "symbol.hpp"
+
+static size_t allocCount = 0;
+
+void * operator new(size_t size){
+	allocCount++;
+	void * p = std::malloc(size == 0 ? 1 : size);
+	if (p == nullptr){ throw std::bad_alloc(); }
+	return p;
+}
+void operator delete(void * p) noexcept { std::free(p); }
+void operator delete(void * p, size_t) noexcept { std::free(p); }
+
+static void generate(const char * path, size_t count, size_t distinct){
+	std::ofstream out(path);
+	unsigned long long seed = 12345;
+	for (size_t i = 0; i < count; i++){
+		seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+		size_t which = static_cast<size_t>(seed >> 33) % distinct;
+		//Long enough to defeat the small-string optimization
+		out << "identifier_number_" << which << "\n";
+	}
+}
+
+static double msSince(std::chrono::steady_clock::time_point start){
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+int main(int argc, char ** argv){
+	size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+	size_t distinct = 4000;
+	const char * path = "generated.ids";
+	generate(path, count, distinct);
+
+	std::ifstream in(path);
+	std::stringstream buf;
+	buf << in.rdbuf();
+	std::string text = buf.str();
+	std::vector<std::pair<const char *, size_t>> ids;
+	ids.reserve(count);
+	size_t start = 0;
+	for (size_t i = 0; i < text.size(); i++){
+		if (text[i] == '\n'){
+			ids.emplace_back(text.data() + start, i - start);
+			start = i + 1;
+		}
+	}
+
+	size_t equal = 0;
+	size_t before = allocCount;
+	auto t0 = std::chrono::steady_clock::now();
+	{
+		std::vector<std::string> nodes;
+		nodes.reserve(ids.size());
+		for (auto& id : ids){
+			std::string tokenVal(id.first, id.second);
+			nodes.push_back(tokenVal);
+			if (nodes.size() > 1 && nodes.back() == nodes[nodes.size() - 2]){
+				equal++;
+			}
+		}
+	}
+	double strMs = msSince(t0);
+	size_t strAllocs = allocCount - before;
+
+	size_t equalSym = 0;
+	before = allocCount;
+	t0 = std::chrono::steady_clock::now();
+	{
+		std::vector<cminusminus::Symbol> nodes;
+		nodes.reserve(ids.size());
+		cminusminus::Interner& interner = cminusminus::Interner::global();
+		for (auto& id : ids){
+			nodes.push_back(interner.intern(id.first, id.second));
+			if (nodes.size() > 1 && nodes.back() == nodes[nodes.size() - 2]){
+				equalSym++;
+			}
+		}
+	}
+	double symMs = msSince(t0);
+	size_t symAllocs = allocCount - before;
+
+	std::cout << count << " identifiers, " << distinct << " distinct\n";
+	std::cout << "std::string copies: " << strMs << " ms, "
+	  << strAllocs << " allocations\n";
+	std::cout << "interned Symbols:   " << symMs << " ms, "
+	  << symAllocs << " allocations\n";
+	if (equal != equalSym){
+		std::cerr << "Mismatch in equality results\n";
+		return 1;
+	}
+	std::remove(path);
+	return 0;
+}
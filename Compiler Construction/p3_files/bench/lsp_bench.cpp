@@ -0,0 +1,285 @@
+/*
+Runs ../cmmc --lsp as an editor would and times its answers:
+  - didOpen of a C-- file, until its diagnostics come back
+  - documentSymbol
+  - definition at random places in the file, checking that each
+    answer points at a declaration of the same name
+  - the same definitions again while the file is being typed
+    into (a didChange per key, each followed by a query), which
+    keeps the server reparsing in the background
+First, an edit that once got false diagnostics is checked.
+Reports the time to the first diagnostics and the mean and
+worst time for each kind of query.
+
+  lsp_bench <file.cmm> [queries, 1000 by default]
+*/
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "json.hpp"
+
+using namespace cminusminus;
+
+typedef std::chrono::steady_clock Clock;
+
+static double msBetween(Clock::time_point start, Clock::time_point end){
+	return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+static int toServer = -1;
+static int fromServer = -1;
+static std::string inBuf;
+/* When the last bytes came in, so that timings leave out the
+   bench's own parse of big answers */
+static Clock::time_point arrived;
+
+static void sendMessage(const std::string& body){
+	std::string msg = "Content-Length: " + std::to_string(body.size())
+	  + "\r\n\r\n" + body;
+	const char * at = msg.data();
+	size_t left = msg.size();
+	while (left > 0){
+		ssize_t put = ::write(toServer, at, left);
+		if (put <= 0){
+			std::cerr << "lost the server\n";
+			std::exit(1);
+		}
+		at += put;
+		left -= static_cast<size_t>(put);
+	}
+}
+
+static JsonValue readMessage(){
+	while (true){
+		size_t headEnd = inBuf.find("\r\n\r\n");
+		if (headEnd != std::string::npos){
+			size_t length = std::strtoul(inBuf.c_str() + 16, nullptr, 10);
+			if (inBuf.size() >= headEnd + 4 + length){
+				JsonValue msg;
+				JsonValue::parse(inBuf.data() + headEnd + 4, length, msg);
+				inBuf.erase(0, headEnd + 4 + length);
+				return msg;
+			}
+		}
+		char buf[1 << 16];
+		ssize_t got = ::read(fromServer, buf, sizeof(buf));
+		if (got <= 0){
+			std::cerr << "lost the server\n";
+			std::exit(1);
+		}
+		inBuf.append(buf, static_cast<size_t>(got));
+		arrived = Clock::now();
+	}
+}
+
+static int nextId = 1;
+
+/* Send a request and wait for its answer, skipping any
+   notifications that come first */
+static JsonValue request(const std::string& method, const std::string& params){
+	int id = nextId++;
+	sendMessage("{\"jsonrpc\":\"2.0\",\"id\":" + std::to_string(id)
+		+ ",\"method\":\"" + method + "\",\"params\":" + params + "}");
+	while (true){
+		JsonValue msg = readMessage();
+		if (msg["id"].num() == id){ return msg["result"]; }
+	}
+}
+
+static void notify(const std::string& method, const std::string& params){
+	sendMessage("{\"jsonrpc\":\"2.0\",\"method\":\"" + method
+		+ "\",\"params\":" + params + "}");
+}
+
+static std::string quoted(const std::string& s){
+	std::ostringstream out;
+	putJsonString(out, s);
+	return out.str();
+}
+
+/* The diagnostics for uri once the server has caught up with
+   version, skipping any other messages */
+static JsonValue diagnostics(const std::string& uri, int version){
+	while (true){
+		JsonValue msg = readMessage();
+		if (msg["method"].str() == "textDocument/publishDiagnostics"
+		  && msg["params"]["uri"].str() == uri
+		  && msg["params"]["version"].num() >= version){
+			return msg["params"]["diagnostics"];
+		}
+	}
+}
+
+static bool isNameChar(char c){
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')
+	  || (c >= '0' && c <= '9') || c == '_';
+}
+
+static size_t offsetOf(const std::vector<size_t>& lineStarts,
+  const JsonValue& pos){
+	return lineStarts[static_cast<size_t>(pos["line"].num())]
+	  + static_cast<size_t>(pos["character"].num());
+}
+
+struct Timing{
+	double total = 0;
+	double worst = 0;
+	size_t count = 0;
+	void add(double ms){
+		total += ms;
+		worst = std::max(worst, ms);
+		count++;
+	}
+};
+
+static void report(const char * what, const Timing& t){
+	std::cout << what << ": " << t.total / static_cast<double>(t.count)
+	<< " ms mean, " << t.worst << " ms worst (" << t.count << ")\n";
+}
+
+int main(int argc, char ** argv){
+	if (argc < 2){
+		std::cerr << "usage: lsp_bench <file.cmm> [queries]\n";
+		return 1;
+	}
+	std::ifstream in(argv[1]);
+	std::ostringstream textStream;
+	textStream << in.rdbuf();
+	std::string text = textStream.str();
+	size_t queries = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 1000;
+	std::vector<size_t> lineStarts(1, 0);
+	for (size_t i = 0; i < text.size(); i++){
+		if (text[i] == '\n'){ lineStarts.push_back(i + 1); }
+	}
+
+	int toPipe[2];
+	int fromPipe[2];
+	if (::pipe(toPipe) != 0 || ::pipe(fromPipe) != 0){ return 1; }
+	pid_t child = ::fork();
+	if (child == 0){
+		::dup2(toPipe[0], 0);
+		::dup2(fromPipe[1], 1);
+		::close(toPipe[1]);
+		::close(fromPipe[0]);
+		::execl("../cmmc", "cmmc", "--lsp", static_cast<char *>(nullptr));
+		std::exit(127);
+	}
+	::close(toPipe[0]);
+	::close(fromPipe[1]);
+	toServer = toPipe[1];
+	fromServer = fromPipe[0];
+
+	const std::string uri = "file:///bench.cmm";
+	const std::string doc = "{\"textDocument\":{\"uri\":\"" + uri + "\"}}";
+	request("initialize", "{\"processId\":null,\"capabilities\":{}}");
+	notify("initialized", "{}");
+
+	//A space typed before a semicolon on a line of its own once
+	// got a syntax error that the text does not have
+	const std::string split = "file:///split.cmm";
+	notify("textDocument/didOpen", "{\"textDocument\":{\"uri\":\"" + split
+		+ "\",\"languageId\":\"cmm\",\"version\":1,\"text\":"
+		+ quoted("int x\n;\nint y;\n") + "}}");
+	diagnostics(split, 1);
+	notify("textDocument/didChange", "{\"textDocument\":{\"uri\":\""
+		+ split + "\",\"version\":2},\"contentChanges\":[{\"range\":"
+		+ "{\"start\":{\"line\":1,\"character\":0},\"end\":{\"line\":1,"
+		+ "\"character\":0}},\"text\":\" \"}]}");
+	if (diagnostics(split, 2).size() != 0){
+		std::cerr << "false diagnostics after an edit to a declaration"
+		<< " split across lines\n";
+		return 1;
+	}
+	notify("textDocument/didClose", "{\"textDocument\":{\"uri\":\""
+		+ split + "\"}}");
+
+	auto t0 = Clock::now();
+	notify("textDocument/didOpen", "{\"textDocument\":{\"uri\":\"" + uri
+		+ "\",\"languageId\":\"cmm\",\"version\":1,\"text\":"
+		+ quoted(text) + "}}");
+	diagnostics(uri, 1);
+	double openMs = msBetween(t0, arrived);
+
+	Timing symbols;
+	size_t numSymbols = 0;
+	for (int i = 0; i < 10; i++){
+		t0 = Clock::now();
+		JsonValue result = request("textDocument/documentSymbol", doc);
+		symbols.add(msBetween(t0, arrived));
+		numSymbols = result.size();
+	}
+
+	//Definitions, checked; then again while the text changes
+	unsigned long long rng = 1;
+	Timing quiet;
+	Timing typing;
+	size_t found = 0;
+	int version = 1;
+	for (size_t q = 0; q < 2 * queries; q++){
+		bool busy = q >= queries;
+		if (busy){
+			//Type a comment line in at the top, a key at a time
+			const char * keys = "# typed\n";
+			size_t k = q - queries;
+			char key = keys[k % 8];
+			size_t line = 1 + k / 8;
+			size_t ch = k % 8;
+			notify("textDocument/didChange", "{\"textDocument\":{\"uri\":\""
+				+ uri + "\",\"version\":" + std::to_string(++version)
+				+ "},\"contentChanges\":[{\"range\":{\"start\":{\"line\":"
+				+ std::to_string(line) + ",\"character\":" + std::to_string(ch)
+				+ "},\"end\":{\"line\":" + std::to_string(line)
+				+ ",\"character\":" + std::to_string(ch) + "}},\"text\":"
+				+ quoted(std::string(1, key)) + "}]}");
+		}
+		rng = rng * 6364136223846793005ULL + 1442695040888963407ULL;
+		size_t line = static_cast<size_t>((rng >> 33) % lineStarts.size());
+		size_t lineEnd = line + 1 < lineStarts.size() ? lineStarts[line + 1] : text.size();
+		size_t ch = static_cast<size_t>((rng >> 13) % (lineEnd - lineStarts[line] + 1));
+		t0 = Clock::now();
+		JsonValue result = request("textDocument/definition",
+			"{\"textDocument\":{\"uri\":\"" + uri + "\"},\"position\":{\"line\":"
+			+ std::to_string(line) + ",\"character\":" + std::to_string(ch) + "}}");
+		(busy ? typing : quiet).add(msBetween(t0, arrived));
+		if (busy || result.isNull()){ continue; }
+
+		//The name under the cursor and the declared name match
+		size_t at = lineStarts[line] + ch;
+		size_t start = at;
+		while (start > 0 && isNameChar(text[start - 1])){ start--; }
+		size_t end = at;
+		while (end < text.size() && isNameChar(text[end])){ end++; }
+		size_t declStart = offsetOf(lineStarts, result["range"]["start"]);
+		size_t declEnd = offsetOf(lineStarts, result["range"]["end"]);
+		if (text.compare(start, end - start, text, declStart,
+		  declEnd - declStart) != 0){
+			std::cerr << "definition at " << line << ":" << ch
+			<< " points at the wrong name\n";
+			return 1;
+		}
+		found++;
+	}
+
+	request("shutdown", "null");
+	notify("exit", "null");
+	int status = 0;
+	::waitpid(child, &status, 0);
+
+	std::cout << text.size() << " bytes, " << lineStarts.size() << " lines, "
+	<< numSymbols << " globals\n"
+	<< "open to diagnostics: " << openMs << " ms\n";
+	report("documentSymbol", symbols);
+	report("definition", quiet);
+	report("definition while typing", typing);
+	std::cout << found << " of " << queries << " quiet definitions found a"
+	<< " declaration; server exit status " << WEXITSTATUS(status) << "\n";
+	return WEXITSTATUS(status) == 0 ? 0 : 1;
+}
@@ -0,0 +1,183 @@
+/*
+Times name and type analysis (cmmc -n, -c), lowering to
+three-address code (cmmc -a) and x86-64 code generation (cmmc -o)
+on generated programs that grow two ways: more globals (each
+function uses globals declared anywhere above it), and deeper
+nesting (one function of nested while loops, each with a local,
+using names from the top, the middle and the bottom of the scopes
+around it). If the passes are linear, the time per name stays
+flat as either doubles. Each program is also checked: the clean
+ones must have no errors (of names or of types), and a copy with
+some names misspelled must report exactly those.
+
+  name_bench [max globals, 200000 by default] [max depth, 8000]
+*/
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include "errors.hpp"
+#include "incremental.hpp"
+#include "ir.hpp"
+#include "symtable.hpp"
+#include "types.hpp"
+#include "x64.hpp"
+
+using namespace cminusminus;
+
+static double secondsSince(std::chrono::steady_clock::time_point start){
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double>(end - start).count();
+}
+
+static unsigned long long rngState = 1;
+
+static size_t pick(size_t n){
+	rngState = rngState * 6364136223846793005ULL + 1442695040888963407ULL;
+	return n == 0 ? 0 : static_cast<size_t>((rngState >> 33) % n);
+}
+
+/* A program being generated, and how many names it uses */
+struct Program{
+	std::string text;
+	size_t names = 0;
+	size_t misspelled = 0;
+};
+
+/* Every misspellth name use (0 for none) is of a name that was
+   never declared */
+static std::string use(Program& prog, const std::string& name,
+  size_t misspell){
+	prog.names++;
+	if (misspell != 0 && prog.names % misspell == 0){
+		prog.misspelled++;
+		return name + "_x";
+	}
+	return name;
+}
+
+static Program wide(size_t globals, size_t misspell){
+	Program prog;
+	std::string& t = prog.text;
+	size_t fns = 0;
+	for (size_t i = 0; i < globals; i++){
+		std::string g = "g" + std::to_string(i);
+		t += "int " + g + ";\n";
+		prog.names++;
+		if (i % 10 != 9){ continue; }
+		std::string f = "f" + std::to_string(fns);
+		t += "void " + f + "(int a){\n\tint x;\n\tx = "
+		  + use(prog, "a", misspell) + " + "
+		  + use(prog, "g" + std::to_string(pick(i + 1)), misspell)
+		  + ";\n\t" + use(prog, "g" + std::to_string(pick(i + 1)), misspell)
+		  + " = " + use(prog, "x", misspell) + " * "
+		  + use(prog, "g" + std::to_string(pick(i + 1)), misspell) + ";\n\t"
+		  + use(prog, "f" + std::to_string(pick(fns + 1)), misspell) + "("
+		  + use(prog, "x", misspell) + ");\n}\n";
+		prog.names += 3;
+		fns++;
+	}
+	return prog;
+}
+
+static Program deep(size_t depth, size_t misspell){
+	Program prog;
+	std::string& t = prog.text;
+	t += "int g;\nvoid f(int a){\n";
+	prog.names += 3;
+	for (size_t i = 0; i < depth; i++){
+		std::string v = "v" + std::to_string(i);
+		t += "while (" + use(prog, "a", misspell) + " > " + std::to_string(i)
+		  + "){ int " + v + "; " + use(prog, v, misspell) + " = "
+		  + use(prog, "g", misspell) + " + "
+		  + use(prog, "v" + std::to_string(i / 2), misspell) + ";\n";
+		prog.names++;
+	}
+	t += std::string(depth, '}') + "\n}\n";
+	return prog;
+}
+
+/* Parse prog and time name analysis over it, and then (if the
+   names were all good) type analysis, lowering and code
+   generation. Returns the
+   number of errors reported, or -1 if it did not parse */
+static long analyze(const Program& prog, const char * what, size_t size){
+	IncrementalParser parser;
+	parser.reset(prog.text);
+	ProgramNode * ast = parser.program();
+	if (ast == nullptr){
+		std::cerr << what << " " << size << " did not parse\n"
+		<< parser.syntaxOutput() << parser.errors();
+		return -1;
+	}
+	std::ostringstream errs;
+	std::ostream * oldSink = Report::redirect(&errs);
+	SymbolTable symTab;
+	auto start = std::chrono::steady_clock::now();
+	bool named = ast->nameAnalysis(&symTab);
+	double secs = secondsSince(start);
+	double typeSecs = 0;
+	double lowerSecs = 0;
+	double codegenSecs = 0;
+	size_t instrs = 0;
+	if (named){
+		TypeAnalysis types;
+		start = std::chrono::steady_clock::now();
+		ast->typeAnalysis(&types);
+		typeSecs = secondsSince(start);
+		IRProgram prog;
+		IRBuilder ir(prog, symTab.size());
+		start = std::chrono::steady_clock::now();
+		ast->lower(ir);
+		lowerSecs = secondsSince(start);
+		for (const IRFunction& fn : prog.functions){ instrs += fn.code.size(); }
+		std::ostringstream assembly;
+		start = std::chrono::steady_clock::now();
+		X64Writer(prog, assembly).write();
+		codegenSecs = secondsSince(start);
+	}
+	Report::redirect(oldSink);
+	long errors = 0;
+	for (char c : errs.str()){ errors += c == '\n'; }
+	if (prog.misspelled == 0){
+		double names = static_cast<double>(prog.names);
+		std::cout << what << " " << size << ": " << prog.names << " names, "
+		<< secs * 1000 << " ms, " << secs * 1e9 / names << " ns/name; types "
+		<< typeSecs * 1000 << " ms, " << typeSecs * 1e9 / names
+		<< " ns/name; lowering " << lowerSecs * 1000 << " ms, "
+		<< lowerSecs * 1e9 / names << " ns/name (" << instrs
+		<< " instructions); codegen " << codegenSecs * 1000 << " ms, "
+		<< codegenSecs * 1e9 / static_cast<double>(instrs) << " ns/instruction\n";
+	}
+	return errors;
+}
+
+static bool check(const Program& clean, const Program& bad,
+  const char * what, size_t size){
+	long cleanErrors = analyze(clean, what, size);
+	long badErrors = analyze(bad, what, size);
+	if (cleanErrors != 0 || badErrors != static_cast<long>(bad.misspelled)){
+		std::cerr << what << " " << size << ": " << cleanErrors
+		<< " errors in the clean program, " << badErrors << " of "
+		<< bad.misspelled << " in the misspelled one\n";
+		return false;
+	}
+	return true;
+}
+
+int main(int argc, char ** argv){
+	size_t maxGlobals = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+	size_t maxDepth = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 8000;
+	bool ok = true;
+	for (size_t n = maxGlobals / 8; ok && n <= maxGlobals; n *= 2){
+		rngState = n;
+		Program clean = wide(n, 0);
+		rngState = n;
+		ok = check(clean, wide(n, 97), "globals", n);
+	}
+	for (size_t d = maxDepth / 8; ok && d <= maxDepth; d *= 2){
+		ok = check(deep(d, 0), deep(d, 31), "depth", d);
+	}
+	return ok ? 0 : 1;
+}
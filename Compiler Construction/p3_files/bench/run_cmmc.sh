@@ -0,0 +1,58 @@
+#!/bin/sh
+# Runs cmmc -t, -p and -u over each C-- file named on the command
+# line and writes what it measured as JSON to $RESULTS (default
+# results.json): for each file and mode, the input size, the wall
+# time and throughput of the whole run, the peak RSS, and the
+# per-phase --stats-json numbers. CMMC names the compiler to run
+# (default ../cmmc). Files are made by gencmm; see the Makefile.
+CMMC=${CMMC:-../cmmc}
+RESULTS=${RESULTS:-results.json}
+SCRATCH=${TMPDIR:-/tmp}/cmmc_bench.$$
+
+if [ $# -eq 0 ]; then
+	echo "usage: $0 <file.cmm>..." >&2
+	exit 1
+fi
+
+status=0
+sep=""
+{
+	echo "{\"benchVersion\": 1, \"cmmc\": \"$CMMC\", \"runs\": ["
+	for input in "$@"; do
+		bytes=$(wc -c < "$input")
+		for mode in -t -p -u; do
+			# -p takes the argument after it, so it goes last
+			case $mode in
+			-p) args="--stats-json $SCRATCH.json -p" ;;
+			*) args="$mode $SCRATCH.out --stats-json $SCRATCH.json" ;;
+			esac
+			start=$(date +%s.%N)
+			if ! $CMMC "$input" $args > /dev/null 2> "$SCRATCH.err"; then
+				echo "$input $mode: cmmc failed:" >&2
+				cat "$SCRATCH.err" >&2
+				status=1
+				continue
+			fi
+			end=$(date +%s.%N)
+			# The stats document holds one file, on its second line
+			stats=$(sed -n '2s/^ *//p' "$SCRATCH.json")
+			rss=$(echo "$stats" | sed -n 's/.*"peakRssKB": \([0-9]*\).*/\1/p')
+			echo "$start $end $bytes" | awk -v sep="$sep" \
+			  -v input="$input" -v mode="$mode" -v rss="$rss" '{
+				secs = $2 - $1
+				printf "%s  {\"input\": \"%s\", \"bytes\": %d, \"mode\": \"%s\", ", \
+				  sep, input, $3, mode
+				printf "\"wallMs\": %.3f, \"mbPerSec\": %.2f, \"peakRssKB\": %d, ", \
+				  secs * 1e3, $3 / 1048576 / secs, rss
+			}'
+			echo "\"stats\": $stats}"
+			echo "$input $mode: $(echo "$start $end $bytes" | \
+				awk '{ printf "%.1f MB/s", $3 / 1048576 / ($2 - $1) }'), \
+$rss KB peak" >&2
+			sep=","
+		done
+	done
+	echo "]}"
+} > "$RESULTS"
+rm -f "$SCRATCH.out" "$SCRATCH.json" "$SCRATCH.err"
+exit $status
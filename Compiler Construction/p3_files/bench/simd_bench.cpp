@@ -0,0 +1,95 @@
+/*
+Bytes per cycle for the scanner's run-length helpers in simdscan,
+scalar vs SSE2 vs AVX2, on runs of several lengths. Also checks
+every vector version against the scalar one on random input.
+*/
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <x86intrin.h>
+#include "simdscan.hpp"
+
+using namespace cminusminus;
+typedef size_t (*RunFn)(const char *, size_t);
+
+/* A buffer of runs of the given length, each ended by a stop byte */
+static std::string makeRuns(char fill, size_t runLen, size_t total){
+	std::string s;
+	while (s.size() < total){
+		s.append(runLen, fill);
+		s.push_back(';');
+	}
+	return s;
+}
+
+static double bytesPerCycle(RunFn fn, const std::string& buf){
+	const char * p = buf.data();
+	size_t n = buf.size();
+	size_t sink = 0;
+	unsigned long long best = ~0ULL;
+	for (int rep = 0; rep < 5; rep++){
+		unsigned long long t0 = __rdtsc();
+		size_t i = 0;
+		while (i < n){
+			size_t run = fn(p + i, n - i);
+			sink += run;
+			i += run + 1;
+		}
+		unsigned long long t = __rdtsc() - t0;
+		if (t < best){ best = t; }
+	}
+	if (sink == 0){ std::cerr << ""; }
+	return static_cast<double>(n) / static_cast<double>(best);
+}
+
+static bool verify(){
+	const char pool[] = " \t_aZz09@[`{/:\n\x80\xff";
+	std::string s(4096, ' ');
+	srand(1);
+	for (int trial = 0; trial < 2000; trial++){
+		for (auto& c : s){
+			c = rand() % 4 == 0 ? pool[rand() % (sizeof(pool) - 1)]
+			  : (rand() % 2 ? ' ' : 'a');
+		}
+		size_t off = static_cast<size_t>(rand() % 64);
+		size_t n = static_cast<size_t>(rand() % 4000);
+		const char * p = s.data() + off;
+		size_t b = simd::blankRunScalar(p, n);
+		size_t d = simd::idContRunScalar(p, n);
+		if (simd::blankRunSse2(p, n) != b || simd::idContRunSse2(p, n) != d
+		  || simd::blankRun(p, n) != b || simd::idContRun(p, n) != d){
+			return false;
+		}
+		if (simd::haveAvx2() && (simd::blankRunAvx2(p, n) != b
+		  || simd::idContRunAvx2(p, n) != d)){
+			return false;
+		}
+	}
+	return true;
+}
+
+int main(){
+	if (!verify()){
+		std::cerr << "Vector run lengths differ from scalar\n";
+		return 1;
+	}
+	const size_t total = 16 << 20;
+	size_t lens[] = {4, 8, 16, 64, 256};
+	std::cout << "bytes/cycle       scalar    sse2    avx2    dispatched\n";
+	for (size_t len : lens){
+		std::string blanks = makeRuns(' ', len, total);
+		std::string ids = makeRuns('x', len, total);
+		std::cout << "blank run " << len << ":\t"
+		  << bytesPerCycle(simd::blankRunScalar, blanks) << "\t"
+		  << bytesPerCycle(simd::blankRunSse2, blanks) << "\t"
+		  << (simd::haveAvx2() ? bytesPerCycle(simd::blankRunAvx2, blanks) : 0)
+		  << "\t" << bytesPerCycle(simd::blankRun, blanks) << "\n";
+		std::cout << "id run " << len << ":\t"
+		  << bytesPerCycle(simd::idContRunScalar, ids) << "\t"
+		  << bytesPerCycle(simd::idContRunSse2, ids) << "\t"
+		  << (simd::haveAvx2() ? bytesPerCycle(simd::idContRunAvx2, ids) : 0)
+		  << "\t" << bytesPerCycle(simd::idContRun, ids) << "\n";
+	}
+	return 0;
+}
@@ -0,0 +1,77 @@
+/*
+Writes the same token sequence in -t format two ways:
+  - before: Token::toString() << std::endl per token
+  - after: TokenWriter, one buffered write per megabyte
+Checks that both outputs are byte-identical and reports MB/s.
+*/
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include "arena.hpp"
+#include "grammar.hh"
+#include "tokenwriter.hpp"
+
+using namespace cminusminus;
+using TokenKind = cminusminus::Parser::token;
+
+static double secondsSince(std::chrono::steady_clock::time_point start){
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double>(end - start).count();
+}
+
+int main(int argc, char ** argv){
+	size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2000000;
+	Arena arena;
+	std::vector<Token *> toks;
+	toks.reserve(count);
+	Interner& names = Interner::global();
+	size_t line = 1;
+	size_t col = 1;
+	for (size_t i = 0; i < count; i++){
+		Position pos(line, col, line, col + 4);
+		switch (i % 6){
+		case 0: toks.push_back(arena.make<Token>(pos, TokenKind::INT)); break;
+		case 1: toks.push_back(arena.make<IDToken>(pos,
+			names.intern("name_" + std::to_string(i % 5000)))); break;
+		case 2: toks.push_back(arena.make<Token>(pos, TokenKind::ASSIGN)); break;
+		case 3: toks.push_back(arena.make<IntLitToken>(pos,
+			static_cast<int>(i))); break;
+		case 4: toks.push_back(arena.make<StrToken>(pos,
+			std::string("\"hello\""))); break;
+		default: toks.push_back(arena.make<Token>(pos, TokenKind::SEMICOL));
+			line++; col = 0; break;
+		}
+		col += 5;
+	}
+
+	std::ostringstream before;
+	auto t0 = std::chrono::steady_clock::now();
+	for (auto tok : toks){
+		before << tok->toString() << std::endl;
+	}
+	before << "EOF [" << line << "," << col << "]" << std::endl;
+	double beforeSecs = secondsSince(t0);
+
+	std::ostringstream after;
+	t0 = std::chrono::steady_clock::now();
+	{
+		TokenWriter writer(after);
+		for (auto tok : toks){
+			writer.write(tok);
+		}
+		writer.writeEOF(line, col);
+	}
+	double afterSecs = secondsSince(t0);
+
+	if (before.str() != after.str()){
+		std::cerr << "Token outputs differ\n";
+		return 1;
+	}
+	double mb = static_cast<double>(after.str().size()) / (1 << 20);
+	std::cout << count << " tokens, " << mb << " MB of -t output\n";
+	std::cout << "toString + endl: " << mb / beforeSecs << " MB/s\n";
+	std::cout << "TokenWriter:     " << mb / afterSecs << " MB/s\n";
+	return 0;
+}
@@ -0,0 +1,128 @@
+/*
+Builds a large, deeply nested program (N functions, 20000 by
+default, each a nest of DEPTH while/if blocks, 8 by default,
+with assignments of nested expressions at every level) and
+unparses it:
+  - to a file with write(2), as -u <file> does
+  - to an std::ofstream, as -u -- does for std::cout
+Checks that both outputs are byte-identical and reports MB/s.
+*/
+#include <fcntl.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include "ast.hpp"
+
+using namespace cminusminus;
+
+static double secondsSince(std::chrono::steady_clock::time_point start){
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double>(end - start).count();
+}
+
+static const Position POS(1, 1, 1, 2);
+
+static IDNode * makeId(Arena * arena, size_t n){
+	return arena->make<IDNode>(POS, Interner::global().intern(
+		"v" + std::to_string(n % 1000)));
+}
+
+/* A full tree of + and * over names and ints, depth levels deep */
+static ExpNode * makeExp(Arena * arena, size_t n, int depth){
+	if (depth == 0){
+		if (n % 2 == 0){ return makeId(arena, n); }
+		return arena->make<IntLitNode>(POS, static_cast<int>(n));
+	}
+	ExpNode * lhs = makeExp(arena, n * 3 + 1, depth - 1);
+	ExpNode * rhs = makeExp(arena, n * 3 + 2, depth - 1);
+	if (depth % 2 == 0){ return arena->make<TimesNode>(POS, lhs, rhs); }
+	return arena->make<PlusNode>(POS, lhs, rhs);
+}
+
+static StmtNode * makeAssign(Arena * arena, size_t n){
+	auto exp = arena->make<AssignExpNode>(POS, makeId(arena, n),
+		makeExp(arena, n, 3));
+	return arena->make<AssignStmtNode>(POS, exp);
+}
+
+static NodeList<StmtNode> * makeBody(Arena * arena, size_t n, int depth){
+	auto body = arena->make<NodeList<StmtNode>>(arena);
+	body->push_back(makeAssign(arena, n));
+	if (depth > 0){
+		NodeList<StmtNode> * inner = makeBody(arena, n + 1, depth - 1);
+		ExpNode * cond = makeId(arena, n);
+		if (depth % 2 == 0){
+			body->push_back(arena->make<WhileStmtNode>(POS, cond, inner));
+		} else {
+			body->push_back(arena->make<IfStmtNode>(POS, cond, inner));
+		}
+	}
+	body->push_back(makeAssign(arena, n + 2));
+	return body;
+}
+
+int main(int argc, char ** argv){
+	size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20000;
+	int depth = argc > 2 ? std::atoi(argv[2]) : 8;
+	Arena * arena = new Arena();
+	auto globals = arena->make<NodeList<DeclNode>>(arena);
+	for (size_t i = 0; i < count; i++){
+		auto formals = arena->make<NodeList<FormalDeclNode>>(arena);
+		formals->push_back(arena->make<FormalDeclNode>(POS,
+			arena->make<IntTypeNode>(POS), makeId(arena, i)));
+		IDNode * name = arena->make<IDNode>(POS,
+			Interner::global().intern("f" + std::to_string(i)));
+		globals->push_back(arena->make<FnDeclNode>(POS,
+			arena->make<VoidTypeNode>(POS), name, formals,
+			makeBody(arena, i, depth)));
+	}
+	ProgramNode * program = new ProgramNode(arena, globals);
+
+	const char * fdPath = "unparse_bench.fd.out";
+	const char * streamPath = "unparse_bench.stream.out";
+	const int rounds = 5;
+	double fdSecs = 0;
+	double streamSecs = 0;
+	for (int r = 0; r < rounds; r++){
+		auto t0 = std::chrono::steady_clock::now();
+		int fd = ::open(fdPath, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+		{
+			UnparseWriter out(fd);
+			program->unparse(out, 0);
+		}
+		::close(fd);
+		fdSecs += secondsSince(t0);
+
+		t0 = std::chrono::steady_clock::now();
+		{
+			std::ofstream stream(streamPath);
+			UnparseWriter out(stream);
+			program->unparse(out, 0);
+		}
+		streamSecs += secondsSince(t0);
+	}
+
+	std::ifstream fdIn(fdPath);
+	std::ifstream streamIn(streamPath);
+	std::ostringstream fdText;
+	std::ostringstream streamText;
+	fdText << fdIn.rdbuf();
+	streamText << streamIn.rdbuf();
+	::unlink(fdPath);
+	::unlink(streamPath);
+	if (fdText.str() != streamText.str()){
+		std::cerr << "outputs differ\n";
+		return 1;
+	}
+
+	double mb = static_cast<double>(fdText.str().size()) / (1 << 20);
+	std::cout << count << " functions nested " << depth << " deep, "
+	<< mb << " MB of output\n"
+	<< "fd:       " << mb * rounds / fdSecs << " MB/s\n"
+	<< "ofstream: " << mb * rounds / streamSecs << " MB/s\n";
+	delete program;
+	return 0;
+}
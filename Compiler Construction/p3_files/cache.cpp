@@ -0,0 +1,250 @@
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include "cache.hpp"
+
+namespace cminusminus{
+
+static const char MAGIC[4] = {'C', 'M', 'M', 'C'};
+static const uint32_t CACHE_VERSION = 5;
+
+/* After eviction the cache is at most this fraction of its limit,
+   so that it is not trimmed again on every run */
+static const uint64_t TRIM_PERCENT = 90;
+
+/* Two independent multiply-rotate lanes over 8-byte words */
+static void hash128(const char * data, size_t len, uint64_t seed,
+  uint64_t out[2]){
+	uint64_t a = 0x243F6A8885A308D3ull ^ seed;
+	uint64_t b = 0x13198A2E03707344ull ^ (seed * 31 + len);
+	size_t i = 0;
+	for (; i + 8 <= len; i += 8){
+		uint64_t w;
+		std::memcpy(&w, data + i, sizeof(w));
+		a = (a ^ w) * 0x9E3779B97F4A7C15ull;
+		a = (a << 29) | (a >> 35);
+		b = (b + w) * 0xC2B2AE3D27D4EB4Full;
+		b = (b << 31) | (b >> 33);
+	}
+	uint64_t tail = 0;
+	std::memcpy(&tail, data + i, len - i);
+	a = (a ^ tail ^ len) * 0x9E3779B97F4A7C15ull;
+	b = (b + tail + len) * 0xC2B2AE3D27D4EB4Full;
+	a ^= a >> 32;
+	b ^= b >> 29;
+	out[0] = a * 0xFF51AFD7ED558CCDull;
+	out[1] = b * 0xC4CEB9FE1A85EC53ull;
+}
+
+/* Stands in for a version number: any rebuild of cmmc changes
+   the size or modification time of its executable */
+static std::string compilerVersion(){
+	struct stat info;
+	if (stat("/proc/self/exe", &info) != 0){ return ""; }
+	std::ostringstream version;
+	version << info.st_size << "." << info.st_mtime;
+	return version.str();
+}
+
+std::string ResultCache::key(const SourceFile * src,
+  const std::string& options){
+	static const std::string version = compilerVersion();
+	std::string prefix = version + "|" + options;
+	uint64_t seed[2];
+	hash128(prefix.data(), prefix.size(), 0, seed);
+	uint64_t h[2];
+	hash128(src->data(), src->size(), seed[0] ^ seed[1], h);
+	char name[33];
+	std::snprintf(name, sizeof(name), "%016llx%016llx",
+		static_cast<unsigned long long>(h[0]),
+		static_cast<unsigned long long>(h[1]));
+	return name;
+}
+
+ResultCache::ResultCache(const std::string& dirIn, uint64_t maxBytesIn)
+: myDir(dirIn), myMaxBytes(maxBytesIn), myHits(0), myMisses(0),
+  myTotalHits(0), myTotalMisses(0), myEntries(0), myBytes(0){
+	::mkdir(myDir.c_str(), 0777);
+}
+
+std::string ResultCache::entryPath(const std::string& key) const{
+	return myDir + "/" + key;
+}
+
+static void putBlob(std::string& buf, bool present, const std::string& s){
+	buf += present ? '\1' : '\0';
+	uint64_t len = s.size();
+	buf.append(reinterpret_cast<const char *>(&len), sizeof(len));
+	buf += s;
+}
+
+static bool getBlob(const std::string& buf, size_t& pos, bool& present,
+  std::string& s){
+	uint64_t len;
+	if (buf.size() - pos < 1 + sizeof(len)){ return false; }
+	present = buf[pos] != '\0';
+	std::memcpy(&len, buf.data() + pos + 1, sizeof(len));
+	pos += 1 + sizeof(len);
+	if (buf.size() - pos < len){ return false; }
+	s.assign(buf, pos, len);
+	pos += len;
+	return true;
+}
+
+bool ResultCache::load(const std::string& key, CachedRun& run){
+	std::string path = entryPath(key);
+	std::ifstream in(path, std::ios_base::binary);
+	std::string buf;
+	if (in.good()){
+		std::ostringstream all;
+		all << in.rdbuf();
+		buf = all.str();
+	}
+	uint32_t version = 0;
+	size_t pos = sizeof(MAGIC) + sizeof(version) + 1;
+	bool ok = buf.size() >= pos
+	  && std::memcmp(buf.data(), MAGIC, sizeof(MAGIC)) == 0;
+	if (ok){
+		std::memcpy(&version, buf.data() + sizeof(MAGIC), sizeof(version));
+		run.ok = buf[pos - 1] != '\0';
+	}
+	bool present;
+	ok = ok && version == CACHE_VERSION
+	  && getBlob(buf, pos, present, run.out)
+	  && getBlob(buf, pos, present, run.err)
+	  && getBlob(buf, pos, run.hasTokens, run.tokens)
+	  && getBlob(buf, pos, run.hasBinTokens, run.binTokens)
+	  && getBlob(buf, pos, run.hasUnparse, run.unparse)
+	  && getBlob(buf, pos, run.hasAst, run.ast)
+	  && getBlob(buf, pos, run.hasNames, run.names)
+	  && getBlob(buf, pos, run.hasIR, run.ir)
+	  && getBlob(buf, pos, run.hasAsm, run.assembly)
+	  && pos == buf.size();
+	if (!ok){
+		myMisses++;
+		return false;
+	}
+	//Mark the entry as just used, for LRU eviction
+	::utimensat(AT_FDCWD, path.c_str(), nullptr, 0);
+	myHits++;
+	return true;
+}
+
+void ResultCache::store(const std::string& key, const CachedRun& run){
+	std::string buf(MAGIC, sizeof(MAGIC));
+	buf.append(reinterpret_cast<const char *>(&CACHE_VERSION),
+		sizeof(CACHE_VERSION));
+	buf += run.ok ? '\1' : '\0';
+	putBlob(buf, true, run.out);
+	putBlob(buf, true, run.err);
+	putBlob(buf, run.hasTokens, run.tokens);
+	putBlob(buf, run.hasBinTokens, run.binTokens);
+	putBlob(buf, run.hasUnparse, run.unparse);
+	putBlob(buf, run.hasAst, run.ast);
+	putBlob(buf, run.hasNames, run.names);
+	putBlob(buf, run.hasIR, run.ir);
+	putBlob(buf, run.hasAsm, run.assembly);
+
+	//Write under a private name and rename, so that readers in
+	// other processes never see half an entry
+	std::ostringstream tmp;
+	tmp << entryPath(key) << ".tmp." << ::getpid() << "."
+	  << std::hash<std::thread::id>()(std::this_thread::get_id());
+	{
+		std::ofstream out(tmp.str(), std::ios_base::binary);
+		out.write(buf.data(), static_cast<std::streamsize>(buf.size()));
+		if (!out.good()){
+			::unlink(tmp.str().c_str());
+			return;
+		}
+	}
+	if (std::rename(tmp.str().c_str(), entryPath(key).c_str()) != 0){
+		::unlink(tmp.str().c_str());
+	}
+}
+
+struct EntryInfo{
+	std::string path;
+	uint64_t bytes;
+	struct timespec used;
+};
+
+void ResultCache::finish(){
+	//Fold this run's counts into the totals, under a lock since
+	// other cmmc processes may share the directory
+	std::string statsPath = myDir + "/stats";
+	int fd = ::open(statsPath.c_str(), O_RDWR | O_CREAT, 0666);
+	if (fd >= 0 && ::flock(fd, LOCK_EX) == 0){
+		char text[64] = {0};
+		ssize_t got = ::pread(fd, text, sizeof(text) - 1, 0);
+		unsigned long long hits = 0;
+		unsigned long long misses = 0;
+		if (got > 0){ std::sscanf(text, "%llu %llu", &hits, &misses); }
+		myTotalHits = hits + myHits;
+		myTotalMisses = misses + myMisses;
+		int len = std::snprintf(text, sizeof(text), "%llu %llu\n",
+			static_cast<unsigned long long>(myTotalHits),
+			static_cast<unsigned long long>(myTotalMisses));
+		if (::ftruncate(fd, 0) == 0){
+			::pwrite(fd, text, static_cast<size_t>(len), 0);
+		}
+	}
+	if (fd >= 0){ ::close(fd); }
+
+	std::vector<EntryInfo> entries;
+	DIR * dir = ::opendir(myDir.c_str());
+	if (dir == nullptr){ return; }
+	uint64_t total = 0;
+	while (struct dirent * ent = ::readdir(dir)){
+		if (std::strlen(ent->d_name) != 32){ continue; }
+		EntryInfo info;
+		info.path = myDir + "/" + ent->d_name;
+		struct stat st;
+		if (::stat(info.path.c_str(), &st) != 0){ continue; }
+		info.bytes = static_cast<uint64_t>(st.st_size);
+		info.used = st.st_mtim;
+		total += info.bytes;
+		entries.push_back(info);
+	}
+	::closedir(dir);
+
+	if (total > myMaxBytes){
+		std::sort(entries.begin(), entries.end(),
+		  [](const EntryInfo& x, const EntryInfo& y){
+			if (x.used.tv_sec != y.used.tv_sec){
+				return x.used.tv_sec < y.used.tv_sec;
+			}
+			return x.used.tv_nsec < y.used.tv_nsec;
+		});
+		uint64_t goal = myMaxBytes / 100 * TRIM_PERCENT;
+		size_t evicted = 0;
+		while (evicted < entries.size() && total > goal){
+			::unlink(entries[evicted].path.c_str());
+			total -= entries[evicted].bytes;
+			evicted++;
+		}
+		entries.erase(entries.begin(), entries.begin()
+			+ static_cast<std::ptrdiff_t>(evicted));
+	}
+	myEntries = entries.size();
+	myBytes = total;
+}
+
+void ResultCache::report(std::ostream& out) const{
+	out << "Cache " << myDir << ": "
+	<< myHits << " hits, " << myMisses << " misses this run; "
+	<< myTotalHits << " hits, " << myTotalMisses << " misses in all; "
+	<< myEntries << " entries, " << myBytes << " of "
+	<< myMaxBytes << " bytes\n";
+}
+
+} //End namespace cminusminus
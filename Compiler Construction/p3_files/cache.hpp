@@ -0,0 +1,76 @@
+#ifndef CMINUSMINUS_CACHE_HPP
+#define CMINUSMINUS_CACHE_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include "source.hpp"
+
+namespace cminusminus{
+
+/* Everything one compile of one file produced. The has* flags
+   say whether that output file was written at all */
+struct CachedRun{
+	bool ok = false;
+	std::string out;
+	std::string err;
+	bool hasTokens = false;
+	std::string tokens;
+	bool hasBinTokens = false;
+	std::string binTokens;
+	bool hasUnparse = false;
+	std::string unparse;
+	bool hasAst = false;
+	std::string ast;
+	bool hasNames = false;
+	std::string names;
+	bool hasIR = false;
+	std::string ir;
+	bool hasAsm = false;
+	std::string assembly;
+};
+
+/**
+* \class ResultCache
+* A directory of CachedRuns, one file per entry, named by a
+* 128-bit hash of the input bytes, the cmmc binary and the
+* options that shape the output. An entry's modification time
+* is its last use; finish() deletes the least recently used 
+* entries until the directory fits in its size limit. Hit and
+* miss counts are kept across runs in the directory's stats file
+**/
+class ResultCache{
+public:
+	ResultCache(const std::string& dirIn, uint64_t maxBytesIn);
+	ResultCache(const ResultCache&) = delete;
+	ResultCache& operator=(const ResultCache&) = delete;
+
+	/** The entry name for src compiled with the given options **/
+	static std::string key(const SourceFile * src,
+	  const std::string& options);
+
+	/** Fills in run and returns true on a hit **/
+	bool load(const std::string& key, CachedRun& run);
+	void store(const std::string& key, const CachedRun& run);
+
+	/** Record this run's hits and misses, then evict **/
+	void finish();
+	/** Describe this run and the cache as a whole **/
+	void report(std::ostream& out) const;
+private:
+	std::string entryPath(const std::string& key) const;
+
+	std::string myDir;
+	uint64_t myMaxBytes;
+	std::atomic<uint64_t> myHits;
+	std::atomic<uint64_t> myMisses;
+	uint64_t myTotalHits;
+	uint64_t myTotalMisses;
+	uint64_t myEntries;
+	uint64_t myBytes;
+};
+
+} //End namespace cminusminus
+
+#endif
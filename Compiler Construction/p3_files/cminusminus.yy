@@ -9,9 +9,9 @@
 %token-table
 
 %code requires{
-	#include <list>
 	#include "tokens.hpp"
 	#include "ast.hpp"
+	#include "arena.hpp"
 	namespace cminusminus {
 		class Scanner;
 	}
@@ -31,6 +31,7 @@
 
 %parse-param { cminusminus::Scanner &scanner }
 %parse-param { cminusminus::ProgramNode** root }
+%parse-param { cminusminus::Arena * arena }
 %code{
    // C std code for utility functions
    #include <iostream>
@@ -45,25 +46,36 @@
   //Request tokens from our scanner member, not 
   // from a global function
   #undef yylex
-  #define yylex scanner.yylex
+  #define yylex scanner.lexAndTee
 }
 
 /*
 The %union directive is a way to specify the 
 set of possible types that might be used as
-translation attributes on a symbol.
-For this project, only terminals have types (we'll
-have translation attributes for non-terminals in the next
-project)
+translation attributes on a symbol: a token for
+each terminal, and the AST node (or list of nodes)
+that each nonterminal builds.
 */
 %union {
    cminusminus::Token* lexeme;
    cminusminus::Token* transToken;
    cminusminus::IDToken*                       transIDToken;
    cminusminus::ProgramNode*                   transProgram;
-   std::list<cminusminus::DeclNode *> *        transDeclList;
+   cminusminus::NodeList<cminusminus::DeclNode> * transDeclList;
    cminusminus::DeclNode *                     transDecl;
    cminusminus::VarDeclNode *                  transVarDecl;
+   cminusminus::IntLitToken*                   transIntToken;
+   cminusminus::ShortLitToken*                 transShortToken;
+   cminusminus::StrToken*                      transStrToken;
+   cminusminus::FnDeclNode *                   transFnDecl;
+   cminusminus::NodeList<cminusminus::FormalDeclNode> * transFormalList;
+   cminusminus::FormalDeclNode *               transFormal;
+   cminusminus::NodeList<cminusminus::StmtNode> * transStmtList;
+   cminusminus::StmtNode *                     transStmt;
+   cminusminus::ExpNode *                      transExp;
+   cminusminus::AssignExpNode *                transAssignExp;
+   cminusminus::CallExpNode *                  transCallExp;
+   cminusminus::NodeList<cminusminus::ExpNode> * transExpList;
    cminusminus::TypeNode *                     transType;
    cminusminus::IDNode *                       transID;
    cminusminus::LValNode *                     transLVal;
@@ -126,17 +138,25 @@ project)
 /* Nonterminals
 *  The specifier in angle brackets
 *  indicates the type of the translation attribute using
-*  the names defined in the %union directive above
-*  TODO: You will need to add more attributes for other nonterminals
-*  to this list as you add productions to the grammar
-*  below (along with indicating the appropriate translation
-*  attribute type).
+*  the names defined in the %union directive above.
+*  Every nonterminal has one, as every production builds
+*  a node.
 */
 /*    (attribute type)    (nonterminal)    */
 %type <transProgram>    program
 %type <transDeclList>   globals
 %type <transDecl>       decl
 %type <transVarDecl>    varDecl
+%type <transFnDecl>     fnDecl
+%type <transFormalList> formals
+%type <transFormal>     formalDecl
+%type <transStmtList>   stmtList
+%type <transStmt>       stmt
+%type <transExp>        exp
+%type <transAssignExp>  assignExp
+%type <transCallExp>    callExp
+%type <transExpList>    actualsList
+%type <transExp>        term
 %type <transType>       type
 %type <transType>       primType
 %type <transLVal>       lval
@@ -154,7 +174,7 @@ project)
 
 program 	: globals
 		  {
-		  $$ = new ProgramNode($1);
+		  $$ = new ProgramNode(arena, $1);
 		  *root = $$;
 		  }
 
@@ -166,7 +186,7 @@ globals 	: globals decl
 	  	  }
 		| /* epsilon */
 		  {
-		  $$ = new std::list<DeclNode * >();
+		  $$ = arena->make<NodeList<DeclNode>>(arena);
 		  }
 
 decl 		: varDecl
@@ -175,157 +195,271 @@ decl 		: varDecl
 			// grammar structure, and can be collapsed in the AST.
 			$$ = $1;
 		  }
-		| fnDecl 
-		  {
-			//TODO: Make sure to fill out this rule
-			// (as well as any other empty rule!)
-			// with the appropriate SDD to create an AST
-		  }
+		| fnDecl
+		  { $$ = $1; }
 
 varDecl 	: type id SEMICOL
 		  {
-		  Position * p = new Position($1->pos(), $2->pos());
-		  $$ = new VarDeclNode(p, $1, $2);
+		  //Through the semicolon, as for statements, so that
+		  // the incremental parser's chunks hold every token
+		  Position p($1->pos(), $3->pos());
+		  $$ = arena->make<VarDeclNode>(p, $1, $2);
 		  }
 
 type		: primType
-		  { }
+		  { $$ = $1; }
 		| PTR primType
-		  { }
+		  {
+		  Position p($1->pos(), $2->pos());
+		  $$ = arena->make<PtrTypeNode>(p, $2);
+		  }
 primType 	: INT
-	  	  { $$ = new IntTypeNode($1->pos()); }
+	  	  { $$ = arena->make<IntTypeNode>($1->pos()); }
 		| BOOL
-		  { }
+		  { $$ = arena->make<BoolTypeNode>($1->pos()); }
 		| STRING
-		  { }
+		  { $$ = arena->make<StringTypeNode>($1->pos()); }
 		| SHORT
-		  { }
+		  { $$ = arena->make<ShortTypeNode>($1->pos()); }
 		| VOID
-		  { }
+		  { $$ = arena->make<VoidTypeNode>($1->pos()); }
 
 fnDecl 		: type id LPAREN RPAREN LCURLY stmtList RCURLY
-		  { }
+		  {
+		  Position p($1->pos(), $7->pos());
+		  auto formals = arena->make<NodeList<FormalDeclNode>>(arena);
+		  $$ = arena->make<FnDeclNode>(p, $1, $2, formals, $6);
+		  }
 		| type id LPAREN formals RPAREN LCURLY stmtList RCURLY
-		  { }
+		  {
+		  Position p($1->pos(), $8->pos());
+		  $$ = arena->make<FnDeclNode>(p, $1, $2, $4, $7);
+		  }
 
 formals 	: formalDecl
-		  { }
+		  {
+		  $$ = arena->make<NodeList<FormalDeclNode>>(arena);
+		  $$->push_back($1);
+		  }
 		| formals COMMA formalDecl
-		  { }
+		  {
+		  $$ = $1;
+		  $$->push_back($3);
+		  }
 
 formalDecl 	: type id
-		  { }
+		  {
+		  Position p($1->pos(), $2->pos());
+		  $$ = arena->make<FormalDeclNode>(p, $1, $2);
+		  }
 
 stmtList 	: /* epsilon */
-	   	  { }
+	   	  { $$ = arena->make<NodeList<StmtNode>>(arena); }
 		| stmtList stmt
-	  	  { }
+	  	  {
+		  $$ = $1;
+		  $$->push_back($2);
+		  }
 
 stmt		: varDecl
-		  { }
+		  { $$ = $1; }
 		| assignExp SEMICOL
-		  { }
+		  {
+		  Position p($1->pos(), $2->pos());
+		  $$ = arena->make<AssignStmtNode>(p, $1);
+		  }
 		| lval DEC SEMICOL
-		  { }
+		  {
+		  Position p($1->pos(), $3->pos());
+		  $$ = arena->make<PostDecStmtNode>(p, $1);
+		  }
 		| lval INC SEMICOL
-		  { }
+		  {
+		  Position p($1->pos(), $3->pos());
+		  $$ = arena->make<PostIncStmtNode>(p, $1);
+		  }
 		| READ lval SEMICOL
-		  { }
+		  {
+		  Position p($1->pos(), $3->pos());
+		  $$ = arena->make<ReadStmtNode>(p, $2);
+		  }
 		| WRITE exp SEMICOL
-		  { }
+		  {
+		  Position p($1->pos(), $3->pos());
+		  $$ = arena->make<WriteStmtNode>(p, $2);
+		  }
 		| WHILE LPAREN exp RPAREN LCURLY stmtList RCURLY
-		  { }
+		  {
+		  Position p($1->pos(), $7->pos());
+		  $$ = arena->make<WhileStmtNode>(p, $3, $6);
+		  }
 		| IF LPAREN exp RPAREN LCURLY stmtList RCURLY
-		  { }
+		  {
+		  Position p($1->pos(), $7->pos());
+		  $$ = arena->make<IfStmtNode>(p, $3, $6);
+		  }
 		| IF LPAREN exp RPAREN LCURLY stmtList RCURLY ELSE LCURLY stmtList RCURLY
-		  { }
+		  {
+		  Position p($1->pos(), $11->pos());
+		  $$ = arena->make<IfElseStmtNode>(p, $3, $6, $10);
+		  }
 		| RETURN exp SEMICOL
-		  { }
+		  {
+		  Position p($1->pos(), $3->pos());
+		  $$ = arena->make<ReturnStmtNode>(p, $2);
+		  }
 		| RETURN SEMICOL
-		  { }
+		  {
+		  Position p($1->pos(), $2->pos());
+		  $$ = arena->make<ReturnStmtNode>(p, nullptr);
+		  }
 		| callExp SEMICOL
-		  { }
+		  {
+		  Position p($1->pos(), $2->pos());
+		  $$ = arena->make<CallStmtNode>(p, $1);
+		  }
 
-exp		: assignExp 
-		  { } 
+exp		: assignExp
+		  { $$ = $1; }
 		| exp MINUS exp
-	  	  { }
+	  	  {
+		  Position p($1->pos(), $3->pos());
+		  $$ = arena->make<MinusNode>(p, $1, $3);
+		  }
 		| exp PLUS exp
-	  	  { }
+	  	  {
+		  Position p($1->pos(), $3->pos());
+		  $$ = arena->make<PlusNode>(p, $1, $3);
+		  }
 		| exp TIMES exp
-	  	  { }
+	  	  {
+		  Position p($1->pos(), $3->pos());
+		  $$ = arena->make<TimesNode>(p, $1, $3);
+		  }
 		| exp DIVIDE exp
-	  	  { }
+	  	  {
+		  Position p($1->pos(), $3->pos());
+		  $$ = arena->make<DivideNode>(p, $1, $3);
+		  }
 		| exp AND exp
-	  	  { }
+	  	  {
+		  Position p($1->pos(), $3->pos());
+		  $$ = arena->make<AndNode>(p, $1, $3);
+		  }
 		| exp OR exp
-	  	  { }
+	  	  {
+		  Position p($1->pos(), $3->pos());
+		  $$ = arena->make<OrNode>(p, $1, $3);
+		  }
 		| exp EQUALS exp
-	  	  { }
+	  	  {
+		  Position p($1->pos(), $3->pos());
+		  $$ = arena->make<EqualsNode>(p, $1, $3);
+		  }
 		| exp NOTEQUALS exp
-	  	  { }
+	  	  {
+		  Position p($1->pos(), $3->pos());
+		  $$ = arena->make<NotEqualsNode>(p, $1, $3);
+		  }
 		| exp GREATER exp
-	  	  { }
+	  	  {
+		  Position p($1->pos(), $3->pos());
+		  $$ = arena->make<GreaterNode>(p, $1, $3);
+		  }
 		| exp GREATEREQ exp
-	  	  { }
+	  	  {
+		  Position p($1->pos(), $3->pos());
+		  $$ = arena->make<GreaterEqNode>(p, $1, $3);
+		  }
 		| exp LESS exp
-	  	  { }
+	  	  {
+		  Position p($1->pos(), $3->pos());
+		  $$ = arena->make<LessNode>(p, $1, $3);
+		  }
 		| exp LESSEQ exp
-	  	  { }
+	  	  {
+		  Position p($1->pos(), $3->pos());
+		  $$ = arena->make<LessEqNode>(p, $1, $3);
+		  }
 		| NOT exp
-	  	  { }
+	  	  {
+		  Position p($1->pos(), $2->pos());
+		  $$ = arena->make<NotNode>(p, $2);
+		  }
 		| MINUS term
-	  	  { }
+	  	  {
+		  Position p($1->pos(), $2->pos());
+		  $$ = arena->make<NegNode>(p, $2);
+		  }
 		| term
-	  	  { }
+	  	  { $$ = $1; }
 
 assignExp	: lval ASSIGN exp
-		  { }
+		  {
+		  Position p($1->pos(), $3->pos());
+		  $$ = arena->make<AssignExpNode>(p, $1, $3);
+		  }
 
 callExp		: id LPAREN RPAREN
-		  { }
+		  {
+		  Position p($1->pos(), $3->pos());
+		  auto args = arena->make<NodeList<ExpNode>>(arena);
+		  $$ = arena->make<CallExpNode>(p, $1, args);
+		  }
 		| id LPAREN actualsList RPAREN
-		  { }
+		  {
+		  Position p($1->pos(), $4->pos());
+		  $$ = arena->make<CallExpNode>(p, $1, $3);
+		  }
 
 actualsList	: exp
-		  { }
+		  {
+		  $$ = arena->make<NodeList<ExpNode>>(arena);
+		  $$->push_back($1);
+		  }
 		| actualsList COMMA exp
-		  { }
+		  {
+		  $$ = $1;
+		  $$->push_back($3);
+		  }
 
 term 		: lval
-		  { }
-		| INTLITERAL 
-		  { }
-		| SHORTLITERAL 
-		  { }
-		| STRLITERAL 
-		  { }
+		  { $$ = $1; }
+		| INTLITERAL
+		  { $$ = arena->make<IntLitNode>($1->pos(), $1->num()); }
+		| SHORTLITERAL
+		  { $$ = arena->make<ShortLitNode>($1->pos(), $1->num()); }
+		| STRLITERAL
+		  { $$ = arena->make<StrLitNode>($1->pos(), &$1->str()); }
 		| AMP id
-		  {  }
+		  {
+		  Position p($1->pos(), $2->pos());
+		  $$ = arena->make<RefNode>(p, $2);
+		  }
 		| TRUE
-		  { }
+		  { $$ = arena->make<TrueNode>($1->pos()); }
 		| FALSE
-		  { }
+		  { $$ = arena->make<FalseNode>($1->pos()); }
 		| LPAREN exp RPAREN
-		  { }
+		  { $$ = $2; }
 		| callExp
-		  {
-		  }
+		  { $$ = $1; }
 
 lval		: id
 		  { $$ = $1; }
 		| AT id
-		  { }
+		  {
+		  Position p($1->pos(), $2->pos());
+		  $$ = arena->make<DerefNode>(p, $2);
+		  }
 
 id		: ID
 		  {
-		  Position * pos = $1->pos();
-		  $$ = new IDNode(pos, $1->value()); 
+		  $$ = arena->make<IDNode>($1->pos(), $1->sym()); 
 		  }
 	
 %%
 
 void cminusminus::Parser::error(const std::string& msg){
-	std::cout << msg << std::endl;
-	std::cerr << "syntax error" << std::endl;
+	cminusminus::Report::syntax(msg);
 }
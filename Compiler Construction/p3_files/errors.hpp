@@ -51,21 +51,54 @@ private:
 class Report{
 public:
 	static void fatal(
-		Position * pos,
+		const Position& pos,
 		const char * msg
 	){
-		std::cerr << "FATAL " 
-		<< pos->span()
+		*sink() << "FATAL " 
+		<< pos.span()
 		<< ": " 
 		<< msg  << std::endl;
 	}
 
 	static void fatal(
-		Position * pos,
+		const Position& pos,
 		const std::string msg
 	){
 		fatal(pos,msg.c_str());
 	}
+
+	/* The parser's own message goes to standard output, with
+	   a bare "syntax error" on standard error */
+	static void syntax(const std::string& msg){
+		*outSink() << msg << std::endl;
+		*sink() << "syntax error" << std::endl;
+	}
+
+	/* Send the calling thread's messages to out instead of
+	   std::cerr. Returns where they were going before */
+	static std::ostream * redirect(std::ostream * out){
+		std::ostream * old = sink();
+		sink() = out;
+		return old;
+	}
+
+	/* As redirect, for the part of syntax() that would go to
+	   std::cout */
+	static std::ostream * redirectOut(std::ostream * out){
+		std::ostream * old = outSink();
+		outSink() = out;
+		return old;
+	}
+
+private:
+	static std::ostream *& sink(){
+		static thread_local std::ostream * out = &std::cerr;
+		return out;
+	}
+	static std::ostream *& outSink(){
+		static thread_local std::ostream * out = &std::cout;
+		return out;
+	}
 };
 
 }
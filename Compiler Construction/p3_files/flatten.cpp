@@ -0,0 +1,174 @@
+#include "ast.hpp"
+
+namespace cminusminus{
+
+/*
+Each flatten adds its children to the image before itself, so
+a record only ever refers to records already written. The
+fields each kind fills in are listed with AstKind.
+*/
+
+/* The list field for nodes, after flattening each of them */
+template <typename T>
+static uint32_t flattenList(AstImageWriter& image, 
+  const NodeList<T> * nodes){
+	std::vector<NodeRef> refs;
+	refs.reserve(nodes->size());
+	for (auto node : *nodes){
+		refs.push_back(node->flatten(image));
+	}
+	return image.addList(refs);
+}
+
+NodeRef ProgramNode::flatten(AstImageWriter& image) const{
+	return image.add(AST_PROGRAM, myPos, flattenList(image, myGlobals));
+}
+
+NodeRef VarDeclNode::flatten(AstImageWriter& image) const{
+	NodeRef type = myType->flatten(image);
+	NodeRef id = myId->flatten(image);
+	return image.add(AST_VARDECL, myPos, type, id);
+}
+
+NodeRef IDNode::flatten(AstImageWriter& image) const{
+	return image.add(AST_ID, myPos, image.addName(name));
+}
+
+NodeRef IntTypeNode::flatten(AstImageWriter& image) const{
+	return image.add(AST_INTTYPE, myPos);
+}
+
+NodeRef BoolTypeNode::flatten(AstImageWriter& image) const{
+	return image.add(AST_BOOLTYPE, myPos);
+}
+
+NodeRef ShortTypeNode::flatten(AstImageWriter& image) const{
+	return image.add(AST_SHORTTYPE, myPos);
+}
+
+NodeRef StringTypeNode::flatten(AstImageWriter& image) const{
+	return image.add(AST_STRINGTYPE, myPos);
+}
+
+NodeRef VoidTypeNode::flatten(AstImageWriter& image) const{
+	return image.add(AST_VOIDTYPE, myPos);
+}
+
+NodeRef PtrTypeNode::flatten(AstImageWriter& image) const{
+	return image.add(AST_PTRTYPE, myPos, myBase->flatten(image));
+}
+
+NodeRef FnDeclNode::flatten(AstImageWriter& image) const{
+	NodeRef type = myRetType->flatten(image);
+	NodeRef id = myId->flatten(image);
+	uint32_t formals = flattenList(image, myFormals);
+	uint32_t body = flattenList(image, myBody);
+	return image.add(AST_FNDECL, myPos, type, id, formals, body);
+}
+
+NodeRef FormalDeclNode::flatten(AstImageWriter& image) const{
+	NodeRef type = myType->flatten(image);
+	NodeRef id = myId->flatten(image);
+	return image.add(AST_FORMALDECL, myPos, type, id);
+}
+
+NodeRef DerefNode::flatten(AstImageWriter& image) const{
+	return image.add(AST_DEREF, myPos, myId->flatten(image));
+}
+
+NodeRef RefNode::flatten(AstImageWriter& image) const{
+	return image.add(AST_REF, myPos, myId->flatten(image));
+}
+
+NodeRef IntLitNode::flatten(AstImageWriter& image) const{
+	return image.add(AST_INTLIT, myPos, static_cast<uint32_t>(myNum));
+}
+
+NodeRef ShortLitNode::flatten(AstImageWriter& image) const{
+	return image.add(AST_SHORTLIT, myPos, static_cast<uint32_t>(myNum));
+}
+
+NodeRef StrLitNode::flatten(AstImageWriter& image) const{
+	return image.add(AST_STRLIT, myPos, image.addString(*myStr));
+}
+
+NodeRef TrueNode::flatten(AstImageWriter& image) const{
+	return image.add(AST_TRUE, myPos);
+}
+
+NodeRef FalseNode::flatten(AstImageWriter& image) const{
+	return image.add(AST_FALSE, myPos);
+}
+
+NodeRef AssignExpNode::flatten(AstImageWriter& image) const{
+	NodeRef dst = myDst->flatten(image);
+	NodeRef src = mySrc->flatten(image);
+	return image.add(AST_ASSIGNEXP, myPos, dst, src);
+}
+
+NodeRef CallExpNode::flatten(AstImageWriter& image) const{
+	NodeRef id = myId->flatten(image);
+	uint32_t args = flattenList(image, myArgs);
+	return image.add(AST_CALLEXP, myPos, id, args);
+}
+
+NodeRef BinaryExpNode::flatten(AstImageWriter& image) const{
+	NodeRef lhs = myLhs->flatten(image);
+	NodeRef rhs = myRhs->flatten(image);
+	return image.add(imageKind(), myPos, lhs, rhs);
+}
+
+NodeRef UnaryExpNode::flatten(AstImageWriter& image) const{
+	return image.add(imageKind(), myPos, myExp->flatten(image));
+}
+
+NodeRef AssignStmtNode::flatten(AstImageWriter& image) const{
+	return image.add(AST_ASSIGNSTMT, myPos, myExp->flatten(image));
+}
+
+NodeRef PostIncStmtNode::flatten(AstImageWriter& image) const{
+	return image.add(AST_POSTINC, myPos, myLVal->flatten(image));
+}
+
+NodeRef PostDecStmtNode::flatten(AstImageWriter& image) const{
+	return image.add(AST_POSTDEC, myPos, myLVal->flatten(image));
+}
+
+NodeRef ReadStmtNode::flatten(AstImageWriter& image) const{
+	return image.add(AST_READ, myPos, myDst->flatten(image));
+}
+
+NodeRef WriteStmtNode::flatten(AstImageWriter& image) const{
+	return image.add(AST_WRITE, myPos, mySrc->flatten(image));
+}
+
+NodeRef WhileStmtNode::flatten(AstImageWriter& image) const{
+	NodeRef cond = myCond->flatten(image);
+	uint32_t body = flattenList(image, myBody);
+	return image.add(AST_WHILE, myPos, cond, body);
+}
+
+NodeRef IfStmtNode::flatten(AstImageWriter& image) const{
+	NodeRef cond = myCond->flatten(image);
+	uint32_t body = flattenList(image, myBody);
+	return image.add(AST_IF, myPos, cond, body);
+}
+
+NodeRef IfElseStmtNode::flatten(AstImageWriter& image) const{
+	NodeRef cond = myCond->flatten(image);
+	uint32_t bodyTrue = flattenList(image, myBodyTrue);
+	uint32_t bodyFalse = flattenList(image, myBodyFalse);
+	return image.add(AST_IFELSE, myPos, cond, bodyTrue, bodyFalse);
+}
+
+NodeRef ReturnStmtNode::flatten(AstImageWriter& image) const{
+	NodeRef exp = AST_NO_REF;
+	if (myExp != nullptr){ exp = myExp->flatten(image); }
+	return image.add(AST_RETURN, myPos, exp);
+}
+
+NodeRef CallStmtNode::flatten(AstImageWriter& image) const{
+	return image.add(AST_CALLSTMT, myPos, myCall->flatten(image));
+}
+
+} // End namespace cminusminus
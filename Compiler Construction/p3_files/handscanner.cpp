@@ -0,0 +1,354 @@
+#include <cerrno>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include "scanner.hpp"
+#include "simdscan.hpp"
+
+/*
+A hand-coded replacement for the flex scanner generated from
+cminusminus.l, selected with `make SCANNER=hand`. It implements
+the same Scanner::yylex interface and reproduces the flex rules
+exactly (longest match, earliest rule on ties), including the
+error reports for bad strings and numeric literals. Keywords are
+scanned as identifiers and then looked up with a perfect hash.
+*/
+
+using namespace cminusminus;
+
+using TokenKind = cminusminus::Parser::token;
+using Lexeme = cminusminus::Parser::semantic_type;
+
+namespace {
+
+struct Keyword{
+	const char * text;
+	size_t len;
+	int kind;
+};
+
+/* Indexed by keywordHash; every keyword (and the operator words
+   "and", "or", "gets") lands in a distinct slot */
+const Keyword keywordTable[32] = {
+	{"void", 4, TokenKind::VOID},        {"or", 2, TokenKind::OR},
+	{nullptr, 0, 0},                     {"if", 2, TokenKind::IF},
+	{nullptr, 0, 0},                     {"string", 6, TokenKind::STRING},
+	{"short", 5, TokenKind::SHORT},      {nullptr, 0, 0},
+	{"read", 4, TokenKind::READ},        {nullptr, 0, 0},
+	{"while", 5, TokenKind::WHILE},      {nullptr, 0, 0},
+	{"bool", 4, TokenKind::BOOL},        {"ptr", 3, TokenKind::PTR},
+	{nullptr, 0, 0},                     {nullptr, 0, 0},
+	{nullptr, 0, 0},                     {nullptr, 0, 0},
+	{"and", 3, TokenKind::AND},          {nullptr, 0, 0},
+	{"true", 4, TokenKind::TRUE},        {nullptr, 0, 0},
+	{"return", 6, TokenKind::RETURN},    {nullptr, 0, 0},
+	{nullptr, 0, 0},                     {"else", 4, TokenKind::ELSE},
+	{"int", 3, TokenKind::INT},          {"false", 5, TokenKind::FALSE},
+	{nullptr, 0, 0},                     {"gets", 4, TokenKind::ASSIGN},
+	{"write", 5, TokenKind::WRITE},      {nullptr, 0, 0},
+};
+
+inline size_t keywordHash(const char * s, size_t len){
+	return (static_cast<unsigned char>(s[0])
+	  + 18u * static_cast<unsigned char>(s[1])
+	  + 7u * len) & 31u;
+}
+
+/* Returns the keyword's token kind, or ID */
+inline int lookupKeyword(const char * s, size_t len){
+	if (len < 2 || len > 6){ return TokenKind::ID; }
+	const Keyword& kw = keywordTable[keywordHash(s, len)];
+	if (kw.len == len && std::memcmp(kw.text, s, len) == 0){
+		return kw.kind;
+	}
+	return TokenKind::ID;
+}
+
+inline bool isDigit(char c){ return c >= '0' && c <= '9'; }
+inline bool isIdStart(char c){
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+/* The four string rules of cminusminus.l, in rule order */
+enum StringRule{
+	STR_GOOD = 1,        // \"{STRELT}*\"
+	STR_UNTERM = 2,      // \"{STRELT}*
+	STR_BAD_UNTERM = 3,  // ["]({STRELT}*{BADESC}{STRELT}*)+(\\["])?
+	STR_BAD = 4          // ["]({STRELT}*{BADESC}{STRELT}*)+["]
+};
+
+/* NFA states while inside a string body: between elements with
+   no bad escape so far (S0) or with one (S1), or just after a 
+   backslash that may still become a good escape (M0/M1) */
+const unsigned S0 = 1, S1 = 2, M0 = 4, M1 = 8;
+
+/* Length of the significant (non-leading-zero) digits */
+size_t significantDigits(const char * s, size_t len){
+	for (size_t i = 0; i < len; i++){
+		if (s[i] != '0'){ return len - i; }
+	}
+	return 0;
+}
+
+} // End anonymous namespace
+
+Scanner::Scanner(std::istream *in, Arena * arenaIn)
+: myArena(arenaIn), mySource(nullptr), myRead(0),
+  myOwnedText(std::istreambuf_iterator<char>(*in),
+    std::istreambuf_iterator<char>()){
+	lineNum = 1;
+	colNum = 1;
+	myText = myOwnedText.data();
+	myTextLen = myOwnedText.size();
+}
+
+Scanner::Scanner(const SourceFile * src, Arena * arenaIn)
+: myArena(arenaIn), mySource(src), myRead(0),
+  myText(src->data()), myTextLen(src->size()){
+	lineNum = 1;
+	colNum = 1;
+}
+
+int Scanner::bareToken(Lexeme * const lval, int kind, size_t len){
+	Position pos(lineNum, colNum, lineNum, colNum + len);
+	lval->lexeme = myArena->make<Token>(pos, kind);
+	colNum += len;
+	myRead += len;
+	return kind;
+}
+
+/* Simulates the string rules from the opening quote at start and
+   returns the length of the longest match (earliest rule on a
+   tie), storing which rule matched in ruleOut */
+size_t Scanner::scanString(size_t start, int * ruleOut) const{
+	size_t bestLen = 1;
+	int bestRule = STR_UNTERM;
+	auto candidate = [&](int rule, size_t len){
+		if (len > bestLen || (len == bestLen && rule < bestRule)){
+			bestLen = len;
+			bestRule = rule;
+		}
+	};
+
+	unsigned set = S0;
+	size_t i = start + 1;
+	while (set != 0 && i < myTextLen){
+		char c = myText[i];
+		if (c == '\n'){ break; }
+		unsigned next = 0;
+		if (c == '"'){
+			if (set & S0){ candidate(STR_GOOD, i + 1 - start); }
+			if (set & S1){ candidate(STR_BAD, i + 1 - start); }
+			if (set & M0){ next |= S0; }
+			if (set & M1){ next |= S1; }
+		} else if (c == '\\'){
+			//Either the start of an escape or a lone bad one
+			if (set & S0){ next |= M0 | S1; }
+			if (set & S1){ next |= M1 | S1; }
+			if (set & M0){ next |= S0; }
+			if (set & M1){ next |= S1; }
+		} else {
+			bool goodEsc = c == 'n' || c == 't';
+			if (set & S0){ next |= S0; }
+			if (set & S1){ next |= S1; }
+			if (set & M0){ next |= goodEsc ? S0 : S1; }
+			if (set & M1){ next |= S1; }
+		}
+		set = next;
+		i++;
+		if (set & S0){ candidate(STR_UNTERM, i - start); }
+		if (set & S1){ candidate(STR_BAD_UNTERM, i - start); }
+	}
+	*ruleOut = bestRule;
+	return bestLen;
+}
+
+int Scanner::scanIntLiteral(Lexeme * const lval, size_t start, size_t len){
+	const char * digits = myText + start;
+	Position pos(lineNum, colNum, lineNum, colNum + len);
+	int intVal = 0;
+	if (len <= 9){
+		//Cannot overflow; skip the string conversions
+		for (size_t i = 0; i < len; i++){
+			intVal = intVal * 10 + (digits[i] - '0');
+		}
+	} else {
+		std::string str(digits, len);
+		double asDouble;
+		try {
+			asDouble = std::stod(str);
+		} catch (std::out_of_range&){
+			asDouble = HUGE_VAL;
+		}
+		intVal = std::atoi(str.c_str());
+		bool overflow = asDouble > INT_MAX;
+		bool underflow = asDouble < INT_MIN;
+		if (significantDigits(digits, len) > 10){ overflow = true; }
+		if (overflow){
+			errIntOverflow(pos);
+			intVal = 0;
+		}
+		if (underflow){
+			errIntUnderflow(pos);
+			intVal = 0;
+		}
+	}
+	lval->transToken = myArena->make<IntLitToken>(pos, intVal);
+	colNum += len;
+	myRead += len;
+	return TokenKind::INTLITERAL;
+}
+
+/* len includes the trailing 'S' */
+int Scanner::scanShortLiteral(Lexeme * const lval, size_t start, size_t len){
+	const char * digits = myText + start;
+	size_t numLen = len - 1;
+	Position pos(lineNum, colNum, lineNum, colNum + len);
+	int intVal = 0;
+	if (numLen <= 9){
+		for (size_t i = 0; i < numLen; i++){
+			intVal = intVal * 10 + (digits[i] - '0');
+		}
+	} else {
+		std::string str(digits, numLen);
+		intVal = std::atoi(str.c_str());
+	}
+	bool overflow = intVal > 32767;
+	bool underflow = intVal < -32768;
+	if (significantDigits(digits, numLen) > 10){ overflow = true; }
+	if (overflow){
+		errShortOverflow(pos);
+		intVal = 0;
+	}
+	if (underflow){
+		errShortUnderflow(pos);
+		intVal = 0;
+	}
+	lval->transToken = myArena->make<ShortLitToken>(pos, intVal);
+	colNum += len;
+	myRead += len;
+	return TokenKind::SHORTLITERAL;
+}
+
+int Scanner::yylex(Lexeme * const lval){
+	const char * text = myText;
+	const size_t end = myTextLen;
+	while (myRead < end){
+		size_t start = myRead;
+		char c = text[start];
+		char next = start + 1 < end ? text[start + 1] : '\0';
+		switch (c){
+		case ' ': case '\t': {
+			size_t i = start + 1;
+			i += simd::blankRun(text + i, end - i);
+			colNum += i - start;
+			myRead = i;
+			continue;
+		}
+		case '\n':
+			lineNum++;
+			colNum = 1;
+			myRead++;
+			continue;
+		case '\r':
+			if (next == '\n' && start + 1 < end){
+				lineNum++;
+				colNum = 1;
+				myRead += 2;
+				continue;
+			}
+			break;
+		case '#': {
+			size_t i = start + 1;
+			i += simd::lineRun(text + i, end - i);
+			colNum += i - start;
+			myRead = i;
+			continue;
+		}
+		case '"': {
+			int rule;
+			size_t len = scanString(start, &rule);
+			Position pos(lineNum, colNum, lineNum, colNum + len);
+			switch (rule){
+			case STR_GOOD:
+				lval->transToken = myArena->make<StrToken>(pos,
+					std::string(text + start, len));
+				colNum += len;
+				myRead += len;
+				return TokenKind::STRLITERAL;
+			case STR_UNTERM: errStrUnterm(pos); break;
+			case STR_BAD_UNTERM: errStrEscAndUnterm(pos); break;
+			default: errStrEsc(pos); break;
+			}
+			colNum += len;
+			myRead += len;
+			continue;
+		}
+		case '@': return bareToken(lval, TokenKind::AT, 1);
+		case '&': return bareToken(lval, TokenKind::AMP, 1);
+		case '{': return bareToken(lval, TokenKind::LCURLY, 1);
+		case '}': return bareToken(lval, TokenKind::RCURLY, 1);
+		case '(': return bareToken(lval, TokenKind::LPAREN, 1);
+		case ')': return bareToken(lval, TokenKind::RPAREN, 1);
+		case ';': return bareToken(lval, TokenKind::SEMICOL, 1);
+		case ',': return bareToken(lval, TokenKind::COMMA, 1);
+		case '*': return bareToken(lval, TokenKind::TIMES, 1);
+		case '/': return bareToken(lval, TokenKind::DIVIDE, 1);
+		case '+':
+			if (next == '+'){ return bareToken(lval, TokenKind::INC, 2); }
+			return bareToken(lval, TokenKind::PLUS, 1);
+		case '-':
+			if (next == '-'){ return bareToken(lval, TokenKind::DEC, 2); }
+			return bareToken(lval, TokenKind::MINUS, 1);
+		case '!':
+			if (next == '='){ return bareToken(lval, TokenKind::NOTEQUALS, 2); }
+			return bareToken(lval, TokenKind::NOT, 1);
+		case '=':
+			if (next == '='){ return bareToken(lval, TokenKind::EQUALS, 2); }
+			return bareToken(lval, TokenKind::ASSIGN, 1);
+		case '<':
+			if (next == '='){ return bareToken(lval, TokenKind::LESSEQ, 2); }
+			return bareToken(lval, TokenKind::LESS, 1);
+		case '>':
+			if (next == '='){ return bareToken(lval, TokenKind::GREATEREQ, 2); }
+			return bareToken(lval, TokenKind::GREATER, 1);
+		default:
+			break;
+		}
+
+		if (isIdStart(c)){
+			size_t i = start + 1;
+			i += simd::idContRun(text + i, end - i);
+			size_t len = i - start;
+			int kind = lookupKeyword(text + start, len);
+			if (kind != TokenKind::ID){
+				return bareToken(lval, kind, len);
+			}
+			Position pos(lineNum, colNum, lineNum, colNum + len);
+			lval->transToken = myArena->make<IDToken>(pos,
+				Interner::global().intern(text + start, len));
+			colNum += len;
+			myRead = i;
+			return TokenKind::ID;
+		}
+
+		if (isDigit(c)){
+			size_t i = start + 1;
+			while (i < end && isDigit(text[i])){ i++; }
+			if (i < end && text[i] == 'S'){
+				return scanShortLiteral(lval, start, i + 1 - start);
+			}
+			return scanIntLiteral(lval, start, i - start);
+		}
+
+		//Anything else is a single illegal character
+		Position pos(lineNum, colNum, lineNum, colNum + 1);
+		errIllegal(pos, std::string(1, c));
+		colNum += 1;
+		myRead += 1;
+	}
+	return TokenKind::END;
+}
@@ -0,0 +1,316 @@
+#include <algorithm>
+#include <memory>
+#include <sstream>
+#include "errors.hpp"
+#include "incremental.hpp"
+#include "scanner.hpp"
+
+namespace cminusminus{
+
+/* Arena chunk size for a full parse, and for the few lines an
+   edit reparses */
+static const size_t FULL_CHUNK_SIZE = 64 * 1024;
+static const size_t EDIT_CHUNK_SIZE = 8 * 1024;
+
+/* Trees replaced by edits stay in the arenas until the arenas
+   add up to twice what a full parse needs (plus this); then the
+   next edit parses everything again to drop them */
+static const size_t ARENA_SLACK = 1 << 20;
+
+static size_t countLines(const char * text, size_t len){
+	return static_cast<size_t>(std::count(text, text + len, '\n'));
+}
+
+static void move(size_t& n, long delta){
+	n = static_cast<size_t>(static_cast<long>(n) + delta);
+}
+
+IncrementalParser::IncrementalParser()
+: myArenaBytes(0), myFullBytes(0), myParsed(false),
+  myProgram(nullptr), myListArena(nullptr){
+}
+
+IncrementalParser::~IncrementalParser(){
+	clear();
+}
+
+void IncrementalParser::clear(){
+	delete myProgram;
+	myProgram = nullptr;
+	delete myListArena;
+	myListArena = nullptr;
+	myChunks.clear();
+	myDecls.clear();
+	for (auto arena : myArenas){ delete arena; }
+	myArenas.clear();
+	myArenaBytes = 0;
+}
+
+bool IncrementalParser::reset(const std::string& textIn){
+	myText = textIn;
+	return parseAll();
+}
+
+bool IncrementalParser::parseAll(){
+	clear();
+	myWork = Work();
+	myWork.full = true;
+	reparse(0, 0, FULL_CHUNK_SIZE);
+	myFullBytes = myArenaBytes;
+	return finish();
+}
+
+/* Lex and parse the lines of myText in [start, end), numbering
+   them from firstLine */
+IncrementalParser::Parse IncrementalParser::parseText(size_t start,
+  size_t end, size_t firstLine, size_t chunkSize){
+	std::ostringstream errs;
+	std::ostringstream out;
+	std::ostream * oldSink = Report::redirect(&errs);
+	std::ostream * oldOutSink = Report::redirectOut(&out);
+	std::unique_ptr<SourceFile> src(SourceFile::view(
+		myText.data() + start, end - start));
+	Parse result;
+	result.arena = new Arena(chunkSize);
+	ProgramNode * root = nullptr;
+	int errCode;
+	{
+		Scanner scanner(src.get(), result.arena);
+		scanner.startAtLine(firstLine);
+		Parser parser(scanner, &root, result.arena);
+		errCode = parser.parse();
+		result.atEnd = errCode != 0 && scanner.sawEnd();
+		result.syntaxPos = scanner.lastPos();
+	}
+	Report::redirect(oldSink);
+	Report::redirectOut(oldOutSink);
+	result.errors = errs.str();
+	result.syntaxOut = out.str();
+
+	result.decls = nullptr;
+	if (root != nullptr){
+		//The arena goes with the decls rather than the root
+		root->releaseArena();
+		if (errCode == 0){ result.decls = root->globals(); }
+		delete root;
+	}
+	return result;
+}
+
+/* Append the chunks that decls (parsed from the lines of myText
+   in [start, end), which begin at firstLine) make up */
+void IncrementalParser::addChunks(std::vector<Chunk>& chunks,
+  const NodeList<DeclNode> * decls, size_t start, size_t end,
+  size_t firstLine) const{
+	//Where each line of the range starts
+	std::vector<size_t> lineStarts(1, start);
+	for (size_t i = start; i < end; i++){
+		if (myText[i] == '\n'){ lineStarts.push_back(i + 1); }
+	}
+	auto lineEnd = [&](size_t line){
+		size_t next = line - firstLine + 1;
+		return next < lineStarts.size() ? lineStarts[next] : end;
+	};
+
+	bool open = false;
+	Chunk chunk;
+	chunk.shift = 0;
+	chunk.failed = false;
+	for (auto decl : *decls){
+		size_t line = decl->pos().line();
+		size_t lastLine = decl->pos().endLine();
+		if (open && line <= chunk.lastLine){
+			chunk.lastLine = std::max(chunk.lastLine, lastLine);
+			chunk.end = lineEnd(chunk.lastLine);
+			chunk.numGlobals++;
+			continue;
+		}
+		if (open){ chunks.push_back(chunk); }
+		chunk.start = lineStarts[line - firstLine];
+		chunk.end = lineEnd(lastLine);
+		chunk.firstLine = line;
+		chunk.lastLine = lastLine;
+		chunk.numGlobals = 1;
+		open = true;
+	}
+	if (open){ chunks.push_back(chunk); }
+}
+
+size_t IncrementalParser::declsBefore(size_t chunk) const{
+	size_t n = 0;
+	for (size_t i = 0; i < chunk; i++){ n += myChunks[i].numGlobals; }
+	return n;
+}
+
+/* Parse everything from the end of chunk first - 1 to the start
+   of chunk last again, and put what comes of it in place of the
+   chunks [first, last) */
+void IncrementalParser::reparse(size_t first, size_t last,
+  size_t chunkSize){
+	size_t step = 1;
+	while (true){
+		size_t start = first == 0 ? 0 : myChunks[first - 1].end;
+		size_t end = last == myChunks.size() ? myText.size()
+		  : myChunks[last].start;
+		size_t firstLine = first == 0 ? 1
+		  : myChunks[first - 1].lastLine + 1;
+		Parse part = parseText(start, end, firstLine, chunkSize);
+		myWork.bytesLexed += end - start;
+		if (part.atEnd && last < myChunks.size()){
+			//What follows decides this error; take more of it in
+			delete part.arena;
+			last = std::min(myChunks.size(), last + step);
+			step *= 2;
+			continue;
+		}
+
+		std::vector<Chunk> newChunks;
+		if (part.decls != nullptr && part.errors.empty()){
+			addChunks(newChunks, part.decls, start, end, firstLine);
+		} else {
+			//Keep the messages with every line they came from
+			Chunk chunk;
+			chunk.start = start;
+			chunk.end = end;
+			chunk.firstLine = firstLine;
+			chunk.lastLine = firstLine
+			  + countLines(myText.data() + start, end - start);
+			if (end > start && myText[end - 1] == '\n'){ chunk.lastLine--; }
+			chunk.numGlobals = part.decls == nullptr ? 0 : part.decls->size();
+			chunk.shift = 0;
+			chunk.errors = part.errors;
+			chunk.syntaxOut = part.syntaxOut;
+			chunk.syntaxPos = part.syntaxPos;
+			chunk.failed = part.decls == nullptr;
+			newChunks.push_back(chunk);
+		}
+
+		size_t firstDecl = declsBefore(first);
+		size_t lastDecl = firstDecl;
+		for (size_t i = first; i < last; i++){
+			lastDecl += myChunks[i].numGlobals;
+		}
+		auto at = myDecls.erase(myDecls.begin() + static_cast<long>(firstDecl),
+			myDecls.begin() + static_cast<long>(lastDecl));
+		if (part.decls != nullptr){
+			myDecls.insert(at, part.decls->begin(), part.decls->end());
+			myWork.declsParsed += part.decls->size();
+			myArenas.push_back(part.arena);
+			myArenaBytes += part.arena->bytesReserved();
+		} else {
+			delete part.arena;
+		}
+
+		auto chunkAt = myChunks.erase(
+			myChunks.begin() + static_cast<long>(first),
+			myChunks.begin() + static_cast<long>(last));
+		myChunks.insert(chunkAt, newChunks.begin(), newChunks.end());
+		return;
+	}
+}
+
+bool IncrementalParser::edit(size_t offset, size_t removed,
+  const std::string& inserted){
+	if (offset > myText.size() || removed > myText.size() - offset){
+		throw new UserError("Edit past the end of the text");
+	}
+	if (myArenaBytes > 2 * myFullBytes + ARENA_SLACK){
+		myText.replace(offset, removed, inserted);
+		return parseAll();
+	}
+	myWork = Work();
+
+	//The chunks the edit touches are [first, last). A chunk
+	// that ends right where the edit starts is only touched if
+	// its last line has no newline to end it, or it failed (its
+	// syntax error may be that the text ran out)
+	auto endsBefore = [&](const Chunk& c){
+		return c.end < offset
+		  || (c.end == offset && myText[c.end - 1] == '\n' && !c.failed);
+	};
+	auto firstIt = std::partition_point(myChunks.begin(), myChunks.end(),
+		endsBefore);
+	auto lastIt = std::partition_point(firstIt, myChunks.end(),
+		[&](const Chunk& c){ return c.start <= offset + removed; });
+	size_t first = static_cast<size_t>(firstIt - myChunks.begin());
+	size_t last = static_cast<size_t>(lastIt - myChunks.begin());
+
+	long lineDelta = static_cast<long>(countLines(inserted.data(),
+		inserted.size()))
+	  - static_cast<long>(countLines(myText.data() + offset, removed));
+	long byteDelta = static_cast<long>(inserted.size())
+	  - static_cast<long>(removed);
+	myText.replace(offset, removed, inserted);
+
+	//Everything after the edit moves along with the text (the
+	// nodes only when program() is called)
+	bool stale = false;
+	for (size_t i = last; i < myChunks.size(); i++){
+		Chunk& c = myChunks[i];
+		move(c.start, byteDelta);
+		move(c.end, byteDelta);
+		move(c.firstLine, lineDelta);
+		move(c.lastLine, lineDelta);
+		c.shift += lineDelta;
+		stale = stale || !c.errors.empty();
+	}
+
+	size_t after = myChunks.size() - last;
+	reparse(first, last, EDIT_CHUNK_SIZE);
+
+	//Messages further down still give the old line numbers
+	if (stale && lineDelta != 0){
+		for (size_t i = myChunks.size() - after; i < myChunks.size(); i++){
+			if (myChunks[i].errors.empty()){ continue; }
+			size_t left = myChunks.size() - i - 1;
+			reparse(i, i + 1, EDIT_CHUNK_SIZE);
+			i = myChunks.size() - left - 1;
+		}
+	}
+	myWork.declsReused = myDecls.size() - myWork.declsParsed;
+	return finish();
+}
+
+/* Gather the messages. Returns whether everything parsed */
+bool IncrementalParser::finish(){
+	delete myProgram;
+	myProgram = nullptr;
+	myErrors.clear();
+	mySyntaxOut.clear();
+	myParsed = false;
+	for (const auto& chunk : myChunks){
+		myErrors += chunk.errors;
+		if (chunk.failed){
+			//A full parse stops here
+			mySyntaxOut = chunk.syntaxOut;
+			mySyntaxPos = chunk.syntaxPos;
+			return false;
+		}
+	}
+	myParsed = true;
+	return true;
+}
+
+ProgramNode * IncrementalParser::program(){
+	if (!myParsed || myProgram != nullptr){ return myProgram; }
+
+	size_t decl = 0;
+	for (auto& chunk : myChunks){
+		for (size_t i = 0; i < chunk.numGlobals; i++, decl++){
+			if (chunk.shift != 0){ myDecls[decl]->shiftLines(chunk.shift); }
+		}
+		chunk.shift = 0;
+	}
+
+	//Only the list is new. The nodes stay in the session's
+	// arenas rather than going with the ProgramNode
+	delete myListArena;
+	myListArena = new Arena(sizeof(DeclNode *) * myDecls.size() + 64);
+	auto globals = myListArena->make<NodeList<DeclNode>>(myListArena);
+	globals->reserve(myDecls.size());
+	for (auto decl : myDecls){ globals->push_back(decl); }
+	myProgram = new ProgramNode(nullptr, globals);
+	return myProgram;
+}
+
+} //End namespace cminusminus
@@ -0,0 +1,140 @@
+#ifndef CMINUSMINUS_INCREMENTAL_HPP
+#define CMINUSMINUS_INCREMENTAL_HPP
+
+#include <string>
+#include <vector>
+#include "ast.hpp"
+
+namespace cminusminus{
+
+/**
+* \class IncrementalParser
+* The text and AST of one file, kept up to date across edits for
+* an editor that reparses on every change. An edit re-lexes and
+* reparses only the globals on the lines it touches (with the
+* blank lines and comments around them); the other globals are
+* reused as they are (moved up or down if the edit removed or
+* added lines above them).
+*
+* No token spans a line break (comments end with the line and a
+* string literal cannot hold a newline), so scanning can start
+* over at the beginning of any line; and a program is just its
+* globals one after another, so the parser is back where it
+* started after each one. Parsing the touched lines on their own
+* therefore gives what parsing the whole file would, with one
+* exception: a syntax error at the very end of those lines may
+* depend on what follows, so then the following globals are
+* taken in too (more each time) until the error is settled.
+*
+* Lines that do not parse are remembered, with their messages,
+* until an edit fixes them. The messages are those a full parse
+* would print: the first syntax error, and any scanner errors
+* before it.
+**/
+class IncrementalParser{
+public:
+	IncrementalParser();
+	~IncrementalParser();
+	IncrementalParser(const IncrementalParser&) = delete;
+	IncrementalParser& operator=(const IncrementalParser&) = delete;
+
+	/** Parse textIn from scratch. Returns false if it does not
+	 * parse **/
+	bool reset(const std::string& textIn);
+	/** Replace the removed bytes at offset with inserted and
+	 * bring the AST up to date. Returns false if the new text
+	 * does not parse. Throws a UserError if the edit does not
+	 * fit in the text **/
+	bool edit(size_t offset, size_t removed, const std::string& inserted);
+
+	const std::string& text() const { return myText; }
+	/** The AST of text(), or nullptr if it does not parse. Good
+	 * until the next reset or edit. The globals that edits moved
+	 * up or down get their new lines here, all at once, so edits
+	 * in between that do not look at the tree do not pay for it **/
+	ProgramNode * program();
+	/** What parsing text() reports: the messages cmmc -p would
+	 * print on standard error and (for a syntax error) on
+	 * standard output **/
+	const std::string& errors() const { return myErrors; }
+	const std::string& syntaxOutput() const { return mySyntaxOut; }
+	/** Where the syntax error in syntaxOutput() is **/
+	const Position& syntaxErrorPos() const { return mySyntaxPos; }
+
+	/** What the last reset or edit had to do **/
+	struct Work{
+		bool full = false;
+		size_t bytesLexed = 0;
+		size_t declsParsed = 0;
+		size_t declsReused = 0;
+	};
+	const Work& lastWork() const { return myWork; }
+
+private:
+	/* Whole lines of the text (start is at the beginning of a
+	   line; end is just past a newline, or the end of the text)
+	   holding either a run of globals whose lines touch, or all
+	   the lines of one reparse that reported something */
+	struct Chunk{
+		size_t start;
+		size_t end;
+		size_t firstLine;
+		size_t lastLine;
+		size_t numGlobals;
+		/* Lines the chunk's globals still have to move */
+		long shift;
+		std::string errors;
+		std::string syntaxOut;
+		Position syntaxPos;
+		/* The parse stopped with a syntax error in here */
+		bool failed;
+	};
+
+	/* One parse of part of the text */
+	struct Parse{
+		Arena * arena;
+		/* nullptr after a syntax error */
+		NodeList<DeclNode> * decls;
+		std::string errors;
+		std::string syntaxOut;
+		Position syntaxPos;
+		/* The syntax error was at the end of the part */
+		bool atEnd;
+	};
+
+	bool parseAll();
+	Parse parseText(size_t start, size_t end, size_t firstLine,
+	  size_t chunkSize);
+	void reparse(size_t first, size_t last, size_t chunkSize);
+	void addChunks(std::vector<Chunk>& chunks,
+	  const NodeList<DeclNode> * decls, size_t start, size_t end,
+	  size_t firstLine) const;
+	size_t declsBefore(size_t chunk) const;
+	bool finish();
+	void clear();
+
+	std::string myText;
+	std::vector<Chunk> myChunks;
+	/* The globals of all the chunks, in order */
+	std::vector<DeclNode *> myDecls;
+	/* Hold every node in myDecls, and whatever older trees
+	   left behind */
+	std::vector<Arena *> myArenas;
+	size_t myArenaBytes;
+	/* Arena bytes needed by the last full parse */
+	size_t myFullBytes;
+	/* Everything parsed at the last reset or edit */
+	bool myParsed;
+	/* Built by program() */
+	ProgramNode * myProgram;
+	/* Holds the list of myProgram's globals */
+	Arena * myListArena;
+	std::string myErrors;
+	std::string mySyntaxOut;
+	Position mySyntaxPos;
+	Work myWork;
+};
+
+} //End namespace cminusminus
+
+#endif
@@ -0,0 +1,126 @@
+#include "ast.hpp"
+#include "symindex.hpp"
+
+namespace cminusminus{
+
+/*
+Each index adds its names to the SymbolIndex in the order they
+appear in the text, declaring before it looks up, so a name can
+only refer to a declaration above it (or to the function it is
+in). Types and literals hold no names and use ASTNode::index,
+which does nothing.
+*/
+
+template <typename T>
+static void indexList(const NodeList<T> * nodes, SymbolIndex& index){
+	for (auto node : *nodes){
+		node->index(index);
+	}
+}
+
+void ProgramNode::index(SymbolIndex& index) const{
+	indexList(myGlobals, index);
+}
+
+void VarDeclNode::index(SymbolIndex& index) const{
+	index.declare(myId, this, SymbolIndex::VARIABLE);
+}
+
+void FormalDeclNode::index(SymbolIndex& index) const{
+	index.declare(myId, this, SymbolIndex::PARAMETER);
+}
+
+void FnDeclNode::index(SymbolIndex& index) const{
+	size_t decl = index.declare(myId, this, SymbolIndex::FUNCTION);
+	index.enterFunction(decl);
+	index.enterScope();
+	indexList(myFormals, index);
+	indexList(myBody, index);
+	index.leaveScope();
+	index.leaveFunction();
+}
+
+void IDNode::index(SymbolIndex& index) const{
+	index.use(this);
+}
+
+void DerefNode::index(SymbolIndex& index) const{
+	myId->index(index);
+}
+
+void RefNode::index(SymbolIndex& index) const{
+	myId->index(index);
+}
+
+void AssignExpNode::index(SymbolIndex& index) const{
+	myDst->index(index);
+	mySrc->index(index);
+}
+
+void CallExpNode::index(SymbolIndex& index) const{
+	myId->index(index);
+	indexList(myArgs, index);
+}
+
+void BinaryExpNode::index(SymbolIndex& index) const{
+	myLhs->index(index);
+	myRhs->index(index);
+}
+
+void UnaryExpNode::index(SymbolIndex& index) const{
+	myExp->index(index);
+}
+
+void AssignStmtNode::index(SymbolIndex& index) const{
+	myExp->index(index);
+}
+
+void PostIncStmtNode::index(SymbolIndex& index) const{
+	myLVal->index(index);
+}
+
+void PostDecStmtNode::index(SymbolIndex& index) const{
+	myLVal->index(index);
+}
+
+void ReadStmtNode::index(SymbolIndex& index) const{
+	myDst->index(index);
+}
+
+void WriteStmtNode::index(SymbolIndex& index) const{
+	mySrc->index(index);
+}
+
+void WhileStmtNode::index(SymbolIndex& index) const{
+	myCond->index(index);
+	index.enterScope();
+	indexList(myBody, index);
+	index.leaveScope();
+}
+
+void IfStmtNode::index(SymbolIndex& index) const{
+	myCond->index(index);
+	index.enterScope();
+	indexList(myBody, index);
+	index.leaveScope();
+}
+
+void IfElseStmtNode::index(SymbolIndex& index) const{
+	myCond->index(index);
+	index.enterScope();
+	indexList(myBodyTrue, index);
+	index.leaveScope();
+	index.enterScope();
+	indexList(myBodyFalse, index);
+	index.leaveScope();
+}
+
+void ReturnStmtNode::index(SymbolIndex& index) const{
+	if (myExp != nullptr){ myExp->index(index); }
+}
+
+void CallStmtNode::index(SymbolIndex& index) const{
+	myCall->index(index);
+}
+
+} // End namespace cminusminus
@@ -0,0 +1,269 @@
+#include "errors.hpp"
+#include "ir.hpp"
+#include "symtable.hpp"
+#include "types.hpp"
+
+namespace cminusminus{
+
+static const char * const OP_NAMES[IR_OP_COUNT] = {
+	"MOV", "ADD", "SUB", "MUL", "DIV", "NEG", "NOT",
+	"EQ", "NE", "LT", "LE", "GT", "GE",
+	"ADDR", "LOAD", "STORE", "JMP", "JZ", "JNZ",
+	"PARAM", "ARG", "CALL", "RET", "READ", "WRITE"
+};
+
+static const char * const IO_NAMES[] = { "int", "short", "bool", "string" };
+
+uint8_t irSize(const DataType * type){
+	switch (type->getKind()){
+	case DataType::BOOL: return 1;
+	case DataType::SHORT: return 2;
+	case DataType::INT: return 4;
+	case DataType::VOID: return 0;
+	default: return 8;
+	}
+}
+
+static bool isTerminator(IROp op){
+	return op == IR_JMP || op == IR_JZ || op == IR_JNZ || op == IR_RET;
+}
+
+size_t IRFunction::successors(size_t block, uint32_t out[2]) const{
+	const BasicBlock& bb = blocks[block];
+	uint32_t next = static_cast<uint32_t>(block + 1);
+	bool hasNext = next < blocks.size();
+	if (bb.first == bb.end){
+		if (!hasNext){ return 0; }
+		out[0] = next;
+		return 1;
+	}
+	const Instr& last = code[bb.end - 1];
+	switch (last.op){
+	case IR_RET:
+		return 0;
+	case IR_JMP:
+		out[0] = last.b.index();
+		return 1;
+	case IR_JZ: case IR_JNZ:
+		out[0] = last.b.index();
+		if (!hasNext || next == out[0]){ return 1; }
+		out[1] = next;
+		return 2;
+	default:
+		if (!hasNext){ return 0; }
+		out[0] = next;
+		return 1;
+	}
+}
+
+IRBuilder::IRBuilder(IRProgram& progIn, size_t symbols)
+: myProg(progIn), myFn(nullptr), myTargeted(false), myLocs(symbols){ }
+
+Opd IRBuilder::location(const SemSymbol * sym) const{
+	Opd loc = myLocs[sym->getId()];
+	if (loc.isNone()){
+		std::string msg = "No location for ";
+		msg += sym->getName().str();
+		throw new InternalError(msg.c_str());
+	}
+	return loc;
+}
+
+void IRBuilder::place(const SemSymbol * sym, Opd loc){
+	myLocs[sym->getId()] = loc;
+}
+
+Opd IRBuilder::local(const SemSymbol * sym){
+	uint8_t size = irSize(sym->getDataType());
+	Opd loc;
+	if (sym->isAddressTaken()){
+		loc = Opd::make(Opd::SLOT, myFn->slots.size());
+		myFn->slots.push_back({sym->getName(), size});
+	} else {
+		loc = Opd::make(Opd::VREG, myFn->vregs.size());
+		myFn->vregs.push_back({sym->getName(), true, size});
+	}
+	place(sym, loc);
+	return loc;
+}
+
+Opd IRBuilder::global(const SemSymbol * sym){
+	Opd loc = Opd::make(Opd::GLOBAL, myProg.globals.size());
+	myProg.globals.push_back({sym->getName(), irSize(sym->getDataType())});
+	place(sym, loc);
+	return loc;
+}
+
+Opd IRBuilder::beginFunction(Symbol name, uint32_t formals, uint8_t retSize){
+	Opd fn = Opd::make(Opd::FN, myProg.functions.size());
+	myProg.functions.emplace_back();
+	myFn = &myProg.functions.back();
+	myFn->name = name;
+	myFn->formals = formals;
+	myFn->retSize = retSize;
+	myFn->blocks.push_back({0, 0});
+	myTargeted = false;
+	return fn;
+}
+
+void IRBuilder::endFunction(){
+	BasicBlock& last = myFn->blocks.back();
+	if (last.first == last.end && !myTargeted && myFn->blocks.size() > 1){
+		//Nothing gets here: the code before ended in a jump or
+		// return, and no jump goes to it
+		myFn->blocks.pop_back();
+	} else {
+		emit(IR_RET, 0, Opd());
+		myFn->blocks.pop_back();
+	}
+	myFn = nullptr;
+}
+
+Opd IRBuilder::temp(uint8_t size){
+	Opd t = Opd::make(Opd::VREG, myFn->vregs.size());
+	myFn->vregs.push_back({Symbol(), false, size});
+	return t;
+}
+
+Opd IRBuilder::imm(long value){
+	Opd i = Opd::make(Opd::IMM, myProg.imms.size());
+	myProg.imms.push_back(value);
+	return i;
+}
+
+Opd IRBuilder::str(const std::string * text){
+	Opd s = Opd::make(Opd::STR, myProg.strings.size());
+	myProg.strings.push_back(text);
+	return s;
+}
+
+size_t IRBuilder::emit(IROp op, uint8_t size, Opd dst, Opd a, Opd b,
+  uint16_t aux){
+	size_t idx = myFn->code.size();
+	myFn->code.push_back({op, size, aux, dst, a, b});
+	uint32_t end = static_cast<uint32_t>(myFn->code.size());
+	myFn->blocks.back().end = end;
+	if (isTerminator(op)){
+		myFn->blocks.push_back({end, end});
+		//A conditional jump falls into the new block when it
+		// does not jump
+		myTargeted = op == IR_JZ || op == IR_JNZ;
+	}
+	return idx;
+}
+
+void IRBuilder::move(uint8_t size, Opd dst, Opd a){
+	const BasicBlock& block = myFn->blocks.back();
+	if (a.isVReg() && !myFn->vregs[a.index()].named
+	  && block.end > block.first){
+		Instr& last = myFn->code[block.end - 1];
+		if (last.dst == a){
+			last.dst = dst;
+			return;
+		}
+	}
+	emit(IR_MOV, size, dst, a);
+}
+
+Opd IRBuilder::startBlock(){
+	uint32_t end = myFn->blocks.back().end;
+	if (end > myFn->blocks.back().first){
+		myFn->blocks.push_back({end, end});
+	}
+	myTargeted = true;
+	return Opd::make(Opd::BLOCK, myFn->blocks.size() - 1);
+}
+
+bool IRBuilder::reachable() const{
+	const BasicBlock& block = myFn->blocks.back();
+	return block.end > block.first || myTargeted || myFn->blocks.size() == 1;
+}
+
+std::string IRProgram::opdString(const IRFunction& fn, Opd opd) const{
+	uint32_t i = opd.index();
+	switch (opd.kind()){
+	case Opd::NONE:
+		return "_";
+	case Opd::VREG:
+		return "%" + std::to_string(i);
+	case Opd::IMM:
+		return std::to_string(imms[i]);
+	case Opd::GLOBAL:
+		return globals[i].name.str();
+	case Opd::SLOT:
+		return "[" + std::to_string(i) + "]";
+	case Opd::STR:
+		return "str_" + std::to_string(i);
+	case Opd::FN:
+		return functions[i].name.str();
+	case Opd::BLOCK:
+		return "b" + std::to_string(i);
+	}
+	return "?";
+}
+
+std::string IRProgram::instrString(const IRFunction& fn,
+  const Instr& ins) const{
+	std::string text;
+	if (!ins.dst.isNone()){
+		text += opdString(fn, ins.dst) + " = ";
+	}
+	text += OP_NAMES[ins.op];
+	switch (ins.op){
+	case IR_READ: case IR_WRITE:
+		text += ".";
+		text += IO_NAMES[ins.aux];
+		break;
+	case IR_PARAM: case IR_ARG:
+		text += " " + std::to_string(static_cast<unsigned>(ins.aux));
+		if (!ins.a.isNone()){ text += ","; }
+		break;
+	case IR_MOV: case IR_JMP: case IR_JZ: case IR_JNZ: case IR_CALL:
+	case IR_RET:
+		break;
+	default:
+		text += "." + std::to_string(static_cast<unsigned>(ins.size));
+	}
+	if (!ins.a.isNone()){
+		text += " " + opdString(fn, ins.a);
+	}
+	if (!ins.b.isNone()){
+		text += ins.a.isNone() ? " " : ", ";
+		text += opdString(fn, ins.b);
+	}
+	return text;
+}
+
+void IRProgram::dump(std::ostream& out) const{
+	out << "[BEGIN GLOBALS]\n";
+	for (const IRGlobal& global : globals){
+		out << global.name.str() << " " << static_cast<int>(global.size)
+		<< "\n";
+	}
+	for (size_t i = 0; i < strings.size(); i++){
+		out << "str_" << i << " " << *strings[i] << "\n";
+	}
+	out << "[END GLOBALS]\n";
+	for (const IRFunction& fn : functions){
+		out << "\n[BEGIN " << fn.name.str() << " LOCALS]\n";
+		for (size_t v = 0; v < fn.vregs.size(); v++){
+			if (!fn.vregs[v].named){ continue; }
+			out << fn.vregs[v].name.str() << " %" << v << " "
+			<< static_cast<int>(fn.vregs[v].size) << "\n";
+		}
+		for (size_t i = 0; i < fn.slots.size(); i++){
+			out << fn.slots[i].name.str() << " [" << i << "] "
+			<< static_cast<int>(fn.slots[i].size) << "\n";
+		}
+		out << "[END " << fn.name.str() << " LOCALS]\n";
+		for (size_t b = 0; b < fn.blocks.size(); b++){
+			out << "b" << b << ":\n";
+			const BasicBlock& block = fn.blocks[b];
+			for (uint32_t i = block.first; i < block.end; i++){
+				out << "\t" << instrString(fn, fn.code[i]) << "\n";
+			}
+		}
+	}
+}
+
+} //End namespace cminusminus
@@ -0,0 +1,231 @@
+#ifndef CMINUSMINUS_IR_HPP
+#define CMINUSMINUS_IR_HPP
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "symbol.hpp"
+
+namespace cminusminus{
+
+class DataType;
+class SemSymbol;
+
+/* The three-address code operations. dst is what an instruction
+   writes and a, b what it reads; jumps keep their target block
+   in b. */
+enum IROp : uint8_t {
+	IR_MOV,     // dst = a
+	IR_ADD,     // dst = a + b
+	IR_SUB,
+	IR_MUL,
+	IR_DIV,
+	IR_NEG,     // dst = -a
+	IR_NOT,     // dst = !a
+	IR_EQ,      // dst = a == b
+	IR_NE,
+	IR_LT,
+	IR_LE,
+	IR_GT,
+	IR_GE,
+	IR_ADDR,    // dst = the address of a (a GLOBAL or SLOT)
+	IR_LOAD,    // dst = the size bytes that a points to
+	IR_STORE,   // the size bytes that a points to = b
+	IR_JMP,     // go to block b
+	IR_JZ,      // go to block b if a is false
+	IR_JNZ,     // go to block b if a is true
+	IR_PARAM,   // dst = formal number aux
+	IR_ARG,     // actual number aux of the next IR_CALL = a
+	IR_CALL,    // dst (if any) = call a, with aux actuals
+	IR_RET,     // return a (if any)
+	IR_READ,    // dst = a value read from input, as aux says
+	IR_WRITE,   // write a, as aux says
+	IR_OP_COUNT
+};
+
+/* What IR_READ and IR_WRITE read or write (in Instr::aux) */
+enum IRIoKind : uint16_t { IO_INT, IO_SHORT, IO_BOOL, IO_STRING };
+
+/**
+* \class Opd
+* An operand, packed into 32 bits: its kind in the top three
+* and an index in the rest. A VREG is one of the function's
+* virtual registers and a SLOT one of its stack slots (for the
+* variables whose address is taken); a GLOBAL, STR (string
+* literal), FN or IMM (immediate) indexes the program's own
+* table of those; a BLOCK is one of the function's blocks.
+* GLOBAL and SLOT operands are memory: reading one reads the
+* variable, at the variable's own size.
+**/
+class Opd{
+public:
+	enum Kind { NONE, VREG, IMM, GLOBAL, SLOT, STR, FN, BLOCK };
+
+	Opd() : myBits(0){ }
+	static Opd make(Kind kind, size_t index){
+		return Opd((static_cast<uint32_t>(kind) << INDEX_BITS)
+		  | static_cast<uint32_t>(index));
+	}
+	Kind kind() const { return static_cast<Kind>(myBits >> INDEX_BITS); }
+	uint32_t index() const { return myBits & INDEX_MASK; }
+	bool isNone() const { return myBits == 0; }
+	bool isVReg() const { return kind() == VREG; }
+	/** A variable in memory (GLOBAL or SLOT) **/
+	bool isMem() const { return kind() == GLOBAL || kind() == SLOT; }
+	bool operator==(Opd other) const { return myBits == other.myBits; }
+	bool operator!=(Opd other) const { return myBits != other.myBits; }
+
+	static const uint32_t INDEX_BITS = 29;
+	static const uint32_t INDEX_MASK = (1u << INDEX_BITS) - 1;
+private:
+	explicit Opd(uint32_t bits) : myBits(bits){ }
+	uint32_t myBits;
+};
+
+/** One instruction: 16 bytes, kept by value in its function's
+ * code array. size is the size in bytes (1, 2, 4 or 8) of the
+ * value the instruction makes or, for IR_LOAD and IR_STORE,
+ * moves; aux is the extra number a few operations take **/
+struct Instr{
+	IROp op;
+	uint8_t size;
+	uint16_t aux;
+	Opd dst;
+	Opd a;
+	Opd b;
+};
+
+/** A basic block: the instructions [first, end) of its
+ * function. Only the last can jump or return, and only the
+ * first can be jumped to. The blocks of a function cover its
+ * code in order, so a block that does not end in a jump or
+ * return falls through to the next one **/
+struct BasicBlock{
+	uint32_t first;
+	uint32_t end;
+};
+
+/** A virtual register: the variable it holds (if it holds one
+ * rather than a temporary) and its size **/
+struct VRegInfo{
+	Symbol name;
+	bool named;
+	uint8_t size;
+};
+
+/** A stack slot, for a variable whose address is taken **/
+struct SlotInfo{
+	Symbol name;
+	uint8_t size;
+};
+
+struct IRGlobal{
+	Symbol name;
+	uint8_t size;
+};
+
+struct IRFunction{
+	Symbol name;
+	uint32_t formals;
+	/* The size of the return value, 0 for a void function */
+	uint8_t retSize;
+	std::vector<Instr> code;
+	std::vector<BasicBlock> blocks;
+	std::vector<VRegInfo> vregs;
+	std::vector<SlotInfo> slots;
+
+	/** The blocks that control can go to from block, put in
+	 * out; returns how many (0 to 2) **/
+	size_t successors(size_t block, uint32_t out[2]) const;
+};
+
+/**
+* \class IRProgram
+* A whole program in three-address code. Everything is kept in
+* flat arrays of plain structs: a function's instructions in
+* one vector, its blocks as index ranges of that vector, and
+* operands as indexes into the tables here. Making or walking
+* an instruction allocates nothing, and a pass over a function
+* is a linear scan of its code.
+**/
+class IRProgram{
+public:
+	std::vector<IRGlobal> globals;
+	/* The text of each string literal, quotes and escapes
+	   included (owned by the AST it was lowered from) */
+	std::vector<const std::string *> strings;
+	std::vector<long> imms;
+	std::vector<IRFunction> functions;
+
+	/** Write the program as text, for -a **/
+	void dump(std::ostream& out) const;
+	/** The instruction as dump() writes it **/
+	std::string instrString(const IRFunction& fn, const Instr& ins) const;
+	std::string opdString(const IRFunction& fn, Opd opd) const;
+};
+
+/** The size in bytes of a value of type **/
+uint8_t irSize(const DataType * type);
+
+/**
+* \class IRBuilder
+* The state of lowering an AST into an IRProgram: where each
+* variable and function was put, and the function being built,
+* to which emit() appends. Jumps go to blocks that may not exist
+* yet, so a forward jump is emitted with no target and patched
+* once its target block is started.
+**/
+class IRBuilder{
+public:
+	IRBuilder(IRProgram& progIn, size_t symbols);
+	IRProgram& program(){ return myProg; }
+
+	/** Where sym was put (a VREG, SLOT, GLOBAL or FN) **/
+	Opd location(const SemSymbol * sym) const;
+	void place(const SemSymbol * sym, Opd loc);
+	/** Put a variable of the function being built in a new
+	 * vreg or, if its address is taken, a new stack slot **/
+	Opd local(const SemSymbol * sym);
+	Opd global(const SemSymbol * sym);
+
+	/** Start a function; returns its FN operand **/
+	Opd beginFunction(Symbol name, uint32_t formals, uint8_t retSize);
+	void endFunction();
+	bool inFunction() const { return myFn != nullptr; }
+
+	Opd temp(uint8_t size);
+	Opd imm(long value);
+	Opd str(const std::string * text);
+
+	/** Append an instruction to the function being built and
+	 * return its index. A jump or return ends the block, so
+	 * whatever follows it starts another **/
+	size_t emit(IROp op, uint8_t size, Opd dst, Opd a = Opd(),
+	  Opd b = Opd(), uint16_t aux = 0);
+	/** Move a into dst. If a is a temporary the last
+	 * instruction of this block just made, that instruction
+	 * makes dst instead **/
+	void move(uint8_t size, Opd dst, Opd a);
+	/** Make sure the code that follows starts a block (one
+	 * that can be jumped to) and return it **/
+	Opd startBlock();
+	/** Whether control can reach the end of the code so far
+	 * (it cannot straight after a return or an unconditional
+	 * jump) **/
+	bool reachable() const;
+	/** Set the target of the jump at instr **/
+	void patch(size_t instr, Opd block){ myFn->code[instr].b = block; }
+
+private:
+	IRProgram& myProg;
+	IRFunction * myFn;
+	/* Whether a jump, or a conditional jump not taken, may go
+	   to the function's last block */
+	bool myTargeted;
+	std::vector<Opd> myLocs;
+};
+
+} //End namespace cminusminus
+
+#endif
@@ -0,0 +1,273 @@
+#include <cstdlib>
+#include <cstring>
+#include "json.hpp"
+
+namespace cminusminus{
+
+/* Nesting deeper than this is refused rather than recursed into */
+static const int MAX_DEPTH = 256;
+
+static const JsonValue NULL_VALUE;
+
+/**
+* \class JsonParser
+* Recursive descent over one JSON text
+**/
+class JsonParser{
+public:
+	JsonParser(const char * textIn, size_t len)
+	: myAt(textIn), myEnd(textIn + len){ }
+
+	bool parseDocument(JsonValue& out){
+		if (!value(out, 0)){ return false; }
+		skipSpace();
+		return myAt == myEnd;
+	}
+
+private:
+	void skipSpace(){
+		while (myAt < myEnd && (*myAt == ' ' || *myAt == '\t'
+		  || *myAt == '\n' || *myAt == '\r')){
+			myAt++;
+		}
+	}
+
+	bool literal(const char * word){
+		size_t len = std::strlen(word);
+		if (static_cast<size_t>(myEnd - myAt) < len
+		  || std::memcmp(myAt, word, len) != 0){
+			return false;
+		}
+		myAt += len;
+		return true;
+	}
+
+	bool value(JsonValue& out, int depth){
+		skipSpace();
+		if (myAt == myEnd || depth > MAX_DEPTH){ return false; }
+		switch (*myAt){
+		case '{': return object(out, depth);
+		case '[': return array(out, depth);
+		case '"':
+			out.myType = JsonValue::STRING;
+			return string(out.myStr);
+		case 't':
+			out.myType = JsonValue::BOOL;
+			out.myBool = true;
+			return literal("true");
+		case 'f':
+			out.myType = JsonValue::BOOL;
+			return literal("false");
+		case 'n':
+			return literal("null");
+		default:
+			return number(out);
+		}
+	}
+
+	bool object(JsonValue& out, int depth){
+		out.myType = JsonValue::OBJECT;
+		myAt++;
+		skipSpace();
+		if (myAt < myEnd && *myAt == '}'){
+			myAt++;
+			return true;
+		}
+		while (true){
+			skipSpace();
+			std::string key;
+			if (myAt == myEnd || *myAt != '"' || !string(key)){ return false; }
+			skipSpace();
+			if (myAt == myEnd || *myAt != ':'){ return false; }
+			myAt++;
+			out.myMembers.emplace_back(key, JsonValue());
+			if (!value(out.myMembers.back().second, depth + 1)){ return false; }
+			skipSpace();
+			if (myAt == myEnd){ return false; }
+			if (*myAt == '}'){
+				myAt++;
+				return true;
+			}
+			if (*myAt++ != ','){ return false; }
+		}
+	}
+
+	bool array(JsonValue& out, int depth){
+		out.myType = JsonValue::ARRAY;
+		myAt++;
+		skipSpace();
+		if (myAt < myEnd && *myAt == ']'){
+			myAt++;
+			return true;
+		}
+		while (true){
+			out.myItems.emplace_back();
+			if (!value(out.myItems.back(), depth + 1)){ return false; }
+			skipSpace();
+			if (myAt == myEnd){ return false; }
+			if (*myAt == ']'){
+				myAt++;
+				return true;
+			}
+			if (*myAt++ != ','){ return false; }
+		}
+	}
+
+	bool hex4(unsigned * out){
+		if (myEnd - myAt < 4){ return false; }
+		*out = 0;
+		for (int i = 0; i < 4; i++){
+			char c = *myAt++;
+			unsigned digit;
+			if (c >= '0' && c <= '9'){ digit = static_cast<unsigned>(c - '0'); }
+			else if (c >= 'a' && c <= 'f'){ digit = static_cast<unsigned>(c - 'a' + 10); }
+			else if (c >= 'A' && c <= 'F'){ digit = static_cast<unsigned>(c - 'A' + 10); }
+			else { return false; }
+			*out = *out * 16 + digit;
+		}
+		return true;
+	}
+
+	static void putUtf8(std::string& out, unsigned code){
+		if (code < 0x80){
+			out += static_cast<char>(code);
+		} else if (code < 0x800){
+			out += static_cast<char>(0xC0 | (code >> 6));
+			out += static_cast<char>(0x80 | (code & 0x3F));
+		} else if (code < 0x10000){
+			out += static_cast<char>(0xE0 | (code >> 12));
+			out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+			out += static_cast<char>(0x80 | (code & 0x3F));
+		} else {
+			out += static_cast<char>(0xF0 | (code >> 18));
+			out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+			out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+			out += static_cast<char>(0x80 | (code & 0x3F));
+		}
+	}
+
+	bool string(std::string& out){
+		myAt++;
+		while (myAt < myEnd){
+			char c = *myAt++;
+			if (c == '"'){ return true; }
+			if (c != '\\'){
+				out += c;
+				continue;
+			}
+			if (myAt == myEnd){ return false; }
+			char esc = *myAt++;
+			switch (esc){
+			case '"': case '\\': case '/': out += esc; break;
+			case 'b': out += '\b'; break;
+			case 'f': out += '\f'; break;
+			case 'n': out += '\n'; break;
+			case 'r': out += '\r'; break;
+			case 't': out += '\t'; break;
+			case 'u': {
+				unsigned code;
+				if (!hex4(&code)){ return false; }
+				//A surrogate pair makes one code point
+				unsigned low;
+				if (code >= 0xD800 && code < 0xDC00 && myEnd - myAt >= 6
+				  && myAt[0] == '\\' && myAt[1] == 'u'){
+					myAt += 2;
+					if (!hex4(&low)){ return false; }
+					code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+				}
+				putUtf8(out, code);
+				break;
+			}
+			default:
+				return false;
+			}
+		}
+		return false;
+	}
+
+	bool number(JsonValue& out){
+		const char * start = myAt;
+		while (myAt < myEnd && std::strchr("+-0123456789.eE", *myAt) != nullptr){
+			myAt++;
+		}
+		if (myAt == start){ return false; }
+		std::string digits(start, static_cast<size_t>(myAt - start));
+		char * end = nullptr;
+		out.myType = JsonValue::NUMBER;
+		out.myNum = std::strtod(digits.c_str(), &end);
+		return *end == '\0';
+	}
+
+	const char * myAt;
+	const char * myEnd;
+};
+
+bool JsonValue::parse(const char * text, size_t len, JsonValue& out){
+	out = JsonValue();
+	JsonParser parser(text, len);
+	return parser.parseDocument(out);
+}
+
+const JsonValue& JsonValue::operator[](size_t i) const{
+	return i < myItems.size() ? myItems[i] : NULL_VALUE;
+}
+
+const JsonValue& JsonValue::operator[](const char * key) const{
+	for (const auto& member : myMembers){
+		if (member.first == key){ return member.second; }
+	}
+	return NULL_VALUE;
+}
+
+void JsonValue::write(std::ostream& out) const{
+	switch (myType){
+	case NUL: out << "null"; break;
+	case BOOL: out << (myBool ? "true" : "false"); break;
+	case NUMBER: {
+		//Request ids are integers; keep them that way
+		long long whole = static_cast<long long>(myNum);
+		if (static_cast<double>(whole) == myNum){ out << whole; }
+		else { out << myNum; }
+		break;
+	}
+	case STRING: putJsonString(out, myStr); break;
+	case ARRAY: {
+		out << '[';
+		for (size_t i = 0; i < myItems.size(); i++){
+			if (i > 0){ out << ','; }
+			myItems[i].write(out);
+		}
+		out << ']';
+		break;
+	}
+	case OBJECT: {
+		out << '{';
+		for (size_t i = 0; i < myMembers.size(); i++){
+			if (i > 0){ out << ','; }
+			putJsonString(out, myMembers[i].first);
+			out << ':';
+			myMembers[i].second.write(out);
+		}
+		out << '}';
+		break;
+	}
+	}
+}
+
+void putJsonString(std::ostream& out, const std::string& s){
+	out << '"';
+	for (char c : s){
+		unsigned char u = static_cast<unsigned char>(c);
+		if (c == '"' || c == '\\'){
+			out << '\\' << c;
+		} else if (u < 0x20){
+			const char * hex = "0123456789abcdef";
+			out << "\\u00" << hex[u >> 4] << hex[u & 0xF];
+		} else {
+			out << c;
+		}
+	}
+	out << '"';
+}
+
+} //End namespace cminusminus
@@ -0,0 +1,59 @@
+#ifndef CMINUSMINUS_JSON_HPP
+#define CMINUSMINUS_JSON_HPP
+
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace cminusminus{
+
+/**
+* \class JsonValue
+* A parsed JSON document, for reading the messages of the
+* language server (cmmc --lsp). Looking up a missing member or
+* item gives a null value, so a path into a message can be
+* followed without checking each step.
+**/
+class JsonValue{
+public:
+	enum Type { NUL, BOOL, NUMBER, STRING, ARRAY, OBJECT };
+
+	JsonValue() : myType(NUL), myBool(false), myNum(0){ }
+
+	/** Parse the len bytes at text into out. Returns false
+	 * if they are not one JSON value **/
+	static bool parse(const char * text, size_t len, JsonValue& out);
+
+	Type type() const { return myType; }
+	bool isNull() const { return myType == NUL; }
+	bool boolean() const { return myBool; }
+	double num() const { return myNum; }
+	/** The string, or "" for a value that is not one **/
+	const std::string& str() const { return myStr; }
+	/** Items of an array (0 for anything else) **/
+	size_t size() const { return myItems.size(); }
+	const JsonValue& operator[](size_t i) const;
+	/** Member key of an object **/
+	const JsonValue& operator[](const char * key) const;
+
+	/** This value written back out as JSON **/
+	void write(std::ostream& out) const;
+
+private:
+	friend class JsonParser;
+
+	Type myType;
+	bool myBool;
+	double myNum;
+	std::string myStr;
+	std::vector<JsonValue> myItems;
+	std::vector<std::pair<std::string, JsonValue>> myMembers;
+};
+
+/** Write s as a JSON string literal, quotes and all **/
+void putJsonString(std::ostream& out, const std::string& s);
+
+} //End namespace cminusminus
+
+#endif
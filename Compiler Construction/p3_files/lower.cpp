@@ -0,0 +1,267 @@
+#include "ast.hpp"
+#include "errors.hpp"
+#include "ir.hpp"
+#include "symtable.hpp"
+#include "types.hpp"
+
+namespace cminusminus{
+
+/*
+Lowering runs after type analysis, so every name has its
+SemSymbol and every expression its type. Globals are memory; a
+local or formal gets a virtual register of its own, unless its
+address is taken, in which case it gets a stack slot. An
+expression returns the operand holding its value, which for a
+variable is the variable itself rather than a copy of it.
+Conditions are lowered to a conditional jump on a bool, and
+"and" and "or" to jumps that skip the right side when the left
+side decides the answer.
+*/
+
+static uint8_t sizeOf(const ExpNode * exp){
+	return irSize(exp->getDataType());
+}
+
+template <typename T>
+static void lowerList(NodeList<T> * nodes, IRBuilder& ir){
+	for (auto node : *nodes){
+		node->lower(ir);
+	}
+}
+
+void ProgramNode::lower(IRBuilder& ir){
+	lowerList(myGlobals, ir);
+}
+
+void VarDeclNode::lower(IRBuilder& ir){
+	//Name analysis gave every declared variable a symbol
+	SemSymbol * sym = myId->getSymbol();
+	if (ir.inFunction()){
+		ir.local(sym);
+	} else {
+		ir.global(sym);
+	}
+}
+
+void FnDeclNode::lower(IRBuilder& ir){
+	uint32_t formals = static_cast<uint32_t>(myFormals->size());
+	ir.place(myId->getSymbol(), ir.beginFunction(myId->getName(), formals,
+		irSize(myRetType->getDataType())));
+	uint16_t i = 0;
+	for (auto formal : *myFormals){
+		SemSymbol * sym = formal->getId()->getSymbol();
+		ir.emit(IR_PARAM, irSize(sym->getDataType()), ir.local(sym), Opd(),
+			Opd(), i++);
+	}
+	lowerList(myBody, ir);
+	ir.endFunction();
+}
+
+Opd IDNode::lower(IRBuilder& ir){
+	return ir.location(mySymbol);
+}
+
+Opd IDNode::lowerStore(IRBuilder& ir, Opd src){
+	Opd loc = ir.location(mySymbol);
+	ir.move(sizeOf(this), loc, src);
+	return loc;
+}
+
+Opd DerefNode::lower(IRBuilder& ir){
+	Opd ptr = myId->lower(ir);
+	Opd val = ir.temp(sizeOf(this));
+	ir.emit(IR_LOAD, sizeOf(this), val, ptr);
+	return val;
+}
+
+Opd DerefNode::lowerStore(IRBuilder& ir, Opd src){
+	Opd ptr = myId->lower(ir);
+	ir.emit(IR_STORE, sizeOf(this), Opd(), ptr, src);
+	return src;
+}
+
+Opd RefNode::lower(IRBuilder& ir){
+	Opd addr = ir.temp(8);
+	ir.emit(IR_ADDR, 8, addr, myId->lower(ir));
+	return addr;
+}
+
+Opd IntLitNode::lower(IRBuilder& ir){
+	return ir.imm(myNum);
+}
+
+Opd ShortLitNode::lower(IRBuilder& ir){
+	return ir.imm(myNum);
+}
+
+Opd StrLitNode::lower(IRBuilder& ir){
+	return ir.str(myStr);
+}
+
+Opd TrueNode::lower(IRBuilder& ir){
+	return ir.imm(1);
+}
+
+Opd FalseNode::lower(IRBuilder& ir){
+	return ir.imm(0);
+}
+
+Opd AssignExpNode::lower(IRBuilder& ir){
+	return myDst->lowerStore(ir, mySrc->lower(ir));
+}
+
+Opd CallExpNode::lower(IRBuilder& ir){
+	//Work out every actual before passing any, so that no call
+	// comes between the ARGs and their CALL
+	std::vector<Opd> actuals;
+	actuals.reserve(myArgs->size());
+	for (auto arg : *myArgs){
+		actuals.push_back(arg->lower(ir));
+	}
+	for (size_t i = 0; i < actuals.size(); i++){
+		ir.emit(IR_ARG, sizeOf((*myArgs)[i]), Opd(), actuals[i], Opd(),
+			static_cast<uint16_t>(i));
+	}
+	uint8_t size = sizeOf(this);
+	Opd result = size == 0 ? Opd() : ir.temp(size);
+	ir.emit(IR_CALL, size, result, myId->lower(ir), Opd(),
+		static_cast<uint16_t>(actuals.size()));
+	return result;
+}
+
+/* "lhs and rhs" or "lhs or rhs": skip is the jump that leaves
+   out rhs when lhs alone settles the answer (IR_JZ for and,
+   IR_JNZ for or) */
+static Opd lowerShortCircuit(IRBuilder& ir, ExpNode * lhs, ExpNode * rhs,
+  IROp skip){
+	Opd result = ir.temp(1);
+	ir.move(1, result, lhs->lower(ir));
+	size_t jump = ir.emit(skip, 0, Opd(), result);
+	ir.move(1, result, rhs->lower(ir));
+	ir.patch(jump, ir.startBlock());
+	return result;
+}
+
+static IROp binaryOp(AstKind kind){
+	switch (kind){
+	case AST_PLUS: return IR_ADD;
+	case AST_MINUS: return IR_SUB;
+	case AST_TIMES: return IR_MUL;
+	case AST_DIVIDE: return IR_DIV;
+	case AST_EQUALS: return IR_EQ;
+	case AST_NOTEQUALS: return IR_NE;
+	case AST_LESS: return IR_LT;
+	case AST_LESSEQ: return IR_LE;
+	case AST_GREATER: return IR_GT;
+	case AST_GREATEREQ: return IR_GE;
+	default: throw new InternalError("Not a binary operator");
+	}
+}
+
+Opd BinaryExpNode::lower(IRBuilder& ir){
+	switch (imageKind()){
+	case AST_AND:
+		return lowerShortCircuit(ir, myLhs, myRhs, IR_JZ);
+	case AST_OR:
+		return lowerShortCircuit(ir, myLhs, myRhs, IR_JNZ);
+	default:
+		break;
+	}
+	Opd lhs = myLhs->lower(ir);
+	Opd rhs = myRhs->lower(ir);
+	Opd result = ir.temp(sizeOf(this));
+	ir.emit(binaryOp(imageKind()), sizeOf(this), result, lhs, rhs);
+	return result;
+}
+
+Opd UnaryExpNode::lower(IRBuilder& ir){
+	Opd val = myExp->lower(ir);
+	Opd result = ir.temp(sizeOf(this));
+	IROp op = imageKind() == AST_NOT ? IR_NOT : IR_NEG;
+	ir.emit(op, sizeOf(this), result, val);
+	return result;
+}
+
+void AssignStmtNode::lower(IRBuilder& ir){
+	myExp->lower(ir);
+}
+
+static void lowerStep(IRBuilder& ir, LValNode * lval, IROp op){
+	uint8_t size = sizeOf(lval);
+	Opd result = ir.temp(size);
+	ir.emit(op, size, result, lval->lower(ir), ir.imm(1));
+	lval->lowerStore(ir, result);
+}
+
+void PostIncStmtNode::lower(IRBuilder& ir){
+	lowerStep(ir, myLVal, IR_ADD);
+}
+
+void PostDecStmtNode::lower(IRBuilder& ir){
+	lowerStep(ir, myLVal, IR_SUB);
+}
+
+static uint16_t ioKind(const DataType * type){
+	switch (type->getKind()){
+	case DataType::SHORT: return IO_SHORT;
+	case DataType::BOOL: return IO_BOOL;
+	case DataType::STRING: return IO_STRING;
+	default: return IO_INT;
+	}
+}
+
+void ReadStmtNode::lower(IRBuilder& ir){
+	uint8_t size = sizeOf(myDst);
+	Opd val = ir.temp(size);
+	ir.emit(IR_READ, size, val, Opd(), Opd(), ioKind(myDst->getDataType()));
+	myDst->lowerStore(ir, val);
+}
+
+void WriteStmtNode::lower(IRBuilder& ir){
+	Opd val = mySrc->lower(ir);
+	ir.emit(IR_WRITE, sizeOf(mySrc), Opd(), val, Opd(),
+		ioKind(mySrc->getDataType()));
+}
+
+void WhileStmtNode::lower(IRBuilder& ir){
+	Opd head = ir.startBlock();
+	size_t exit = ir.emit(IR_JZ, 0, Opd(), myCond->lower(ir));
+	lowerList(myBody, ir);
+	if (ir.reachable()){
+		ir.emit(IR_JMP, 0, Opd(), Opd(), head);
+	}
+	ir.patch(exit, ir.startBlock());
+}
+
+void IfStmtNode::lower(IRBuilder& ir){
+	size_t skip = ir.emit(IR_JZ, 0, Opd(), myCond->lower(ir));
+	lowerList(myBody, ir);
+	ir.patch(skip, ir.startBlock());
+}
+
+void IfElseStmtNode::lower(IRBuilder& ir){
+	size_t toElse = ir.emit(IR_JZ, 0, Opd(), myCond->lower(ir));
+	lowerList(myBodyTrue, ir);
+	//No jump past the else part if the then part cannot get there
+	bool fallsOut = ir.reachable();
+	size_t toEnd = fallsOut ? ir.emit(IR_JMP, 0, Opd()) : 0;
+	ir.patch(toElse, ir.startBlock());
+	lowerList(myBodyFalse, ir);
+	Opd end = ir.startBlock();
+	if (fallsOut){ ir.patch(toEnd, end); }
+}
+
+void ReturnStmtNode::lower(IRBuilder& ir){
+	if (myExp == nullptr){
+		ir.emit(IR_RET, 0, Opd());
+		return;
+	}
+	Opd val = myExp->lower(ir);
+	ir.emit(IR_RET, sizeOf(myExp), Opd(), val);
+}
+
+void CallStmtNode::lower(IRBuilder& ir){
+	myCall->lower(ir);
+}
+
+} // End namespace cminusminus
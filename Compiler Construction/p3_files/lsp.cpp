@@ -0,0 +1,520 @@
+#include <strings.h>
+#include <unistd.h>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include "errors.hpp"
+#include "incremental.hpp"
+#include "json.hpp"
+#include "lsp.hpp"
+#include "symindex.hpp"
+
+namespace cminusminus{
+
+typedef std::chrono::steady_clock Clock;
+
+/* How long after a change the document is reparsed, if no other
+   change comes in first */
+static const Clock::duration DEBOUNCE = std::chrono::milliseconds(30);
+
+/* JSON-RPC error codes */
+static const int PARSE_ERROR = -32700;
+static const int INVALID_REQUEST = -32600;
+static const int METHOD_NOT_FOUND = -32601;
+
+/* LSP's SymbolKind and DiagnosticSeverity */
+static const int KIND_FUNCTION = 12;
+static const int KIND_VARIABLE = 13;
+static const int SEVERITY_ERROR = 1;
+
+/* One change as the client sent it: the text for a range of the
+   document as it was (lines and characters from 0), or for the
+   whole document */
+struct Change{
+	bool whole;
+	size_t startLine;
+	size_t startChar;
+	size_t endLine;
+	size_t endChar;
+	std::string text;
+};
+
+/* What queries on a document are answered from. Made on the
+   analysis thread from one version that parsed, and not changed
+   after that, so the main thread can use it without a lock */
+struct Analysis{
+	SymbolIndex index;
+	/* The documentSymbol result, ready to send */
+	std::string symbols;
+};
+
+struct Document{
+	std::string uri;
+	/* Under LspServer::myLock: changes not analyzed yet, the
+	   version they make, and when to start on them */
+	std::vector<Change> pending;
+	long pendingVersion = 0;
+	Clock::time_point due;
+	bool closed = false;
+	std::shared_ptr<const Analysis> analysis;
+	/* Only touched by the analysis thread */
+	IncrementalParser session;
+};
+
+/* Where line and character (from 0) are in text. Past the end
+   of a line means its end, and past the last line the end of
+   the text */
+static size_t offsetOf(const std::string& text, size_t line, size_t ch){
+	size_t at = 0;
+	for (size_t i = 0; i < line; i++){
+		const void * nl = std::memchr(text.data() + at, '\n', text.size() - at);
+		if (nl == nullptr){ return text.size(); }
+		at = static_cast<size_t>(static_cast<const char *>(nl) - text.data()) + 1;
+	}
+	const void * nl = std::memchr(text.data() + at, '\n', text.size() - at);
+	size_t lineEnd = nl == nullptr ? text.size()
+	  : static_cast<size_t>(static_cast<const char *>(nl) - text.data());
+	return at + ch < lineEnd ? at + ch : lineEnd;
+}
+
+/* pos as an LSP Range */
+static void putRange(std::ostream& out, const Position& pos){
+	auto from0 = [](size_t n){ return n > 0 ? n - 1 : 0; };
+	out << "{\"start\":{\"line\":" << from0(pos.line())
+	<< ",\"character\":" << from0(pos.col())
+	<< "},\"end\":{\"line\":" << from0(pos.endLine())
+	<< ",\"character\":" << from0(pos.endCol()) << "}}";
+}
+
+static void putDiagnostic(std::ostream& out, const char * sep,
+  const Position& pos, const std::string& msg){
+	out << sep << "{\"range\":";
+	putRange(out, pos);
+	out << ",\"severity\":" << SEVERITY_ERROR << ",\"source\":\"cmmc\","
+	<< "\"message\":";
+	putJsonString(out, msg);
+	out << "}";
+}
+
+/* The messages of a parse as a Diagnostic array. Each of the
+   scanner's is a line "FATAL [l,c]-[l,c]: msg"; the bare
+   "syntax error" lines stand for the parser's own message */
+static std::string diagnostics(const IncrementalParser& session){
+	std::ostringstream out;
+	out << "[";
+	const char * sep = "";
+	std::istringstream errors(session.errors());
+	std::string line;
+	while (std::getline(errors, line)){
+		unsigned long nums[4];
+		const char * at = line.c_str();
+		if (std::strncmp(at, "FATAL [", 7) != 0){ continue; }
+		at += 7;
+		bool ok = true;
+		for (int i = 0; ok && i < 4; i++){
+			char * end = nullptr;
+			nums[i] = std::strtoul(at, &end, 10);
+			ok = end != at;
+			at = end;
+			const char * next = i == 0 || i == 2 ? "," : i == 1 ? "]-[" : "]: ";
+			ok = ok && std::strncmp(at, next, std::strlen(next)) == 0;
+			at += std::strlen(next);
+		}
+		if (!ok){ continue; }
+		putDiagnostic(out, sep, Position(nums[0], nums[1], nums[2], nums[3]),
+			at);
+		sep = ",";
+	}
+	std::string syntax = session.syntaxOutput();
+	if (!syntax.empty()){
+		if (syntax.back() == '\n'){ syntax.pop_back(); }
+		putDiagnostic(out, sep, session.syntaxErrorPos(), syntax);
+	}
+	out << "]";
+	return out.str();
+}
+
+static void putSymbol(std::ostream& out, const SymbolIndex::Decl& decl){
+	out << "{\"name\":";
+	putJsonString(out, decl.name.str());
+	out << ",\"kind\":"
+	<< (decl.kind == SymbolIndex::FUNCTION ? KIND_FUNCTION : KIND_VARIABLE);
+	if (decl.kind == SymbolIndex::PARAMETER){ out << ",\"detail\":\"formal\""; }
+	out << ",\"range\":";
+	putRange(out, decl.whole);
+	out << ",\"selectionRange\":";
+	putRange(out, decl.id);
+}
+
+/* The DocumentSymbol array for index: each global, with the
+   formals and locals of a function as its children. A function's
+   declarations all come right after it */
+static std::string documentSymbols(const SymbolIndex& index){
+	std::ostringstream out;
+	out << "[";
+	const auto& decls = index.decls();
+	for (size_t i = 0; i < decls.size(); ){
+		if (i > 0){ out << ","; }
+		putSymbol(out, decls[i]);
+		size_t fn = i++;
+		if (decls[fn].kind == SymbolIndex::FUNCTION){
+			out << ",\"children\":[";
+			for (const char * sep = ""; i < decls.size()
+			  && decls[i].function == fn; i++, sep = ","){
+				out << sep;
+				putSymbol(out, decls[i]);
+				out << "}";
+			}
+			out << "]";
+		}
+		out << "}";
+	}
+	out << "]";
+	return out.str();
+}
+
+/**
+* \class LspServer
+* The main thread reads messages, answers queries and queues up
+* changes; the analysis thread (analyze) parses and indexes the
+* documents with changes and sends their diagnostics.
+**/
+class LspServer{
+public:
+	LspServer(int inFd, int outFd)
+	: myIn(inFd), myOut(outFd), myStopping(false), myShutdown(false){ }
+	int run();
+
+private:
+	bool readMessage(std::string& body);
+	void send(const std::string& body);
+	void reply(const JsonValue& id, const std::string& result);
+	void replyError(const JsonValue& id, int code, const char * msg);
+	void handle(const JsonValue& msg);
+	void queueChanges(const JsonValue& params, std::vector<Change> changes,
+	  bool opening);
+	void didClose(const JsonValue& params);
+	std::shared_ptr<const Analysis> analysisFor(const JsonValue& params);
+	std::string definition(const JsonValue& params);
+	void analyze();
+	void update(Document& doc, std::vector<Change>& changes, long version);
+
+	int myIn;
+	int myOut;
+	/* Read but not yet taken as a message */
+	std::string myInBuf;
+	/* Both threads send; a message goes out whole */
+	std::mutex mySendLock;
+	/* Guards myDocs, what Document says it guards, and
+	   myStopping */
+	std::mutex myLock;
+	std::condition_variable myWake;
+	std::map<std::string, std::shared_ptr<Document>> myDocs;
+	bool myStopping;
+	bool myShutdown;
+};
+
+/* The body of the next message, false at the end of the input */
+bool LspServer::readMessage(std::string& body){
+	while (true){
+		size_t headEnd = myInBuf.find("\r\n\r\n");
+		if (headEnd != std::string::npos){
+			size_t length = 0;
+			bool haveLength = false;
+			std::istringstream head(myInBuf.substr(0, headEnd));
+			std::string line;
+			while (std::getline(head, line)){
+				if (strncasecmp(line.c_str(), "Content-Length:", 15) == 0){
+					length = std::strtoul(line.c_str() + 15, nullptr, 10);
+					haveLength = true;
+				}
+			}
+			if (!haveLength){
+				//Not a message we can frame; drop the header
+				myInBuf.erase(0, headEnd + 4);
+				continue;
+			}
+			if (myInBuf.size() >= headEnd + 4 + length){
+				body = myInBuf.substr(headEnd + 4, length);
+				myInBuf.erase(0, headEnd + 4 + length);
+				return true;
+			}
+		}
+		char buf[64 * 1024];
+		ssize_t got = ::read(myIn, buf, sizeof(buf));
+		if (got < 0 && errno == EINTR){ continue; }
+		if (got <= 0){ return false; }
+		myInBuf.append(buf, static_cast<size_t>(got));
+	}
+}
+
+void LspServer::send(const std::string& body){
+	std::string msg = "Content-Length: " + std::to_string(body.size())
+	  + "\r\n\r\n" + body;
+	std::lock_guard<std::mutex> guard(mySendLock);
+	const char * at = msg.data();
+	size_t left = msg.size();
+	while (left > 0){
+		ssize_t put = ::write(myOut, at, left);
+		if (put < 0 && errno == EINTR){ continue; }
+		if (put <= 0){ return; }
+		at += put;
+		left -= static_cast<size_t>(put);
+	}
+}
+
+void LspServer::reply(const JsonValue& id, const std::string& result){
+	std::ostringstream out;
+	out << "{\"jsonrpc\":\"2.0\",\"id\":";
+	id.write(out);
+	out << ",\"result\":" << result << "}";
+	send(out.str());
+}
+
+void LspServer::replyError(const JsonValue& id, int code,
+  const char * msg){
+	std::ostringstream out;
+	out << "{\"jsonrpc\":\"2.0\",\"id\":";
+	id.write(out);
+	out << ",\"error\":{\"code\":" << code << ",\"message\":";
+	putJsonString(out, msg);
+	out << "}}";
+	send(out.str());
+}
+
+static Change changeFrom(const JsonValue& json){
+	Change change;
+	const JsonValue& range = json["range"];
+	change.whole = range.isNull();
+	auto count = [](const JsonValue& n){
+		return n.num() > 0 ? static_cast<size_t>(n.num()) : 0;
+	};
+	change.startLine = count(range["start"]["line"]);
+	change.startChar = count(range["start"]["character"]);
+	change.endLine = count(range["end"]["line"]);
+	change.endChar = count(range["end"]["character"]);
+	change.text = json["text"].str();
+	return change;
+}
+
+void LspServer::handle(const JsonValue& msg){
+	const std::string& method = msg["method"].str();
+	const JsonValue& id = msg["id"];
+	const JsonValue& params = msg["params"];
+	bool request = msg["id"].type() != JsonValue::NUL;
+
+	if (method == "initialize"){
+		reply(id, "{\"capabilities\":{"
+			"\"textDocumentSync\":{\"openClose\":true,\"change\":2},"
+			"\"documentSymbolProvider\":true,"
+			"\"definitionProvider\":true},"
+			"\"serverInfo\":{\"name\":\"cmmc\"}}");
+	} else if (method == "shutdown"){
+		myShutdown = true;
+		reply(id, "null");
+	} else if (myShutdown && request){
+		replyError(id, INVALID_REQUEST, "Shutting down");
+	} else if (method == "textDocument/didOpen"){
+		Change change;
+		change.whole = true;
+		change.text = params["textDocument"]["text"].str();
+		queueChanges(params, {change}, true);
+	} else if (method == "textDocument/didChange"){
+		std::vector<Change> changes;
+		const JsonValue& list = params["contentChanges"];
+		for (size_t i = 0; i < list.size(); i++){
+			changes.push_back(changeFrom(list[i]));
+		}
+		queueChanges(params, changes, false);
+	} else if (method == "textDocument/didClose"){
+		didClose(params);
+	} else if (method == "textDocument/documentSymbol"){
+		auto analysis = analysisFor(params);
+		reply(id, analysis == nullptr ? "[]" : analysis->symbols);
+	} else if (method == "textDocument/definition"){
+		reply(id, definition(params));
+	} else if (request){
+		replyError(id, METHOD_NOT_FOUND, "Method not found");
+	}
+	//Other notifications (initialized, $/cancelRequest, ...) need
+	// nothing from us
+}
+
+void LspServer::queueChanges(const JsonValue& params,
+  std::vector<Change> changes, bool opening){
+	const JsonValue& textDoc = params["textDocument"];
+	const std::string& uri = textDoc["uri"].str();
+	std::lock_guard<std::mutex> guard(myLock);
+	std::shared_ptr<Document>& doc = myDocs[uri];
+	if (opening || doc == nullptr){
+		//Reopening starts over
+		if (doc != nullptr){ doc->closed = true; }
+		doc = std::make_shared<Document>();
+		doc->uri = uri;
+	}
+	for (auto& change : changes){
+		//A whole new text makes the changes before it moot
+		if (change.whole){ doc->pending.clear(); }
+		doc->pending.push_back(std::move(change));
+	}
+	doc->pendingVersion = static_cast<long>(textDoc["version"].num());
+	doc->due = Clock::now() + (opening ? Clock::duration(0) : DEBOUNCE);
+	myWake.notify_one();
+}
+
+void LspServer::didClose(const JsonValue& params){
+	const std::string& uri = params["textDocument"]["uri"].str();
+	{
+		std::lock_guard<std::mutex> guard(myLock);
+		auto found = myDocs.find(uri);
+		if (found == myDocs.end()){ return; }
+		found->second->closed = true;
+		myDocs.erase(found);
+	}
+	std::ostringstream out;
+	out << "{\"jsonrpc\":\"2.0\",\"method\":"
+	<< "\"textDocument/publishDiagnostics\",\"params\":{\"uri\":";
+	putJsonString(out, uri);
+	out << ",\"diagnostics\":[]}}";
+	send(out.str());
+}
+
+std::shared_ptr<const Analysis> LspServer::analysisFor(
+  const JsonValue& params){
+	std::lock_guard<std::mutex> guard(myLock);
+	auto found = myDocs.find(params["textDocument"]["uri"].str());
+	if (found == myDocs.end()){ return nullptr; }
+	return found->second->analysis;
+}
+
+std::string LspServer::definition(const JsonValue& params){
+	auto analysis = analysisFor(params);
+	if (analysis == nullptr){ return "null"; }
+	const JsonValue& pos = params["position"];
+	const SymbolIndex::Decl * decl = analysis->index.declarationAt(
+		static_cast<size_t>(pos["line"].num()) + 1,
+		static_cast<size_t>(pos["character"].num()) + 1);
+	if (decl == nullptr){ return "null"; }
+	std::ostringstream out;
+	out << "{\"uri\":";
+	putJsonString(out, params["textDocument"]["uri"].str());
+	out << ",\"range\":";
+	putRange(out, decl->id);
+	out << "}";
+	return out.str();
+}
+
+/* Make changes to doc's text and parse it again (on the analysis
+   thread, without the lock) */
+void LspServer::update(Document& doc, std::vector<Change>& changes,
+  long version){
+	IncrementalParser& session = doc.session;
+	for (const auto& change : changes){
+		if (change.whole){
+			session.reset(change.text);
+			continue;
+		}
+		const std::string& text = session.text();
+		size_t start = offsetOf(text, change.startLine, change.startChar);
+		size_t end = offsetOf(text, change.endLine, change.endChar);
+		if (end < start){ end = start; }
+		session.edit(start, end - start, change.text);
+	}
+
+	ProgramNode * program = session.program();
+	if (program != nullptr){
+		auto analysis = std::make_shared<Analysis>();
+		analysis->index.build(program);
+		analysis->symbols = documentSymbols(analysis->index);
+		std::lock_guard<std::mutex> guard(myLock);
+		doc.analysis = analysis;
+	}
+
+	std::ostringstream out;
+	out << "{\"jsonrpc\":\"2.0\",\"method\":"
+	<< "\"textDocument/publishDiagnostics\",\"params\":{\"uri\":";
+	putJsonString(out, doc.uri);
+	out << ",\"version\":" << version << ",\"diagnostics\":"
+	<< diagnostics(session) << "}}";
+	{
+		//Not after a didClose has cleared them
+		std::lock_guard<std::mutex> guard(myLock);
+		if (doc.closed){ return; }
+	}
+	send(out.str());
+}
+
+/* The analysis thread: take on the document whose changes are
+   due first, until told to stop */
+void LspServer::analyze(){
+	std::unique_lock<std::mutex> lock(myLock);
+	while (!myStopping){
+		std::shared_ptr<Document> next;
+		for (const auto& doc : myDocs){
+			if (doc.second->pending.empty()){ continue; }
+			if (next == nullptr || doc.second->due < next->due){
+				next = doc.second;
+			}
+		}
+		if (next == nullptr){
+			myWake.wait(lock);
+			continue;
+		}
+		if (next->due > Clock::now()){
+			myWake.wait_until(lock, next->due);
+			continue;
+		}
+		std::vector<Change> changes;
+		changes.swap(next->pending);
+		long version = next->pendingVersion;
+		lock.unlock();
+		try {
+			update(*next, changes, version);
+		} catch (UserError * e){
+			std::cerr << "cmmc --lsp: " << e->msg() << std::endl;
+		} catch (InternalError * e){
+			std::cerr << "cmmc --lsp: " << e->msg() << std::endl;
+		}
+		lock.lock();
+	}
+}
+
+int LspServer::run(){
+	std::thread analysis(&LspServer::analyze, this);
+	bool exited = false;
+	std::string body;
+	while (!exited && readMessage(body)){
+		JsonValue msg;
+		if (!JsonValue::parse(body.data(), body.size(), msg)){
+			replyError(JsonValue(), PARSE_ERROR, "Malformed message");
+			continue;
+		}
+		if (msg["method"].str() == "exit"){
+			exited = true;
+		} else {
+			handle(msg);
+		}
+	}
+	{
+		std::lock_guard<std::mutex> guard(myLock);
+		myStopping = true;
+		myWake.notify_one();
+	}
+	analysis.join();
+	return exited && myShutdown ? 0 : 1;
+}
+
+int serveLsp(int inFd, int outFd){
+	LspServer server(inFd, outFd);
+	return server.run();
+}
+
+} //End namespace cminusminus
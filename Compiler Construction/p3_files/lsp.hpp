@@ -0,0 +1,43 @@
+#ifndef CMINUSMINUS_LSP_HPP
+#define CMINUSMINUS_LSP_HPP
+
+namespace cminusminus{
+
+/*
+cmmc --lsp is a language server: it speaks the Language Server
+Protocol (JSON-RPC 2.0, each message after a "Content-Length: n"
+header and a blank line) on standard input and output. It
+handles
+
+   initialize, initialized, shutdown, exit
+   textDocument/didOpen, didChange (whole text or ranges), didClose
+   textDocument/documentSymbol   globals, and each function's
+                                 formals and locals inside it
+   textDocument/definition       where the name at a position
+                                 was declared
+
+and sends textDocument/publishDiagnostics with the messages a
+parse of each document gives.
+
+Each open document keeps an IncrementalParser, so a change only
+reparses the globals it touches. That work is done on a
+background thread, a short while after the last change in a
+burst (so typing does not queue up one parse per key). What it
+makes (the SymbolIndex and the documentSymbol answer) is kept
+per document, and queries are answered from it at once without
+waiting for the parse of later changes. While a document does
+not parse, queries are answered from the last version that did.
+
+Lines and characters count from 0, as LSP has it. Characters
+are counted in bytes, which is the same as UTF-16 units for C--
+outside of string literals.
+*/
+
+/** Serve the protocol on inFd and outFd until the client says
+ * exit or closes inFd. Returns the exit status LSP asks for: 0
+ * if shutdown came first, 1 otherwise **/
+int serveLsp(int inFd, int outFd);
+
+} //End namespace cminusminus
+
+#endif
@@ -1,168 +1,988 @@
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
 #include <iostream>
 #include <cstdlib>
 #include <cstring>
 #include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "astimage.hpp"
+#include "cache.hpp"
 #include "errors.hpp"
+#include "incremental.hpp"
+#include "ir.hpp"
+#include "lsp.hpp"
+#include "parlex.hpp"
 #include "scanner.hpp"
+#include "server.hpp"
+#include "source.hpp"
+#include "stats.hpp"
+#include "symtable.hpp"
+#include "tokstream.hpp"
+#include "types.hpp"
+#include "workpool.hpp"
+#include "x64.hpp"
 
 using namespace cminusminus;
 
-static void usageAndDie(){
-	std::cerr << "Usage: cmmc <infile>"
+static void usage(std::ostream& err){
+	err << "Usage: cmmc <infile>... | @<listFile>"
 	<< " [-u <unparseFile>]: Output canonical program form\n"
 	<< " [-p]: Parse the input to check syntax\n"
 	<< " [-t <tokensFile>]: Output tokens to <tokensFile>\n"
+	<< " [-T <tokensFile>]: Output binary tokens to <tokensFile>\n"
+	<< " [-A <astFile>]: Output the AST in binary to <astFile>\n"
+	<< " [-n <nameFile>]: Perform name analysis and output the"
+	<< " program with the type of each name to <nameFile>\n"
+	<< " [-c]: Perform name and type analysis\n"
+	<< " [-a <3acFile>]: Output the program in three-address code"
+	<< " to <3acFile>\n"
+	<< " [-o <asmFile>]: Output x86-64 assembly for the GNU"
+	<< " assembler to <asmFile> (link it with runtime/cmmrt.s)\n"
+	<< " [-j <jobs>]: Use <jobs> threads (to lex -t output for one"
+	<< " input, or to compile several inputs at once)\n"
+	<< " [--mem-stats]: Report memory used per node kind\n"
+	<< " [--stats]: Report the time taken by each phase, the tokens"
+	<< " by kind, the AST nodes by class and memory use\n"
+	<< " [--stats-json <file>]: Write the --stats numbers as JSON"
+	<< " to <file>\n"
+	<< " [--edits <editsFile>]: After parsing the input, make each"
+	<< " edit in <editsFile> to it, reparsing only what the edit"
+	<< " touched\n"
+	<< " [--cache <dir>]: Reuse the results of earlier runs on the"
+	<< " same input, kept in <dir>\n"
+	<< " [--cache-max <MB>]: Size limit for --cache (default 256)\n"
+	<< " [--cache-stats]: Report --cache hits and size\n"
+	<< " With several inputs, each % in an output file name is"
+	<< " replaced by the input name without .cmm\n"
+	<< "   or: cmmc --server <socket>: Serve compile requests\n"
+	<< "   or: cmmc --lsp: Serve the Language Server Protocol on"
+	<< " standard input and output\n"
+	<< "   or: cmmc --client <socket> <args>: Run cmmc <args> on"
+	<< " a server (as does any cmmc run with CMMC_SERVER=<socket>)\n"
 	;
-	exit(1);
 }
 
-static void writeTokenStream(const char * inPath, const char * outPath){
-	std::ifstream inStream(inPath);
-	if (!inStream.good()){
-		std::string msg = "Bad input stream";
+/* What was asked for on the command line. An empty file name
+   means that output was not asked for. With several inputs
+   the file names are patterns; see outputPath */
+struct Options{
+	std::string tokensFile;
+	std::string binTokensFile;
+	bool checkParse = false;
+	std::string unparseFile;
+	std::string astFile;
+	std::string nameFile;
+	bool checkTypes = false;
+	std::string irFile;
+	std::string asmFile;
+	unsigned jobs = 0;
+	/* Set by --mem-stats: report arena usage after each phase */
+	bool memStats = false;
+	/* Set by --stats and --stats-json: time and count each 
+	   compile (see CompileStats) */
+	bool stats = false;
+	std::string statsJson;
+	/* Where relative file names start from ("" for the current
+	   directory). Messages still show the names as given */
+	std::string dir;
+	/* Set by --edits: changes to make to the input after the
+	   first parse, each followed by an incremental reparse */
+	std::string editsFile;
+	/* Set by --cache, --cache-max and --cache-stats */
+	std::string cacheDir;
+	uint64_t cacheMax = 256;
+	bool cacheStats = false;
+	ResultCache * cache = nullptr;
+};
+
+struct Invocation{
+	std::vector<std::string> inFiles;
+	Options opts;
+};
+
+/* Where the token streams asked for by -t and -T go (either may
+   be null), and the pre-lexed binary input to replay, if any */
+struct TokenPlumbing{
+	std::ostream * text;
+	std::ostream * binary;
+	const BinaryTokenReader * replay;
+};
+
+static void connectScanner(Scanner& scanner, const TokenPlumbing& io){
+	if (io.replay != nullptr){ scanner.replay(io.replay); }
+	scanner.teeTokens(io.text);
+	scanner.teeBinaryTokens(io.binary);
+}
+
+/* path as seen from directory dir ("" for the current one) */
+static std::string inDir(const std::string& dir, const std::string& path){
+	if (dir.empty() || path.empty() || path == "--" || path[0] == '/'){
+		return path;
+	}
+	return dir + "/" + path;
+}
+
+static SourceFile * openInput(const std::string& dir,
+  const std::string& inPath){
+	SourceFile * src = SourceFile::open(inDir(dir, inPath).c_str());
+	if (src == nullptr){
+		std::string msg = "Bad input stream ";
 		msg += inPath;
+		throw new UserError(msg.c_str());
+	}
+	return src;
+}
+
+/* Returns the stream to write outPath's output to: stdOut for
+   "--", otherwise fileStream after opening it */
+static std::ostream * openOutput(const std::string& dir,
+  const std::string& outPath,
+  std::ofstream& fileStream, std::ostream& stdOut,
+  std::ios_base::openmode mode = std::ios_base::out){
+	if (outPath == "--"){
+		return &stdOut;
+	}
+	fileStream.open(inDir(dir, outPath), mode);
+	if (!fileStream.good()){
+		std::string msg = "Bad output file ";
+		msg += outPath;
 		throw new InternalError(msg.c_str());
 	}
-	if (outPath == nullptr){
-		std::string msg = "No tokens output file given";
+	return &fileStream;
+}
+
+/* Throw if what was written to out, outPath's stream from
+   openOutput, did not all get there */
+static void checkWritten(std::ostream& out, const std::string& outPath){
+	out.flush();
+	if (!out.good()){
+		std::string msg = "Could not write ";
+		msg += outPath;
 		throw new InternalError(msg.c_str());
 	}
+}
 
-	Scanner scanner(&inStream);
-	if (strcmp(outPath, "--") == 0){
-		scanner.outputTokens(std::cout);
-	} else {
-		std::ofstream outStream(outPath);
-		if (!outStream.good()){
-			std::string msg = "Bad output file ";
-			msg += outPath;
-			throw new InternalError(msg.c_str());
-		}
-		scanner.outputTokens(outStream);
-		outStream.close();
+/* The file inFile's output goes to: pattern with each % replaced
+   by inFile less any .cmm suffix */
+static std::string outputPath(const std::string& pattern,
+  const std::string& inFile){
+	std::string stem = inFile;
+	const std::string ext = ".cmm";
+	if (stem.size() > ext.size()
+	  && stem.compare(stem.size() - ext.size(), ext.size(), ext) == 0){
+		stem.resize(stem.size() - ext.size());
+	}
+	std::string path;
+	for (char c : pattern){
+		if (c == '%'){ path += stem; } else { path += c; }
 	}
+	return path;
 }
 
-static cminusminus::ProgramNode * parse(const char * inFile){
-	std::ifstream inStream(inFile);
-	if (!inStream.good()){
-		std::string msg = "Bad input stream ";
-		msg += inFile;
-		throw new UserError(msg.c_str());
+static void writeTokenStream(SourceFile * src, const TokenPlumbing& io,
+  bool memStats, std::ostream& stdErr, CompileStats * stats){
+	Arena arena;
+	Scanner scanner(src, &arena);
+	connectScanner(scanner, io);
+	scanner.collectStats(stats);
+	scanner.finishTee();
+	if (memStats){
+		stdErr << "Memory for -t:\n";
+		arena.report(stdErr);
 	}
+	if (stats != nullptr){ stats->addArena(arena); }
+}
 
+/* Lex and parse src exactly once. Any token outputs in io are
+   written as the tokens are scanned, giving the same output as 
+   writeTokenStream */
+static cminusminus::ProgramNode * parse(SourceFile * src,
+  const TokenPlumbing& io, bool memStats, std::ostream& stdErr,
+  CompileStats * stats){
 	//This pointer will be set to the root of the
 	// AST after parsing
 	cminusminus::ProgramNode * root = nullptr;
 
-	cminusminus::Scanner scanner(&inStream);
-	cminusminus::Parser parser(scanner, &root);
+	//Every token and node goes into this arena. Once
+	// the ProgramNode is built it owns the arena
+	cminusminus::Arena * arena = new cminusminus::Arena();
+	cminusminus::Scanner scanner(src, arena);
+	connectScanner(scanner, io);
+	scanner.collectStats(stats);
+	cminusminus::Parser parser(scanner, &root, arena);
 
+	CompileStats::Timer parseTimer(stats, CompileStats::PARSE);
 	int errCode = parser.parse();
-	if (errCode != 0){ return nullptr; }
-
+	parseTimer.stop();
+	scanner.finishTee();
+	if (memStats){
+		stdErr << "Memory for -p:\n";
+		arena->report(stdErr);
+	}
+	if (stats != nullptr){ stats->addArena(*arena); }
+	if (root == nullptr){ delete arena; }
+	if (errCode != 0){
+		delete root;
+		return nullptr;
+	}
 	return root;
 }
 
-static void outputAST(ASTNode * ast, const char * outPath){
-	if (strcmp(outPath, "--") == 0){
-		ast->unparse(std::cout, 0);
-	} else {
-		std::ofstream outStream(outPath);
-		if (!outStream.good()){
-			std::string msg = "Bad output file ";
-			msg += outPath;
-			throw new cminusminus::InternalError(msg.c_str());
+/* Unparse tree (an AST or an AST image) to outPath. A file is
+   written with write(2) straight from the UnparseWriter's buffer
+   rather than through an ofstream */
+template <typename Tree>
+static void unparseTo(Tree * tree, const std::string& dir,
+  const std::string& outPath, std::ostream& stdOut, CompileStats * stats){
+	if (outPath == "--"){
+		CompileStats::Timer timer(stats, CompileStats::UNPARSE);
+		UnparseWriter out(stdOut);
+		tree->unparse(out, 0);
+		out.flush();
+		return;
+	}
+	int fd = ::open(inDir(dir, outPath).c_str(), 
+		O_WRONLY | O_CREAT | O_TRUNC, 0666);
+	if (fd < 0){
+		std::string msg = "Bad output file ";
+		msg += outPath;
+		throw new InternalError(msg.c_str());
+	}
+	bool ok;
+	{
+		CompileStats::Timer timer(stats, CompileStats::UNPARSE);
+		UnparseWriter out(fd);
+		tree->unparse(out, 0);
+		ok = out.flush();
+	}
+	ok = ::close(fd) == 0 && ok;
+	if (!ok){
+		std::string msg = "Could not write ";
+		msg += outPath;
+		throw new InternalError(msg.c_str());
+	}
+}
+
+/* Whether opts asks for the types checked, for -c or for the
+   passes that need well-typed input */
+static bool needsTypes(const Options& opts){
+	return opts.checkTypes || !opts.irFile.empty() || !opts.asmFile.empty();
+}
+
+/* Whether opts asks for anything past the parse of a tree */
+static bool needsNames(const Options& opts){
+	return !opts.nameFile.empty() || needsTypes(opts);
+}
+
+/* Run the semantic passes over ast: resolve every name to its
+   declaration (and, if they are all good, write the named
+   unparse to namePath for -n), then check the types if
+   needsTypes. The names point into symTab, which must outlive
+   any later use of the tree. Returns false, having said which
+   pass failed, if either did */
+static bool analyze(ProgramNode * ast, const Options& opts,
+  const std::string& namePath, SymbolTable& symTab, std::ostream& stdOut,
+  std::ostream& stdErr, CompileStats * stats){
+	CompileStats::Timer nameTimer(stats, CompileStats::NAMES);
+	bool ok = ast->nameAnalysis(&symTab);
+	nameTimer.stop();
+	if (!ok){
+		stdErr << "Name Analysis Failed\n";
+		return false;
+	}
+	if (!opts.nameFile.empty()){
+		unparseTo(ast, opts.dir, namePath, stdOut, stats);
+	}
+	if (!needsTypes(opts)){ return true; }
+	TypeAnalysis types;
+	CompileStats::Timer typeTimer(stats, CompileStats::TYPES);
+	ast->typeAnalysis(&types);
+	typeTimer.stop();
+	if (!types.passed()){
+		stdErr << "Type Analysis Failed\n";
+		return false;
+	}
+	return true;
+}
+
+/* The name of inFile's output for an output file argument */
+static std::string outputFor(const std::string& arg,
+  const std::string& inFile, bool batch){
+	return batch ? outputPath(arg, inFile) : arg;
+}
+
+static void outputImage(ProgramNode * ast, const std::string& dir,
+  const std::string& outPath, std::ostream& stdOut, CompileStats * stats){
+	std::ofstream outStream;
+	std::ostream * out = openOutput(dir, outPath, outStream, stdOut,
+		std::ios_base::out | std::ios_base::binary);
+	CompileStats::Timer timer(stats, CompileStats::AST_IMAGE);
+	AstImageWriter image;
+	ast->flatten(image);
+	image.write(*out);
+	checkWritten(*out, outPath);
+}
+
+/* The input is an AST image written by -A: all there is to do 
+   is unparse it, straight from the file */
+static void unparseImage(const SourceFile * src, const std::string& inFile,
+  const Options& opts, const std::string& unparsePath,
+  std::ostream& stdOut, CompileStats * stats){
+	if (opts.checkParse || !opts.tokensFile.empty()
+	  || !opts.binTokensFile.empty() || !opts.astFile.empty()
+	  || needsNames(opts)){
+		std::string msg = "Only -u applies to the AST image ";
+		msg += inFile;
+		throw new UserError(msg.c_str());
+	}
+	std::unique_ptr<AstImage> image(AstImage::open(src));
+	if (image == nullptr){
+		std::string msg = "Malformed AST image ";
+		msg += inFile;
+		throw new UserError(msg.c_str());
+	}
+	unparseTo(image.get(), opts.dir, unparsePath, stdOut, stats);
+}
+
+/* One change in an --edits file: a line "<offset> <removed>
+   <length>", then the length bytes to put in place of the removed
+   bytes at offset, then a newline (or the end of the file) */
+struct Edit{
+	size_t offset;
+	size_t removed;
+	std::string inserted;
+};
+
+static std::vector<Edit> readEdits(const SourceFile * script,
+  const std::string& scriptName){
+	std::vector<Edit> edits;
+	const char * at = script->data();
+	const char * end = at + script->size();
+	while (at < end){
+		unsigned long long nums[3];
+		bool ok = true;
+		for (int i = 0; ok && i < 3; i++){
+			char * numEnd = nullptr;
+			nums[i] = strtoull(at, &numEnd, 10);
+			ok = numEnd != at && numEnd < end 
+			  && *numEnd == (i < 2 ? ' ' : '\n');
+			at = numEnd + 1;
+		}
+		if (!ok || nums[2] > static_cast<size_t>(end - at)){
+			std::string msg = "Malformed edits file ";
+			msg += scriptName;
+			throw new UserError(msg.c_str());
 		}
-		ast->unparse(outStream, 0);
+		size_t length = static_cast<size_t>(nums[2]);
+		edits.push_back({static_cast<size_t>(nums[0]),
+			static_cast<size_t>(nums[1]), std::string(at, length)});
+		at += length;
+		if (at < end && *at == '\n'){ at++; }
 	}
+	return edits;
 }
 
-static bool doUnparsing(const char * inputPath, const char * outPath){
-	cminusminus::ProgramNode * ast = parse(inputPath);
-	if (ast == nullptr){ 
-		std::cerr << "No AST built\n";
+/* Parse src in session, then make the edits in opts.editsFile one
+   at a time, reparsing after each. Only the final text's messages
+   are shown. Returns its AST, or nullptr if it does not parse */
+static ProgramNode * parseEdited(IncrementalParser& session,
+  const SourceFile * src, const Options& opts, std::ostream& stdOut,
+  std::ostream& stdErr, CompileStats * stats){
+	if (!opts.tokensFile.empty() || !opts.binTokensFile.empty()){
+		throw new UserError("--edits does not apply to -t or -T");
+	}
+	std::unique_ptr<SourceFile> script(openInput(opts.dir, opts.editsFile));
+	std::vector<Edit> edits = readEdits(script.get(), opts.editsFile);
+
+	CompileStats::Timer parseTimer(stats, CompileStats::PARSE);
+	session.reset(std::string(src->data(), src->size()));
+	for (const auto& edit : edits){
+		session.edit(edit.offset, edit.removed, edit.inserted);
+	}
+	ProgramNode * ast = session.program();
+	parseTimer.stop();
+	stdOut << session.syntaxOutput();
+	stdErr << session.errors();
+	return ast;
+}
+
+/* Lower ast (which has passed type analysis against symTab) to
+   three-address code, and write that to irPath for -a and the
+   x86-64 assembly for it to asmPath for -o, as opts asks */
+static void generate(ProgramNode * ast, const SymbolTable& symTab,
+  const Options& opts, const std::string& irPath,
+  const std::string& asmPath, std::ostream& stdOut, CompileStats * stats){
+	IRProgram prog;
+	IRBuilder ir(prog, symTab.size());
+	CompileStats::Timer timer(stats, CompileStats::LOWER);
+	ast->lower(ir);
+	timer.stop();
+	if (!opts.irFile.empty()){
+		std::ofstream irStream;
+		std::ostream * out = openOutput(opts.dir, irPath, irStream, stdOut,
+			std::ios_base::out);
+		prog.dump(*out);
+		checkWritten(*out, irPath);
+	}
+	if (!opts.asmFile.empty()){
+		std::ofstream asmStream;
+		std::ostream * out = openOutput(opts.dir, asmPath, asmStream, stdOut,
+			std::ios_base::out);
+		CompileStats::Timer codegenTimer(stats, CompileStats::CODEGEN);
+		X64Writer(prog, *out).write();
+		checkWritten(*out, asmPath);
+	}
+}
+
+/* Do everything opts asks for to one input file. "--" outputs 
+   go to stdOut and messages to stdErr. When batch is set the 
+   output file names in opts are patterns for outputPath. If
+   stats is not null, each phase is timed and counted into it.
+   Returns false if the compiler gave up on the file */
+
+static bool compileFile(const std::string& inFile, const Options& opts,
+  bool batch, std::ostream& stdOut, std::ostream& stdErr,
+  CompileStats * stats){
+	auto path = [&](const std::string& arg){
+		return outputFor(arg, inFile, batch);
+	};
+	try {
+		//Read and scan the input once, no matter how many
+		// outputs were asked for
+		CompileStats::Timer readTimer(stats, CompileStats::READ);
+		std::unique_ptr<SourceFile> src(openInput(opts.dir, inFile));
+		readTimer.stop();
+		TokenPlumbing io = {nullptr, nullptr, nullptr};
+
+		//A file written by -T is replayed instead of scanned
+		std::unique_ptr<BinaryTokenReader> replay;
+		if (BinaryTokenReader::isTokenStream(src.get())){
+			replay.reset(BinaryTokenReader::open(src.get()));
+			if (replay == nullptr){
+				std::string msg = "Malformed token stream ";
+				msg += inFile;
+				throw new UserError(msg.c_str());
+			}
+			io.replay = replay.get();
+		}
+
+		if (AstImage::isAstImage(src.get())){
+			unparseImage(src.get(), inFile, opts, path(opts.unparseFile),
+				stdOut, stats);
+			return true;
+		}
+
+		std::ofstream tokensStream;
+		if (!opts.tokensFile.empty()){
+			io.text = openOutput(opts.dir, path(opts.tokensFile),
+				tokensStream, stdOut);
+		}
+		std::ofstream binTokensStream;
+		if (!opts.binTokensFile.empty()){
+			io.binary = openOutput(opts.dir, path(opts.binTokensFile),
+				binTokensStream, stdOut,
+				std::ios_base::out | std::ios_base::binary);
+		}
+
+		//Only plain -t output of a single source file is split
+		// across threads
+		bool parallel = !batch && opts.jobs > 1 && io.text != nullptr
+		  && io.binary == nullptr && io.replay == nullptr
+		  && !opts.memStats && stats == nullptr;
+		bool tokensOnly = !opts.checkParse && opts.unparseFile.empty()
+		  && opts.astFile.empty() && !needsNames(opts);
+		if (tokensOnly && parallel){
+			outputTokensParallel(src.get(), *io.text, stdErr, opts.jobs);
+		} else if (tokensOnly){
+			writeTokenStream(src.get(), io, opts.memStats, stdErr, stats);
+		} else {
+			std::unique_ptr<IncrementalParser> session;
+			ProgramNode * ast;
+			if (opts.editsFile.empty()){
+				ast = parse(src.get(), io, opts.memStats, stdErr, stats);
+			} else {
+				session.reset(new IncrementalParser());
+				ast = parseEdited(*session, src.get(), opts, stdOut,
+					stdErr, stats);
+			}
+			if (ast == nullptr){
+				if (opts.checkParse){
+					stdErr << "Parse failed" << std::endl;
+				}
+				if (!opts.unparseFile.empty() || !opts.astFile.empty()
+				  || needsNames(opts)){
+					stdErr << "No AST built\n";
+				}
+			} else {
+				if (!opts.unparseFile.empty()){
+					unparseTo(ast, opts.dir, path(opts.unparseFile),
+						stdOut, stats);
+				}
+				if (!opts.astFile.empty()){
+					outputImage(ast, opts.dir, path(opts.astFile), stdOut,
+						stats);
+				}
+				if (needsNames(opts)){
+					SymbolTable symTab;
+					bool ok = analyze(ast, opts, path(opts.nameFile), symTab,
+						stdOut, stdErr, stats);
+					if (ok && (!opts.irFile.empty() || !opts.asmFile.empty())){
+						generate(ast, symTab, opts, path(opts.irFile),
+							path(opts.asmFile), stdOut, stats);
+					}
+				}
+			}
+			//The session owns its tree
+			if (session == nullptr){ delete ast; }
+		}
+	} catch (ToDoError * e){
+		stdErr << "ToDo: " << e->msg() << std::endl;
+		return false;
+	} catch (InternalError * e){
+		std::string msg = "Something in the compiler is broken: ";
+		stdErr << msg << e->msg() << std::endl;
+		return false;
+	} catch (UserError * e){
+		std::string msg = "The user made a mistake: ";
+		stdErr << msg << e->msg() << std::endl;
 		return false;
 	}
+	return true;
+}
+
+/* The options that decide what a compile writes, for the cache
+   key: which outputs were asked for and whether each goes to a
+   file or to stdout (but not the file names) */
+static std::string cacheOptions(const Options& opts){
+	auto where = [](const std::string& arg){
+		return arg.empty() ? "none" : arg == "--" ? "stdout" : "file";
+	};
+	std::string text = "t=";
+	text += where(opts.tokensFile);
+	text += " T=";
+	text += where(opts.binTokensFile);
+	text += " u=";
+	text += where(opts.unparseFile);
+	text += " A=";
+	text += where(opts.astFile);
+	text += " n=";
+	text += where(opts.nameFile);
+	text += opts.checkParse ? " p" : "";
+	text += " a=";
+	text += where(opts.irFile);
+	text += " o=";
+	text += where(opts.asmFile);
+	text += opts.checkTypes ? " c" : "";
+	return text;
+}
 
-	outputAST(ast, outPath);
+static bool readBack(const std::string& path, std::string& text){
+	std::ifstream in(path, std::ios_base::binary);
+	if (!in.good()){ return false; }
+	std::ostringstream all;
+	all << in.rdbuf();
+	text = all.str();
 	return true;
 }
 
-int 
-main( const int argc, const char **argv )
-{
-	if (argc == 0){
-		usageAndDie();
+/* Write a cached output to the file it went to the first time */
+static void writeCached(bool has, const std::string& dir,
+  const std::string& outPath, const std::string& text, 
+  std::ostream& stdOut){
+	if (!has){ return; }
+	std::ofstream fileStream;
+	std::ostream * out = openOutput(dir, outPath, fileStream, stdOut,
+		std::ios_base::out | std::ios_base::binary);
+	out->write(text.data(), static_cast<std::streamsize>(text.size()));
+}
+
+/* compileFile through opts.cache: a hit replays the outputs of
+   an earlier compile of the same bytes without scanning or 
+   parsing, and a miss compiles and records what was written */
+static bool compileCached(const std::string& inFile, const Options& opts,
+  bool batch, std::ostream& stdOut, std::ostream& stdErr,
+  CompileStats * stats){
+	//The stats reports are about a real compile
+	if (opts.cache == nullptr || opts.memStats || stats != nullptr
+	  || !opts.editsFile.empty()){
+		return compileFile(inFile, opts, batch, stdOut, stdErr, stats);
 	}
-	const char * inFile = NULL;
-	const char * tokensFile = NULL;
-	bool checkParse = false;
-	const char * unparseFile = NULL;
+	std::unique_ptr<SourceFile> src(SourceFile::open(
+		inDir(opts.dir, inFile).c_str()));
+	if (src == nullptr){
+		//Let compileFile report it
+		return compileFile(inFile, opts, batch, stdOut, stdErr, nullptr);
+	}
+	std::string key = ResultCache::key(src.get(), cacheOptions(opts));
+	src.reset();
+
+	CachedRun run;
+	if (opts.cache->load(key, run)){
+		try {
+			writeCached(run.hasTokens, opts.dir,
+				outputFor(opts.tokensFile, inFile, batch),
+				run.tokens, stdOut);
+			writeCached(run.hasBinTokens, opts.dir,
+				outputFor(opts.binTokensFile, inFile, batch),
+				run.binTokens, stdOut);
+			writeCached(run.hasUnparse, opts.dir,
+				outputFor(opts.unparseFile, inFile, batch),
+				run.unparse, stdOut);
+			writeCached(run.hasAst, opts.dir,
+				outputFor(opts.astFile, inFile, batch),
+				run.ast, stdOut);
+			writeCached(run.hasNames, opts.dir,
+				outputFor(opts.nameFile, inFile, batch),
+				run.names, stdOut);
+			writeCached(run.hasIR, opts.dir,
+				outputFor(opts.irFile, inFile, batch),
+				run.ir, stdOut);
+			writeCached(run.hasAsm, opts.dir,
+				outputFor(opts.asmFile, inFile, batch),
+				run.assembly, stdOut);
+		} catch (InternalError * e){
+			std::string msg = "Something in the compiler is broken: ";
+			stdErr << msg << e->msg() << std::endl;
+			return false;
+		}
+		stdOut << run.out;
+		stdErr << run.err;
+		return run.ok;
+	}
+
+	std::ostringstream out;
+	std::ostringstream err;
+	std::ostream * oldSink = Report::redirect(&err);
+	std::ostream * oldOutSink = Report::redirectOut(&out);
+	run.ok = compileFile(inFile, opts, batch, out, err, nullptr);
+	Report::redirect(oldSink);
+	Report::redirectOut(oldOutSink);
+	run.out = out.str();
+	run.err = err.str();
+	stdOut << run.out;
+	stdErr << run.err;
+	//A compile that gave up (e.g. on an unwritable output) may
+	// not do so next time
+	if (!run.ok){ return false; }
+
+	auto recorded = [&](const std::string& arg, std::string& text){
+		if (arg.empty() || arg == "--"){ return false; }
+		return readBack(inDir(opts.dir, outputFor(arg, inFile, batch)),
+			text);
+	};
+	run.hasTokens = recorded(opts.tokensFile, run.tokens);
+	run.hasBinTokens = recorded(opts.binTokensFile, run.binTokens);
+	run.hasUnparse = recorded(opts.unparseFile, run.unparse);
+	run.hasAst = recorded(opts.astFile, run.ast);
+	run.hasNames = recorded(opts.nameFile, run.names);
+	run.hasIR = recorded(opts.irFile, run.ir);
+	run.hasAsm = recorded(opts.asmFile, run.assembly);
+	opts.cache->store(key, run);
+	return true;
+}
 
+/* Finish stats (if any) for a compile that returned ok, and print
+   the --stats report */
+static void finishStats(CompileStats * stats, bool ok, const Options& opts,
+  std::ostream& stdErr){
+	if (stats == nullptr){ return; }
+	stats->finish(ok);
+	if (opts.stats){ stats->report(stdErr); }
+}
+
+/* Compile every file in inFiles on opts.jobs threads. Each file's
+   stdout and stderr text is held back until every file before it
+   is done, so the output is grouped per file, in input order, 
+   however the threads happen to run. stats is empty or holds
+   one CompileStats per file. Returns the exit status */
+static int compileBatch(const std::vector<std::string>& inFiles,
+  const Options& opts, std::vector<CompileStats>& stats,
+  std::ostream& stdOut, std::ostream& stdErr){
+	struct Result{
+		std::ostringstream out;
+		std::ostringstream err;
+		bool ok = false;
+		bool done = false;
+	};
+	std::vector<Result> results(inFiles.size());
+	std::mutex printLock;
+	size_t nextToPrint = 0;
+	bool allOk = true;
+
+	forEachIndex(inFiles.size(), opts.jobs, [&](size_t i){
+		Result& result = results[i];
+		std::ostream * oldSink = Report::redirect(&result.err);
+		std::ostream * oldOutSink = Report::redirectOut(&result.out);
+		CompileStats * fileStats = stats.empty() ? nullptr : &stats[i];
+		result.ok = compileCached(inFiles[i], opts, true,
+			result.out, result.err, fileStats);
+		finishStats(fileStats, result.ok, opts, result.err);
+		Report::redirect(oldSink);
+		Report::redirectOut(oldOutSink);
+
+		std::lock_guard<std::mutex> guard(printLock);
+		result.done = true;
+		while (nextToPrint < results.size() && results[nextToPrint].done){
+			Result& ready = results[nextToPrint];
+			stdOut << ready.out.str();
+			std::string errText = ready.err.str();
+			if (!errText.empty()){
+				stdErr << inFiles[nextToPrint] << ":\n" << errText;
+			}
+			if (!ready.ok){ allOk = false; }
+			ready.out.str("");
+			ready.err.str("");
+			nextToPrint++;
+		}
+	});
+	stdOut.flush();
+	stdErr.flush();
+	return allOk ? 0 : 1;
+}
+
+/* Add the whitespace-separated file names in listPath to inFiles */
+static bool readListFile(const std::string& listPath,
+  std::vector<std::string>& inFiles, std::ostream& err){
+	std::ifstream list(listPath);
+	if (!list.good()){
+		err << "Bad list file " << listPath << std::endl;
+		return false;
+	}
+	std::string name;
+	while (list >> name){ inFiles.push_back(name); }
+	return true;
+}
+
+/* With several inputs every output but stdout needs a % so 
+   that the files do not overwrite each other */
+static bool checkPattern(const std::string& outPath, std::ostream& err){
+	if (outPath.empty() || outPath == "--"){ return true; }
+	if (outPath.find('%') == std::string::npos){
+		err << "With several input files, output file "
+		<< outPath << " needs a %" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+/* Fill in inv from the arguments after the program name. File
+   names are taken relative to dir. On a bad command line, 
+   prints why and the usage message to err and returns false */
+static bool parseArgs(const std::vector<std::string>& args,
+  const std::string& dir, Invocation& inv, std::ostream& err){
+	Options& opts = inv.opts;
+	opts.dir = dir;
 	bool useful = false;
-	int i = 1;
-	for (int i = 1 ; i < argc ; i++){
-		if (argv[i][0] == '-'){
-			if (argv[i][1] == 't'){
+	bool ok = true;
+	size_t argc = args.size();
+	for (size_t i = 0 ; ok && i < argc ; i++){
+		const std::string& arg = args[i];
+		if (arg[0] == '-'){
+			if (arg == "--mem-stats"){
+				opts.memStats = true;
+			} else if (arg == "--stats"){
+				opts.stats = true;
+			} else if (arg == "--stats-json"){
+				i++;
+				if (i >= argc){ ok = false; break; }
+				opts.statsJson = args[i];
+			} else if (arg == "--cache" || arg == "--cache-max"){
+				i++;
+				if (i >= argc){ ok = false; break; }
+				if (arg == "--cache"){
+					opts.cacheDir = args[i];
+				} else {
+					char * end = nullptr;
+					opts.cacheMax = strtoull(args[i].c_str(), &end, 10);
+					ok = *end == '\0' && opts.cacheMax > 0;
+				}
+			} else if (arg == "--edits"){
+				i++;
+				if (i >= argc){ ok = false; break; }
+				opts.editsFile = args[i];
+			} else if (arg == "--cache-stats"){
+				opts.cacheStats = true;
+			} else if (arg[1] == 'A'){
+				i++;
+				if (i >= argc){ ok = false; break; }
+				opts.astFile = args[i];
+				useful = true;
+			} else if (arg[1] == 'T'){
+				i++;
+				if (i >= argc){ ok = false; break; }
+				opts.binTokensFile = args[i];
+				useful = true;
+			} else if (arg[1] == 'j'){
+				i++;
+				if (i >= argc){ ok = false; break; }
+				char * end = nullptr;
+				unsigned long n = strtoul(args[i].c_str(), &end, 10);
+				ok = *end == '\0' && n > 0 && n <= 256;
+				opts.jobs = static_cast<unsigned>(n);
+			} else if (arg[1] == 't'){
+				i++;
+				if (i >= argc){ ok = false; break; }
+				opts.tokensFile = args[i];
+				useful = true;
+			} else if (arg[1] == 'a'){
 				i++;
-				tokensFile = argv[i];
+				if (i >= argc){ ok = false; break; }
+				opts.irFile = args[i];
 				useful = true;
-			} else if (argv[i][1] == 'p'){
+			} else if (arg[1] == 'o'){
 				i++;
-				checkParse = true;
+				if (i >= argc){ ok = false; break; }
+				opts.asmFile = args[i];
 				useful = true;
-			} else if (argv[i][1] == 'u'){
+			} else if (arg[1] == 'c'){
+				opts.checkTypes = true;
+				useful = true;
+			} else if (arg[1] == 'n'){
+				i++;
+				if (i >= argc){ ok = false; break; }
+				opts.nameFile = args[i];
+				useful = true;
+			} else if (arg[1] == 'p'){
 				i++;
-				if (i >= argc){ usageAndDie(); }
-				unparseFile = argv[i];
+				opts.checkParse = true;
+				useful = true;
+			} else if (arg[1] == 'u'){
+				i++;
+				if (i >= argc){ ok = false; break; }
+				opts.unparseFile = args[i];
 				useful = true;
 			} else {
-				std::cerr << "Unrecognized argument: ";
-				std::cerr << argv[i] << std::endl;
-				usageAndDie();
+				err << "Unrecognized argument: ";
+				err << arg << std::endl;
+				ok = false;
 			}
+		} else if (arg[0] == '@'){
+			ok = readListFile(inDir(dir, arg.substr(1)), inv.inFiles, err);
 		} else {
-			if (inFile == NULL){
-				inFile = argv[i];
-			} else {
-				std::cerr << "Only 1 input file allowed";
-				std::cerr << argv[i] << std::endl;
-				usageAndDie();
-			}
+			inv.inFiles.push_back(arg);
 		}
 	}
-	if (inFile == NULL){
-		usageAndDie();
+	if (ok && inv.inFiles.empty()){
+		ok = false;
+	} else if (ok && !useful){
+		err << "Hey, you didn't tell cmmc to do anything!\n";
+		ok = false;
+	} else if (ok && inv.inFiles.size() > 1){
+		ok = checkPattern(opts.tokensFile, err)
+		  && checkPattern(opts.binTokensFile, err)
+		  && checkPattern(opts.unparseFile, err)
+		  && checkPattern(opts.astFile, err)
+		  && checkPattern(opts.nameFile, err)
+		  && checkPattern(opts.irFile, err)
+		  && checkPattern(opts.asmFile, err);
 	}
-	if (!useful){
-		std::cerr << "Hey, you didn't tell cmmc to do anything!\n";
-		usageAndDie();
+	if (!ok){ usage(err); }
+	return ok;
+}
+
+/* Carry out inv, writing what would go to the standard streams
+   to out and err. Returns the exit status */
+static int run(Invocation& inv, std::ostream& out, std::ostream& err){
+	Options& opts = inv.opts;
+	std::unique_ptr<ResultCache> cache;
+	if (!opts.cacheDir.empty()){
+		cache.reset(new ResultCache(inDir(opts.dir, opts.cacheDir),
+			opts.cacheMax * 1024 * 1024));
+		opts.cache = cache.get();
 	}
 
-	try {
-		if (tokensFile != NULL){
-			writeTokenStream(inFile, tokensFile);
-		} if (checkParse){
-			bool parsed = parse(inFile);
-			if (!parsed){
-				std::cerr << "Parse failed" << std::endl;
-			}
-		} if (unparseFile != nullptr){
-			doUnparsing(inFile, unparseFile);
+	std::vector<CompileStats> stats;
+	if (opts.stats || !opts.statsJson.empty()){
+		for (const auto& inFile : inv.inFiles){ stats.emplace_back(inFile); }
+	}
+
+	int status;
+	if (inv.inFiles.size() > 1){
+		if (opts.jobs == 0){
+			opts.jobs = std::max(1u, std::thread::hardware_concurrency());
 		}
-	} catch (ToDoError * e){
-		std::cerr << "ToDo: " << e->msg() << std::endl;
-		exit(1);
-	} catch (InternalError * e){
-		std::string msg = "Something in the compiler is broken: ";
-		std::cerr << msg << e->msg() << std::endl;
-		exit(1);
-	} catch (UserError * e){
-		std::string msg = "The user made a mistake: ";
-		std::cerr << msg << e->msg() << std::endl;
-		exit(1);
+		status = compileBatch(inv.inFiles, opts, stats, out, err);
+	} else {
+		if (opts.jobs == 0){ opts.jobs = 1; }
+		CompileStats * fileStats = stats.empty() ? nullptr : &stats[0];
+		std::ostream * oldSink = Report::redirect(&err);
+		std::ostream * oldOutSink = Report::redirectOut(&out);
+		bool ok = compileCached(inv.inFiles[0], opts, false, out, err,
+			fileStats);
+		Report::redirect(oldSink);
+		Report::redirectOut(oldOutSink);
+		finishStats(fileStats, ok, opts, err);
+		status = ok ? 0 : 1;
+	}
+
+	if (!opts.statsJson.empty()){
+		try {
+			std::ofstream jsonStream;
+			std::ostream * json = openOutput(opts.dir, opts.statsJson,
+				jsonStream, out);
+			CompileStats::writeJson(*json, stats);
+		} catch (InternalError * e){
+			err << "Something in the compiler is broken: " << e->msg()
+			  << std::endl;
+			status = 1;
+		}
+	}
+
+	if (cache != nullptr){
+		cache->finish();
+		if (opts.cacheStats){ cache->report(err); }
+	}
+	out.flush();
+	err.flush();
+	return status;
+}
+
+/* One request to cmmc --server: the client's working directory
+   and arguments */
+static int serveRequest(const std::string& dir,
+  const std::vector<std::string>& args,
+  std::ostream& out, std::ostream& err){
+	Invocation inv;
+	if (!parseArgs(args, dir, inv, err)){ return 1; }
+	return run(inv, out, err);
+}
+
+int 
+main( const int argc, const char **argv )
+{
+	std::vector<std::string> args;
+	for (int i = 1 ; i < argc ; i++){ args.push_back(argv[i]); }
+
+	if (!args.empty() && args[0] == "--server"){
+		if (args.size() != 2){ usage(std::cerr); return 1; }
+		return serve(args[1].c_str(), serveRequest);
 	}
-	
-	return 0;
+
+	if (!args.empty() && args[0] == "--lsp"){
+		if (args.size() != 1){ usage(std::cerr); return 1; }
+		return serveLsp(0, 1);
+	}
+
+	//Hand the work to a running server if there is one, 
+	// otherwise do it here
+	const char * server = getenv("CMMC_SERVER");
+	if (!args.empty() && args[0] == "--client"){
+		if (args.size() < 2){ usage(std::cerr); return 1; }
+		server = args[1].c_str();
+		args.erase(args.begin(), args.begin() + 2);
+	}
+	if (server != nullptr && *server != '\0'){
+		int status = forward(server, args);
+		if (status >= 0){ return status; }
+	}
+
+	Invocation inv;
+	if (!parseArgs(args, "", inv, std::cerr)){ return 1; }
+	return run(inv, std::cout, std::cerr);
 }
@@ -0,0 +1,172 @@
+#include "ast.hpp"
+#include "errors.hpp"
+#include "symtable.hpp"
+#include "types.hpp"
+
+namespace cminusminus{
+
+/*
+Name analysis walks the tree in the order of the text, declaring
+before it looks up, so a name refers to the nearest enclosing
+declaration above it. The globals make the outermost scope; a
+function's formals and the locals at the top of its body share
+the next one, and each while or if body opens another. A
+function is declared before its body is analyzed, so it can call
+itself. Every error is reported, not just the first: a node
+carries on with its children after a bad name, and only the
+result says that something went wrong. Types and literals hold
+no names and use ASTNode::nameAnalysis, which does nothing.
+*/
+
+template <typename T>
+static bool analyzeList(NodeList<T> * nodes, SymbolTable * symTab){
+	bool ok = true;
+	for (auto node : *nodes){
+		ok = node->nameAnalysis(symTab) && ok;
+	}
+	return ok;
+}
+
+/* Run name analysis over a block that is a scope of its own */
+static bool analyzeScope(NodeList<StmtNode> * stmts, SymbolTable * symTab){
+	symTab->enterScope();
+	bool ok = analyzeList(stmts, symTab);
+	symTab->leaveScope();
+	return ok;
+}
+
+bool ProgramNode::nameAnalysis(SymbolTable * symTab){
+	symTab->enterScope();
+	bool ok = analyzeList(myGlobals, symTab);
+	symTab->leaveScope();
+	return ok;
+}
+
+bool VarDeclNode::nameAnalysis(SymbolTable * symTab){
+	bool ok = true;
+	const DataType * type = myType->getDataType();
+	if (type->isVoid()){
+		Report::fatal(myId->pos(), "Invalid type in declaration");
+		ok = false;
+	}
+	//A void variable is still declared, so that its uses do
+	// not each add an undeclared identifier error
+	SemSymbol * sym = symTab->declare(SemSymbol::VAR, myId->getName(),
+		this, type);
+	if (sym == nullptr){
+		Report::fatal(myId->pos(), "Multiply declared identifier");
+		return false;
+	}
+	myId->attachSymbol(sym);
+	return ok;
+}
+
+bool FnDeclNode::nameAnalysis(SymbolTable * symTab){
+	bool ok = true;
+	std::vector<const DataType *> formalTypes;
+	formalTypes.reserve(myFormals->size());
+	for (auto formal : *myFormals){
+		formalTypes.push_back(formal->getType()->getDataType());
+	}
+	const DataType * type = DataType::fn(formalTypes,
+		myRetType->getDataType());
+	SemSymbol * sym = symTab->declare(SemSymbol::FN, myId->getName(),
+		this, type);
+	if (sym == nullptr){
+		Report::fatal(myId->pos(), "Multiply declared identifier");
+		ok = false;
+	} else {
+		myId->attachSymbol(sym);
+	}
+	symTab->enterScope();
+	ok = analyzeList(myFormals, symTab) && ok;
+	ok = analyzeList(myBody, symTab) && ok;
+	symTab->leaveScope();
+	return ok;
+}
+
+bool IDNode::nameAnalysis(SymbolTable * symTab){
+	SemSymbol * sym = symTab->lookup(name);
+	if (sym == nullptr){
+		Report::fatal(pos(), "Undeclared identifier");
+		return false;
+	}
+	attachSymbol(sym);
+	return true;
+}
+
+bool DerefNode::nameAnalysis(SymbolTable * symTab){
+	return myId->nameAnalysis(symTab);
+}
+
+bool RefNode::nameAnalysis(SymbolTable * symTab){
+	if (!myId->nameAnalysis(symTab)){ return false; }
+	myId->getSymbol()->takeAddress();
+	return true;
+}
+
+bool AssignExpNode::nameAnalysis(SymbolTable * symTab){
+	bool ok = myDst->nameAnalysis(symTab);
+	return mySrc->nameAnalysis(symTab) && ok;
+}
+
+bool CallExpNode::nameAnalysis(SymbolTable * symTab){
+	bool ok = myId->nameAnalysis(symTab);
+	return analyzeList(myArgs, symTab) && ok;
+}
+
+bool BinaryExpNode::nameAnalysis(SymbolTable * symTab){
+	bool ok = myLhs->nameAnalysis(symTab);
+	return myRhs->nameAnalysis(symTab) && ok;
+}
+
+bool UnaryExpNode::nameAnalysis(SymbolTable * symTab){
+	return myExp->nameAnalysis(symTab);
+}
+
+bool AssignStmtNode::nameAnalysis(SymbolTable * symTab){
+	return myExp->nameAnalysis(symTab);
+}
+
+bool PostIncStmtNode::nameAnalysis(SymbolTable * symTab){
+	return myLVal->nameAnalysis(symTab);
+}
+
+bool PostDecStmtNode::nameAnalysis(SymbolTable * symTab){
+	return myLVal->nameAnalysis(symTab);
+}
+
+bool ReadStmtNode::nameAnalysis(SymbolTable * symTab){
+	return myDst->nameAnalysis(symTab);
+}
+
+bool WriteStmtNode::nameAnalysis(SymbolTable * symTab){
+	return mySrc->nameAnalysis(symTab);
+}
+
+bool WhileStmtNode::nameAnalysis(SymbolTable * symTab){
+	bool ok = myCond->nameAnalysis(symTab);
+	return analyzeScope(myBody, symTab) && ok;
+}
+
+bool IfStmtNode::nameAnalysis(SymbolTable * symTab){
+	bool ok = myCond->nameAnalysis(symTab);
+	return analyzeScope(myBody, symTab) && ok;
+}
+
+bool IfElseStmtNode::nameAnalysis(SymbolTable * symTab){
+	bool ok = myCond->nameAnalysis(symTab);
+	ok = analyzeScope(myBodyTrue, symTab) && ok;
+	return analyzeScope(myBodyFalse, symTab) && ok;
+}
+
+bool ReturnStmtNode::nameAnalysis(SymbolTable * symTab){
+	if (myExp == nullptr){ return true; }
+	return myExp->nameAnalysis(symTab);
+}
+
+bool CallStmtNode::nameAnalysis(SymbolTable * symTab){
+	return myCall->nameAnalysis(symTab);
+}
+
+} // End namespace cminusminus
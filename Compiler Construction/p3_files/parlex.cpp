@@ -0,0 +1,111 @@
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <vector>
+#include "parlex.hpp"
+#include "scanner.hpp"
+#include "workpool.hpp"
+
+namespace cminusminus{
+
+/* Pieces smaller than this are not worth a thread */
+static const size_t MIN_CHUNK = 256 * 1024;
+
+/* Several chunks per thread, so one dense chunk does not leave
+   the other threads idle at the end */
+static const size_t CHUNKS_PER_JOB = 4;
+
+struct Chunk{
+	size_t begin;
+	size_t end;
+	size_t firstLine;
+	std::string tokens;
+	std::string errors;
+};
+
+/* Cut [0, size) into pieces of about target bytes, each ending
+   just after a newline or at the end of the input */
+static std::vector<Chunk> splitAtLines(const char * data, size_t size,
+  size_t target){
+	std::vector<Chunk> chunks;
+	size_t begin = 0;
+	while (begin < size){
+		size_t end = size;
+		if (size - begin > target){
+			const void * nl = std::memchr(data + begin + target, '\n',
+				size - begin - target);
+			if (nl != nullptr){
+				end = static_cast<size_t>(
+					static_cast<const char *>(nl) - data) + 1;
+			}
+		}
+		chunks.push_back(Chunk{begin, end, 1, "", ""});
+		begin = end;
+	}
+	return chunks;
+}
+
+static void lexChunk(const SourceFile * src, Chunk& chunk, bool last){
+	std::unique_ptr<SourceFile> piece(SourceFile::view(
+		src->data() + chunk.begin, chunk.end - chunk.begin));
+	std::ostringstream tokens;
+	std::ostringstream errors;
+	std::ostream * oldSink = Report::redirect(&errors);
+	{
+		Arena arena;
+		Scanner scanner(piece.get(), &arena);
+		scanner.startAtLine(chunk.firstLine);
+		TokenWriter writer(tokens);
+		Parser::semantic_type lex;
+		while (scanner.yylex(&lex) != TokenKind::END){
+			writer.write(lex.lexeme);
+		}
+		//Only the end of the whole file is an EOF token
+		if (last){ writer.writeEOF(scanner.line(), scanner.col()); }
+	}
+	Report::redirect(oldSink);
+	chunk.tokens = tokens.str();
+	chunk.errors = errors.str();
+}
+
+void outputTokensParallel(const SourceFile * src, std::ostream& out,
+  std::ostream& errs, unsigned jobs){
+	const char * data = src->data();
+	size_t target = std::max(src->size() / (jobs * CHUNKS_PER_JOB),
+		MIN_CHUNK);
+	std::vector<Chunk> chunks = splitAtLines(data, src->size(), target);
+	if (chunks.size() < 2){
+		Arena arena;
+		Scanner scanner(src, &arena);
+		scanner.outputTokens(out);
+		return;
+	}
+
+	//Count each chunk's lines in parallel, then a prefix sum
+	// gives the line each one starts on
+	std::vector<size_t> newlines(chunks.size());
+	forEachIndex(chunks.size(), jobs, [&](size_t i){
+		newlines[i] = static_cast<size_t>(std::count(
+			data + chunks[i].begin, data + chunks[i].end, '\n'));
+	});
+	for (size_t i = 1; i < chunks.size(); i++){
+		chunks[i].firstLine = chunks[i - 1].firstLine + newlines[i - 1];
+	}
+
+	forEachIndex(chunks.size(), jobs, [&](size_t i){
+		lexChunk(src, chunks[i], i + 1 == chunks.size());
+	});
+
+	//Merge in file order
+	for (auto& chunk : chunks){
+		out.write(chunk.tokens.data(),
+			static_cast<std::streamsize>(chunk.tokens.size()));
+		errs << chunk.errors;
+		std::string().swap(chunk.tokens);
+	}
+	out.flush();
+	errs.flush();
+}
+
+} //End namespace cminusminus
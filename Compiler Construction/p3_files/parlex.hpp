@@ -0,0 +1,25 @@
+#ifndef CMINUSMINUS_PARLEX_HPP
+#define CMINUSMINUS_PARLEX_HPP
+
+#include <ostream>
+#include "source.hpp"
+
+namespace cminusminus{
+
+/*
+No C-- token spans a line: strings end (or are reported as
+unterminated) at a newline, and so do comments. A file split
+just after newlines can therefore be lexed one piece per thread,
+as long as each piece knows which line it starts on.
+*/
+
+/** Write the -t output for src to out, and lexical errors to
+ * errs, lexing newline-aligned chunks of it on up to jobs
+ * threads. Tokens and error messages come out exactly as 
+ * Scanner::outputTokens would write them **/
+void outputTokensParallel(const SourceFile * src, std::ostream& out,
+  std::ostream& errs, unsigned jobs);
+
+} //End namespace cminusminus
+
+#endif
@@ -1,47 +1,63 @@
 #ifndef CMINUSMINUS_POSITION_H
 #define CMINUSMINUS_POSITION_H
 
+#include <cstdint>
 #include <string>
 
 namespace cminusminus{
 
+/* A source span, stored by value inside every Token and ASTNode.
+   Non-virtual and packed into four 32-bit fields (16 bytes) so that
+   it costs no allocation and no pointer hop to read. */
 class Position{
-public: 
+public:
+	Position() : myLineI(0), myColI(0), myLineE(0), myColE(0){ }
 	Position(size_t lineI, size_t colI, size_t lineE, size_t colE)
-	: myLineI(lineI), myColI(colI), myLineE(lineE), myColE(colE){
+	: myLineI(static_cast<uint32_t>(lineI)),
+	  myColI(static_cast<uint32_t>(colI)),
+	  myLineE(static_cast<uint32_t>(lineE)),
+	  myColE(static_cast<uint32_t>(colE)){
 	}
-	Position(Position * start, Position * end)
-	: myLineI(start->myLineI), myColI(start->myColI),
-	  myLineE(end->myLineE),myColE(end->myColE){
+	Position(const Position& start, const Position& end)
+	: myLineI(start.myLineI), myColI(start.myColI),
+	  myLineE(end.myLineE),myColE(end.myColE){
 	}
-	virtual void expand(Position * start, Position * end){
-	  myLineI = start->myLineI;
-	  myColI = start->myColI;
-	  myLineE = end->myLineE;
-	  myColE = end->myColE;
+	void expand(const Position& start, const Position& end){
+	  myLineI = start.myLineI;
+	  myColI = start.myColI;
+	  myLineE = end.myLineE;
+	  myColE = end.myColE;
 	}
-	virtual std::string begin() const{
-		std::string result = "[" 
+	void shiftLines(long lines){
+	  myLineI = static_cast<uint32_t>(myLineI + lines);
+	  myLineE = static_cast<uint32_t>(myLineE + lines);
+	}
+	size_t line() const { return myLineI; }
+	size_t col() const { return myColI; }
+	size_t endLine() const { return myLineE; }
+	size_t endCol() const { return myColE; }
+	std::string begin() const{
+		std::string result = "["
 		+ std::to_string(myLineI)
-		+ "," 
+		+ ","
 		+ std::to_string(myColI)
 		+ "]";
 		return result;
 	}
-	virtual std::string span() const{
+	std::string span() const{
 		std::string result = begin()
-		+ "-[" 
+		+ "-["
 		+ std::to_string(myLineE)
-		+ "," 
+		+ ","
 		+ std::to_string(myColE)
 		+ "]";
 		return result;
 	}
 private:
-	size_t myLineI;
-	size_t myColI;
-	size_t myLineE;
-	size_t myColE;
+	uint32_t myLineI;
+	uint32_t myColI;
+	uint32_t myLineE;
+	uint32_t myColE;
 
 };
 
@@ -0,0 +1,322 @@
+#include <algorithm>
+#include "regalloc.hpp"
+
+namespace cminusminus{
+
+/*
+Since each vreg gets only the hull of where it is live, liveness
+is worked out from the shape of the code rather than block by
+block. Lowering lays out a while loop as a run of blocks from
+its header to the one block that jumps back there, and every
+other jump goes forward. So a vreg is live from its first access
+to its last, and further to the end of any loop that it is
+already live at the top of. That is so of the outermost loop
+holding its last access that starts after its first. It is also
+so of the loops around its first access, unless that access is a
+write in a block that every way to each of its other reads goes
+through, or that read comes after a write in its own block: a
+value read on one trip around such a loop could then have been
+written on the trip before, so it is kept over the outermost of
+them. Dominators come out of one pass over the blocks, as loop
+headers dominate their latches and the jumps forward alone
+decide the rest. All of that takes a few passes over the code
+and the blocks, which deeply nested loops, with many vregs live
+across each, would make slow for per-block liveness sets.
+*/
+
+/* Call visit(vreg, block, pos, isWrite) for every vreg that an
+   instruction reads or writes, in order, its reads before its
+   write. The operand of an IR_ARG is taken to be read by the
+   call that follows, which is where it gets passed, and the
+   IR_PARAMs at the top of a function all write at once, as the
+   formals all arrive at once */
+template <typename Visit>
+static void forEachAccess(const IRFunction& fn, Visit visit){
+	uint32_t callAt = 0;
+	for (uint32_t b = 0; b < fn.blocks.size(); b++){
+		const BasicBlock& block = fn.blocks[b];
+		for (uint32_t i = block.first; i < block.end; i++){
+			const Instr& ins = fn.code[i];
+			uint32_t readAt = 2 * i;
+			if (ins.op == IR_ARG){
+				if (callAt <= i){
+					callAt = i;
+					while (fn.code[callAt].op == IR_ARG){ callAt++; }
+				}
+				readAt = 2 * callAt;
+			}
+			if (ins.a.isVReg()){ visit(ins.a.index(), b, readAt, false); }
+			if (ins.b.isVReg()){ visit(ins.b.index(), b, readAt, false); }
+			uint32_t writeAt = ins.op == IR_PARAM ? 1 : 2 * i + 1;
+			if (ins.dst.isVReg()){ visit(ins.dst.index(), b, writeAt, true); }
+		}
+	}
+}
+
+/* Turn the counts in starts[0..n) into the ends of each one's
+   range of a packed array, and size items to hold them all.
+   Filling with items[--starts[k]] then leaves starts[k] and
+   starts[k + 1] around the range of k */
+static void layOut(std::vector<uint32_t>& starts, std::vector<uint32_t>& items){
+	for (size_t k = 1; k < starts.size(); k++){
+		starts[k] += starts[k - 1];
+	}
+	items.resize(starts.back());
+}
+
+const int8_t RegAlloc::SPILLED;
+const uint32_t RegAlloc::NOWHERE;
+
+RegAlloc::RegAlloc(const std::vector<uint8_t>& preservedIn,
+  const std::vector<uint8_t>& clobberedIn,
+  const std::vector<uint8_t>& argRegsIn)
+: myPreserved(preservedIn), myClobbered(clobberedIn), myArgRegs(argRegsIn),
+  mySpillCount(0), myPreservedUsed(0){ }
+
+void RegAlloc::allocate(const IRFunction& fn){
+	myRegs.assign(fn.vregs.size(), SPILLED);
+	mySpillSlots.assign(fn.vregs.size(), 0);
+	mySpillCount = 0;
+	myPreservedUsed = 0;
+	myCalls.clear();
+	myHints.assign(fn.vregs.size(), SPILLED);
+	for (uint32_t i = 0; i < fn.code.size(); i++){
+		const Instr& ins = fn.code[i];
+		if (ins.op == IR_CALL || ins.op == IR_READ || ins.op == IR_WRITE){
+			myCalls.push_back(i);
+		}
+		Opd passed = ins.op == IR_PARAM ? ins.dst
+		  : ins.op == IR_ARG ? ins.a : Opd();
+		if (passed.isVReg() && ins.aux < myArgRegs.size()){
+			myHints[passed.index()] = static_cast<int8_t>(myArgRegs[ins.aux]);
+		}
+	}
+	liveness(fn);
+	scan();
+}
+
+void RegAlloc::touch(uint32_t vreg, uint32_t pos){
+	myStart[vreg] = std::min(myStart[vreg], pos);
+	myEnd[vreg] = std::max(myEnd[vreg], pos);
+}
+
+void RegAlloc::liveness(const IRFunction& fn){
+	size_t vregs = fn.vregs.size();
+	size_t blocks = fn.blocks.size();
+	myStart.assign(vregs, NOWHERE);
+	myEnd.assign(vregs, 0);
+	myFirstBlock.assign(vregs, 0);
+	myLastBlock.assign(vregs, 0);
+	forEachAccess(fn, [&](uint32_t v, uint32_t b, uint32_t pos, bool){
+		if (myStart[v] == NOWHERE){ myFirstBlock[v] = b; }
+		myLastBlock[v] = b;
+		touch(v, pos);
+	});
+
+	//Jumps back to a block are the ends of the loop it heads
+	uint32_t out[2];
+	myLatch.assign(blocks, NOWHERE);
+	for (uint32_t b = 0; b < blocks; b++){
+		size_t n = fn.successors(b, out);
+		for (size_t k = 0; k < n; k++){
+			if (out[k] <= b){ myLatch[out[k]] = b; }
+		}
+	}
+
+	myByLastStart.assign(blocks + 1, 0);
+	for (uint32_t v = 0; v < vregs; v++){
+		if (myStart[v] != NOWHERE){ myByLastStart[myLastBlock[v]]++; }
+	}
+	layOut(myByLastStart, myByLast);
+	for (uint32_t v = 0; v < vregs; v++){
+		if (myStart[v] != NOWHERE){ myByLast[--myByLastStart[myLastBlock[v]]] = v; }
+	}
+
+	//Loops nest, so those open at block b are a stack, outermost
+	// (and first) at the bottom
+	myOpen.clear();
+	myOutermost.assign(blocks, NOWHERE);
+	for (uint32_t b = 0; b < blocks; b++){
+		while (!myOpen.empty() && myLatch[myOpen.back()] < b){ myOpen.pop_back(); }
+		if (myLatch[b] != NOWHERE){ myOpen.push_back(b); }
+		if (!myOpen.empty()){ myOutermost[b] = myOpen.front(); }
+		for (uint32_t k = myByLastStart[b]; k < myByLastStart[b + 1]; k++){
+			uint32_t v = myByLast[k];
+			auto outer = std::upper_bound(myOpen.begin(), myOpen.end(),
+			  myFirstBlock[v]);
+			if (outer == myOpen.end()){ continue; }
+			uint32_t latchEnd = fn.blocks[myLatch[*outer]].end;
+			//To the end of the latch's last instruction
+			myEnd[v] = std::max(myEnd[v], 2 * latchEnd - 1);
+		}
+	}
+
+	//A read that no write in its block comes before may see a
+	// value from the trip before around a loop, unless the block
+	// of the first access writes it on the way there every time
+	dominators(fn);
+	myLastDef.assign(vregs, 0);
+	myCarried.assign(vregs, false);
+	forEachAccess(fn, [&](uint32_t v, uint32_t b, uint32_t, bool isWrite){
+		if (isWrite){
+			myLastDef[v] = b + 1;
+		} else if (myLastDef[v] != b + 1 && myIdom[b] != NOWHERE){
+			uint32_t first = myFirstBlock[v];
+			if (b == first || !dominates(first, b)){ myCarried[v] = true; }
+		}
+	});
+	for (uint32_t v = 0; v < vregs; v++){
+		if (!myCarried[v]){ continue; }
+		uint32_t head = myOutermost[myFirstBlock[v]];
+		if (head == NOWHERE){ continue; }
+		myStart[v] = std::min(myStart[v], 2 * fn.blocks[head].first);
+		uint32_t latchEnd = fn.blocks[myLatch[head]].end;
+		myEnd[v] = std::max(myEnd[v], 2 * latchEnd - 1);
+	}
+}
+
+void RegAlloc::dominators(const IRFunction& fn){
+	uint32_t blocks = static_cast<uint32_t>(fn.blocks.size());
+	myIdom.assign(blocks, NOWHERE);
+	if (blocks == 0){ return; }
+	//Every block but a loop header is reached only from blocks
+	// laid out before it, each of which has had all its ways in
+	// looked at by then. A header dominates its latch, so the
+	// jump back changes nothing
+	myIdom[0] = 0;
+	uint32_t out[2];
+	for (uint32_t b = 0; b < blocks; b++){
+		if (myIdom[b] == NOWHERE){ continue; }
+		size_t n = fn.successors(b, out);
+		for (size_t k = 0; k < n; k++){
+			uint32_t to = out[k];
+			if (to <= b){ continue; }
+			if (myIdom[to] == NOWHERE){
+				myIdom[to] = b;
+				continue;
+			}
+			//Dominators come before what they dominate, so walk
+			// up from whichever of the two is later
+			uint32_t x = myIdom[to];
+			uint32_t y = b;
+			while (x != y){
+				while (x > y){ x = myIdom[x]; }
+				while (y > x){ y = myIdom[y]; }
+			}
+			myIdom[to] = x;
+		}
+	}
+
+	//Number the dominator tree in preorder, each block taking the
+	// next free place under its immediate dominator, so that the
+	// blocks a block dominates follow it
+	mySize.assign(blocks, 1);
+	for (uint32_t b = blocks - 1; b > 0; b--){
+		if (myIdom[b] != NOWHERE){ mySize[myIdom[b]] += mySize[b]; }
+	}
+	myPre.assign(blocks, 0);
+	myNextPre.assign(blocks, 0);
+	myNextPre[0] = 1;
+	for (uint32_t b = 1; b < blocks; b++){
+		if (myIdom[b] == NOWHERE){ continue; }
+		myPre[b] = myNextPre[myIdom[b]];
+		myNextPre[myIdom[b]] += mySize[b];
+		myNextPre[b] = myPre[b] + 1;
+	}
+}
+
+bool RegAlloc::crossesCall(const LiveInterval& interval) const{
+	//The first call that does not read its operands before the
+	// interval starts; the interval crosses it if it is still
+	// live once the call is made
+	uint32_t first = (interval.start + 1) / 2;
+	auto call = std::lower_bound(myCalls.begin(), myCalls.end(), first);
+	return call != myCalls.end() && 2 * *call + 1 <= interval.end;
+}
+
+/* The first register in regs whose bit is set in free */
+static int8_t firstFree(const std::vector<uint8_t>& regs, uint32_t free){
+	for (uint8_t r : regs){
+		if (free & (1u << r)){ return static_cast<int8_t>(r); }
+	}
+	return RegAlloc::SPILLED;
+}
+
+void RegAlloc::scan(){
+	myIntervals.clear();
+	for (uint32_t v = 0; v < myStart.size(); v++){
+		if (myStart[v] != NOWHERE){
+			myIntervals.push_back({v, myStart[v], myEnd[v]});
+		}
+	}
+	std::sort(myIntervals.begin(), myIntervals.end(),
+	  [](const LiveInterval& x, const LiveInterval& y){
+		return x.start != y.start ? x.start < y.start : x.vreg < y.vreg;
+	});
+
+	uint32_t preservedMask = 0;
+	for (uint8_t r : myPreserved){ preservedMask |= 1u << r; }
+	uint32_t free = preservedMask;
+	for (uint8_t r : myClobbered){ free |= 1u << r; }
+	auto regBit = [&](uint32_t vreg){
+		return 1u << static_cast<uint8_t>(myRegs[vreg]);
+	};
+	auto spill = [&](uint32_t vreg){
+		myRegs[vreg] = SPILLED;
+		mySpillSlots[vreg] = mySpillCount++;
+	};
+
+	myActive.clear();
+	for (const LiveInterval& cur : myIntervals){
+		size_t kept = 0;
+		for (const LiveInterval& held : myActive){
+			if (held.end < cur.start){
+				free |= regBit(held.vreg);
+			} else {
+				myActive[kept++] = held;
+			}
+		}
+		myActive.resize(kept);
+
+		bool crosses = crossesCall(cur);
+		int8_t chosen = SPILLED;
+		int8_t hint = myHints[cur.vreg];
+		if (hint != SPILLED && (free & (1u << hint))
+		  && !(crosses && !(preservedMask & (1u << hint)))){
+			chosen = hint;
+		}
+		if (chosen == SPILLED && !crosses){
+			chosen = firstFree(myClobbered, free);
+		}
+		if (chosen == SPILLED){ chosen = firstFree(myPreserved, free); }
+		if (chosen == SPILLED){
+			//Take the register of whoever ends last, if that is
+			// not cur itself
+			size_t victim = myActive.size();
+			for (size_t k = 0; k < myActive.size(); k++){
+				if (crosses && !(regBit(myActive[k].vreg) & preservedMask)){
+					continue;
+				}
+				if (victim == myActive.size()
+				  || myActive[k].end > myActive[victim].end){
+					victim = k;
+				}
+			}
+			if (victim == myActive.size() || myActive[victim].end <= cur.end){
+				spill(cur.vreg);
+				continue;
+			}
+			chosen = myRegs[myActive[victim].vreg];
+			spill(myActive[victim].vreg);
+			myActive.erase(myActive.begin()
+			  + static_cast<std::ptrdiff_t>(victim));
+		}
+		myRegs[cur.vreg] = chosen;
+		uint32_t bit = regBit(cur.vreg);
+		free &= ~bit;
+		myPreservedUsed |= bit & preservedMask;
+		myActive.push_back(cur);
+	}
+}
+
+} //End namespace cminusminus
@@ -0,0 +1,130 @@
+#ifndef CMINUSMINUS_REGALLOC_HPP
+#define CMINUSMINUS_REGALLOC_HPP
+
+#include <cstdint>
+#include <vector>
+#include "ir.hpp"
+
+namespace cminusminus{
+
+/** The stretch of a function over which a vreg holds a value
+ * that may still be read, in positions: instruction i reads its
+ * operands at 2i and writes its result at 2i+1. So the interval
+ * of an operand that instruction i reads for the last time can
+ * end where the interval of its result starts, and the two can
+ * share a register **/
+struct LiveInterval{
+	uint32_t vreg;
+	uint32_t start;
+	uint32_t end;
+};
+
+/**
+* \class RegAlloc
+* Linear-scan register allocation (after Poletto and Sarkar) for
+* one IRFunction at a time. Each vreg gets a single interval, the
+* hull of every position where it is live; the intervals are taken
+* in order of start, and each gets a register that is free for the
+* whole of it. When none is, whichever of it and the intervals
+* holding a register it could use ends last is spilled to the
+* stack for its whole life.
+*
+* Registers come in two kinds: those a call leaves alone and those
+* it may clobber. An interval live across a call (or across a read
+* or write, which call the runtime) can only have the first kind;
+* the others try the second kind first, which costs nothing to
+* save. A formal or actual passed in a register gets that
+* register if it is free, which saves moving it there. The
+* allocator keeps its storage from one function to the next.
+**/
+class RegAlloc{
+public:
+	static const int8_t SPILLED = -1;
+
+	/** The registers to hand out, by number, in the order to
+	 * try them, and the registers that the first formals and
+	 * actuals are passed in **/
+	RegAlloc(const std::vector<uint8_t>& preservedIn,
+	  const std::vector<uint8_t>& clobberedIn,
+	  const std::vector<uint8_t>& argRegsIn);
+
+	void allocate(const IRFunction& fn);
+
+	/** The register vreg got, or SPILLED **/
+	int8_t reg(uint32_t vreg) const { return myRegs[vreg]; }
+	/** For a spilled vreg, its stack slot (numbered from 0) **/
+	uint32_t spillSlot(uint32_t vreg) const { return mySpillSlots[vreg]; }
+	uint32_t spillCount() const { return mySpillCount; }
+	/** Bit r is set for each preserved register r that some
+	 * vreg got, which the function has to save and restore **/
+	uint32_t preservedUsed() const { return myPreservedUsed; }
+
+private:
+	static const uint32_t NOWHERE = UINT32_MAX;
+
+	/* Set myStart and myEnd for every vreg, from where it is
+	   read and written and the loops around those places */
+	void liveness(const IRFunction& fn);
+	/* Set myIdom, myPre and mySize from the blocks of fn */
+	void dominators(const IRFunction& fn);
+	/* Whether every way into block b goes through block a */
+	bool dominates(uint32_t a, uint32_t b) const{
+		return myPre[a] <= myPre[b] && myPre[b] < myPre[a] + mySize[a];
+	}
+	void touch(uint32_t vreg, uint32_t pos);
+	/* Whether a call, read or write clobbers registers while
+	   interval is live */
+	bool crossesCall(const LiveInterval& interval) const;
+	void scan();
+
+	std::vector<uint8_t> myPreserved;
+	std::vector<uint8_t> myClobbered;
+	std::vector<uint8_t> myArgRegs;
+
+	std::vector<int8_t> myRegs;
+	std::vector<uint32_t> mySpillSlots;
+	uint32_t mySpillCount;
+	uint32_t myPreservedUsed;
+
+	std::vector<uint32_t> myStart;
+	std::vector<uint32_t> myEnd;
+	/* The register each vreg would best have, or SPILLED */
+	std::vector<int8_t> myHints;
+	/* The instructions that clobber registers, in order */
+	std::vector<uint32_t> myCalls;
+	std::vector<LiveInterval> myIntervals;
+	std::vector<LiveInterval> myActive;
+
+	/* Scratch for liveness(): the blocks of each vreg's first
+	   and last access, the latch of each block that is a loop
+	   header (or NOWHERE), the loops open at the block being
+	   looked at, and the vregs by the block of their last access
+	   (those last accessed in block b are myByLast[myByLastStart[b]]
+	   up to myByLast[myByLastStart[b + 1]]) */
+	std::vector<uint32_t> myFirstBlock;
+	std::vector<uint32_t> myLastBlock;
+	std::vector<uint32_t> myLatch;
+	std::vector<uint32_t> myOpen;
+	std::vector<uint32_t> myByLastStart;
+	std::vector<uint32_t> myByLast;
+	/* For each block, the outermost loop around it, or NOWHERE */
+	std::vector<uint32_t> myOutermost;
+	/* For each vreg, the last block + 1 that wrote it, and
+	   whether a value it got may be read on a later trip around
+	   a loop that its first access is in */
+	std::vector<uint32_t> myLastDef;
+	std::vector<bool> myCarried;
+
+	/* Scratch for dominators(): the immediate dominator of each
+	   block (NOWHERE where no jump reaches it), where it comes in
+	   a walk of the dominator tree, how many blocks it dominates,
+	   itself included, and the next place free under it */
+	std::vector<uint32_t> myIdom;
+	std::vector<uint32_t> myPre;
+	std::vector<uint32_t> mySize;
+	std::vector<uint32_t> myNextPre;
+};
+
+} //End namespace cminusminus
+
+#endif
@@ -0,0 +1,251 @@
+# The runtime for programs compiled by cmmc -o: the entry point,
+# and the read and write that C-- programs call. It needs no C
+# library, only Linux system calls, so a program is built with
+#
+#	as prog.s -o prog.o
+#	as cmmrt.s -o cmmrt.o
+#	ld prog.o cmmrt.o -o prog
+#
+# Output is buffered until the buffer fills, the program reads,
+# or main returns. Like any System V function, these leave rbx,
+# rbp and r12 to r15 alone and may change any other register.
+
+	.set OUT_SIZE, 4096
+	.set IN_SIZE, 4096
+	.set SYS_READ, 0
+	.set SYS_WRITE, 1
+	.set SYS_BRK, 12
+	.set SYS_EXIT, 60
+
+	.bss
+	.align 8
+outLen:	.zero 8
+inPos:	.zero 8
+inLen:	.zero 8
+heapNext:	.zero 8
+heapEnd:	.zero 8
+outBuf:	.zero OUT_SIZE
+inBuf:	.zero IN_SIZE
+
+	.text
+
+# Call main; exit with the low byte of what it returns
+	.globl _start
+_start:
+	xorl %ebp, %ebp
+	andq $-16, %rsp
+	call main
+	movq %rax, %rbx
+	call _cmm_flush
+	movl %ebx, %edi
+	movl $SYS_EXIT, %eax
+	syscall
+
+# Write out what is in the output buffer
+# (changes rax, rcx, rdx, rsi, rdi and r11)
+	.globl _cmm_flush
+_cmm_flush:
+	leaq outBuf(%rip), %rsi
+1:	movq outLen(%rip), %rdx
+	testq %rdx, %rdx
+	jz 2f
+	movl $1, %edi
+	movl $SYS_WRITE, %eax
+	syscall
+	testq %rax, %rax
+	jle 2f
+	addq %rax, %rsi
+	subq %rax, outLen(%rip)
+	jmp 1b
+2:	movq $0, outLen(%rip)
+	ret
+
+# Put the rdx bytes at rsi in the output buffer
+_cmm_out:
+	testq %rdx, %rdx
+	jz 3f
+	movq outLen(%rip), %rcx
+	cmpq $OUT_SIZE, %rcx
+	jb 2f
+	pushq %rsi
+	pushq %rdx
+	call _cmm_flush
+	popq %rdx
+	popq %rsi
+	xorl %ecx, %ecx
+2:	leaq outBuf(%rip), %rax
+	movb (%rsi), %r8b
+	movb %r8b, (%rax,%rcx)
+	incq %rcx
+	movq %rcx, outLen(%rip)
+	incq %rsi
+	decq %rdx
+	jmp _cmm_out
+3:	ret
+
+# write of a string: rdi points at its bytes, ended by a 0
+	.globl _cmm_write_string
+_cmm_write_string:
+	movq %rdi, %rsi
+	xorl %edx, %edx
+1:	cmpb $0, (%rdi,%rdx)
+	je _cmm_out
+	incq %rdx
+	jmp 1b
+
+# write of an int, short or bool (as 1 or 0): the value is rdi
+	.globl _cmm_write_int
+_cmm_write_int:
+	subq $32, %rsp
+	movq %rdi, %rax
+	movq %rdi, %r9
+	leaq 32(%rsp), %rsi
+	testq %rax, %rax
+	jns 1f
+	# The most negative value stays negative here, but is
+	# then right taken as unsigned
+	negq %rax
+1:	movl $10, %ecx
+2:	xorl %edx, %edx
+	divq %rcx
+	addb $'0', %dl
+	decq %rsi
+	movb %dl, (%rsi)
+	testq %rax, %rax
+	jnz 2b
+	testq %r9, %r9
+	jns 3f
+	decq %rsi
+	movb $'-', (%rsi)
+3:	leaq 32(%rsp), %rdx
+	subq %rsi, %rdx
+	call _cmm_out
+	addq $32, %rsp
+	ret
+
+# The next input byte in eax, or -1 at the end of the input
+# (changes rax, rcx, rdx, rsi, rdi and r11)
+_cmm_getc:
+	movq inPos(%rip), %rcx
+	cmpq inLen(%rip), %rcx
+	jb 1f
+	# Let out what was written before waiting for input
+	call _cmm_flush
+	xorl %edi, %edi
+	leaq inBuf(%rip), %rsi
+	movl $IN_SIZE, %edx
+	movl $SYS_READ, %eax
+	syscall
+	testq %rax, %rax
+	jle 2f
+	movq %rax, inLen(%rip)
+	xorl %ecx, %ecx
+1:	leaq inBuf(%rip), %rdx
+	movzbl (%rdx,%rcx), %eax
+	incq %rcx
+	movq %rcx, inPos(%rip)
+	ret
+2:	movq $0, inLen(%rip)
+	movq $0, inPos(%rip)
+	movl $-1, %eax
+	ret
+
+# Give back the byte _cmm_getc just returned (not -1)
+_cmm_ungetc:
+	decq inPos(%rip)
+	ret
+
+# Skip whitespace; the first other byte (or -1) in eax
+_cmm_skip:
+	call _cmm_getc
+	cmpl $-1, %eax
+	je 1f
+	cmpl $' ', %eax
+	jbe _cmm_skip
+1:	ret
+
+# read of an int, short or bool: an optional - and decimal digits,
+# after any whitespace; the value in rax (0 if there are none)
+	.globl _cmm_read_int
+_cmm_read_int:
+	xorl %r8d, %r8d
+	xorl %r9d, %r9d
+	call _cmm_skip
+	cmpl $'-', %eax
+	jne 1f
+	movl $1, %r9d
+	call _cmm_getc
+1:	cmpl $-1, %eax
+	je 3f
+	subl $'0', %eax
+	cmpl $9, %eax
+	ja 2f
+	imulq $10, %r8
+	addq %rax, %r8
+	call _cmm_getc
+	jmp 1b
+2:	call _cmm_ungetc
+3:	movq %r8, %rax
+	testl %r9d, %r9d
+	jz 4f
+	negq %rax
+4:	ret
+
+# Make room for one more byte at heapNext, getting more memory
+# from the system when it runs out (changes rax, rcx, rdi, r11)
+_cmm_reserve:
+	movq heapNext(%rip), %rax
+	cmpq heapEnd(%rip), %rax
+	jb 3f
+	movq heapEnd(%rip), %rdi
+	testq %rdi, %rdi
+	jnz 1f
+	# The first time: find where the heap starts
+	movl $SYS_BRK, %eax
+	syscall
+	movq %rax, heapNext(%rip)
+	movq %rax, %rdi
+1:	addq $4096, %rdi
+	movl $SYS_BRK, %eax
+	syscall
+	cmpq heapNext(%rip), %rax
+	jbe 2f
+	movq %rax, heapEnd(%rip)
+	ret
+2:	# Out of memory
+	movl $1, %edi
+	movl $SYS_EXIT, %eax
+	syscall
+3:	ret
+
+# Put the byte in r9b at heapNext
+_cmm_putheap:
+	call _cmm_reserve
+	movq heapNext(%rip), %rax
+	movb %r9b, (%rax)
+	incq %rax
+	movq %rax, heapNext(%rip)
+	ret
+
+# read of a string: the next run of bytes other than whitespace,
+# copied to memory that is never freed; a pointer to it in rax
+	.globl _cmm_read_string
+_cmm_read_string:
+	call _cmm_reserve
+	movq heapNext(%rip), %r8
+	call _cmm_skip
+1:	cmpl $-1, %eax
+	je 3f
+	cmpl $' ', %eax
+	jbe 2f
+	movl %eax, %r9d
+	call _cmm_putheap
+	call _cmm_getc
+	jmp 1b
+2:	call _cmm_ungetc
+3:	xorl %r9d, %r9d
+	call _cmm_putheap
+	movq %r8, %rax
+	ret
+
+	.section .note.GNU-stack,"",@progbits
@@ -1,25 +1,108 @@
+#include <cstring>
 #include <fstream>
 #include "scanner.hpp"
+#include "stats.hpp"
 
 using namespace cminusminus;
 
 using TokenKind = cminusminus::Parser::token;
 using Lexeme = cminusminus::Parser::semantic_type;
 
+#ifndef CMMC_HAND_SCANNER
+/* Flex refills its buffer through this hook. When scanning a
+   SourceFile we hand over the next block of the mapping directly
+   instead of going through the istream */
+int Scanner::LexerInput(char * buf, int max_size){
+	if (mySource == nullptr){
+		return yyFlexLexer::LexerInput(buf, max_size);
+	}
+	size_t left = mySource->size() - myRead;
+	size_t want = static_cast<size_t>(max_size);
+	size_t n = left < want ? left : want;
+	std::memcpy(buf, mySource->data() + myRead, n);
+	myRead += n;
+	return static_cast<int>(n);
+}
+#endif
+
+int Scanner::replayToken(Lexeme * const lval){
+	const TokenRecord& rec = myReplay->record(myReplayNext);
+	//The last record is always END; keep returning it
+	if (myReplayNext + 1 < myReplay->size()){ myReplayNext++; }
+
+	Position pos(rec.line, rec.col, rec.endLine, rec.endCol);
+	switch (rec.kind){
+	case TokenKind::END:
+		this->lineNum = rec.line;
+		this->colNum = rec.col;
+		return TokenKind::END;
+	case TokenKind::ID:
+		lval->transToken = myArena->make<IDToken>(pos,
+			Interner::global().intern(myReplay->strChars(rec.value),
+				myReplay->strLen(rec.value)));
+		break;
+	case TokenKind::STRLITERAL:
+		lval->transToken = myArena->make<StrToken>(pos,
+			myReplay->str(rec.value));
+		break;
+	case TokenKind::INTLITERAL:
+		lval->transToken = myArena->make<IntLitToken>(pos, rec.value);
+		break;
+	case TokenKind::SHORTLITERAL:
+		lval->transToken = myArena->make<ShortLitToken>(pos, rec.value);
+		break;
+	default:
+		lval->transToken = myArena->make<Token>(pos, rec.kind);
+		break;
+	}
+	return rec.kind;
+}
+
+/* Write every token of the input to outstream in the -t format.
+   (Replaces any tee set with teeTokens.) */
 void Scanner::outputTokens(std::ostream& outstream){
-	Lexeme lex;
+	teeTokens(&outstream);
+	finishTee();
+	teeTokens(nullptr);
+}
+
+int Scanner::lexAndTee(Lexeme * const lval){
 	int tokenKind;
-	while(true){
-		tokenKind = this->yylex(&lex);
+	if (myStats != nullptr && myStats->sampleToken()){
+		double start = CompileStats::wallNow();
+		tokenKind = nextToken(lval);
+		myStats->lexSample(CompileStats::wallNow() - start);
+	} else {
+		tokenKind = nextToken(lval);
+	}
+	if (myStats != nullptr){ myStats->lexed(tokenKind); }
+	if (tokenKind == TokenKind::END){
+		mySawEnd = true;
+		myLastPos = Position(lineNum, colNum, lineNum, colNum);
+	} else {
+		myLastPos = lval->lexeme->pos();
+	}
+	if (myTee != nullptr){
 		if (tokenKind == TokenKind::END){
-			outstream << "EOF" 
-			  << " [" << this->lineNum 
-			  << "," << this->colNum << "]"
-			  << std::endl;
-			return;
+			myTee->writeEOF(this->lineNum, this->colNum);
 		} else {
-			outstream << lex.lexeme->toString()
-			  << std::endl;
+			myTee->write(lval->lexeme);
 		}
 	}
+	if (myBinTee != nullptr){
+		if (tokenKind == TokenKind::END){
+			myBinTee->writeEOF(this->lineNum, this->colNum);
+		} else {
+			myBinTee->write(lval->lexeme);
+		}
+	}
+	return tokenKind;
+}
+
+void Scanner::finishTee(){
+	if (myTee == nullptr && myBinTee == nullptr){ return; }
+	Lexeme lex;
+	while (!mySawEnd){ lexAndTee(&lex); }
+	if (myTee != nullptr){ myTee->flush(); }
+	if (myBinTee != nullptr){ myBinTee->finish(); }
 }
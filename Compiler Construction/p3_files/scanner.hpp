@@ -1,21 +1,55 @@
 #ifndef __CMINUSMINUS_SCANNER_HPP__
 #define __CMINUSMINUS_SCANNER_HPP__ 1
 
+#ifndef CMMC_HAND_SCANNER
 #if ! defined(yyFlexLexerOnce)
 #include <FlexLexer.h>
 #endif
+#endif
 
 #include "grammar.hh"
 #include "errors.hpp"
+#include "arena.hpp"
+#include "source.hpp"
+#include "tokenwriter.hpp"
+#include "tokstream.hpp"
+#include <memory>
 
 using TokenKind = cminusminus::Parser::token;
 
 namespace cminusminus{
 
+class CompileStats;
+
+#ifdef CMMC_HAND_SCANNER
+/* Built with SCANNER=hand: the Scanner is the hand-coded DFA in
+   handscanner.cpp instead of a flex-generated yyFlexLexer */
+class Scanner{
+public:
+   Scanner(std::istream *in, Arena * arenaIn);
+
+   /** Scan in place over an in-memory source buffer; token text
+    * is read straight out of the buffer **/
+   Scanner(const SourceFile * src, Arena * arenaIn);
+   virtual ~Scanner() {
+   };
+
+   virtual int yylex( cminusminus::Parser::semantic_type * const lval);
+#else
 class Scanner : public yyFlexLexer{
 public:
    
-   Scanner(std::istream *in) : yyFlexLexer(in)
+   Scanner(std::istream *in, Arena * arenaIn) 
+   : yyFlexLexer(in), myArena(arenaIn), mySource(nullptr), myRead(0)
+   {
+	lineNum = 1;
+	colNum = 1;
+   };
+
+   /** Scan straight out of an in-memory source buffer,
+    * bypassing istream buffering entirely **/
+   Scanner(const SourceFile * src, Arena * arenaIn) 
+   : yyFlexLexer(nullptr), myArena(arenaIn), mySource(src), myRead(0)
    {
 	lineNum = 1;
 	colNum = 1;
@@ -31,47 +65,48 @@ public:
 
    int makeBareToken(int tagIn){
 	size_t len = static_cast<size_t>(yyleng);
-	Position * pos = new Position(
+	Position pos(
 	  this->lineNum, this->colNum,
 	  this->lineNum, this->colNum+len);
-        this->yylval->lexeme = new Token(pos, tagIn);
+        this->yylval->lexeme = myArena->make<Token>(pos, tagIn);
         colNum += len;
         return tagIn;
    }
+#endif
 
-   void errIllegal(Position * pos, std::string match){
+   void errIllegal(const Position& pos, std::string match){
 	cminusminus::Report::fatal(pos, "Illegal character "
 		+ match);
    }
 
-   void errStrEsc(Position * pos){
+   void errStrEsc(const Position& pos){
 	cminusminus::Report::fatal(pos, "String literal with bad"
 	" escape sequence ignored");
    }
 
-   void errStrUnterm(Position * pos){
+   void errStrUnterm(const Position& pos){
 	cminusminus::Report::fatal(pos, "Unterminated string"
 	" literal ignored");
    }
 
-   void errStrEscAndUnterm(Position * pos){
+   void errStrEscAndUnterm(const Position& pos){
 	cminusminus::Report::fatal(pos, "Unterminated string literal"
 	" with bad escape sequence ignored");
    }
 
-   void errIntOverflow(Position * pos){
+   void errIntOverflow(const Position& pos){
 	cminusminus::Report::fatal(pos, "Integer literal overflow");
    }
 
-   void errIntUnderflow(Position * pos){
+   void errIntUnderflow(const Position& pos){
 	cminusminus::Report::fatal(pos, "Integer literal underflow");
    }
 
-   void errShortOverflow(Position * pos){
+   void errShortOverflow(const Position& pos){
 	cminusminus::Report::fatal(pos, "Short literal overflow");
    }
 
-   void errShortUnderflow(Position * pos){
+   void errShortUnderflow(const Position& pos){
 	cminusminus::Report::fatal(pos, "Short literal underflow");
    }
 
@@ -87,14 +122,95 @@ public:
    }
 */
 
-   static std::string tokenKindString(int tokenKind);
-
    void outputTokens(std::ostream& outstream);
 
+   /** Send a copy of every token handed to the parser to out
+    * (in the -t format), so that -t and -p/-u share one scan **/
+   void teeTokens(std::ostream * out){
+	myTee.reset(out == nullptr ? nullptr : new TokenWriter(*out));
+   }
+
+   /** As teeTokens, but in the binary -T format **/
+   void teeBinaryTokens(std::ostream * out){
+	myBinTee.reset(out == nullptr ? nullptr : new BinaryTokenWriter(*out));
+   }
+
+   /** Hand out the tokens of a pre-lexed binary stream instead
+    * of scanning the source **/
+   void replay(const BinaryTokenReader * in){
+	myReplay = in;
+	myReplayNext = 0;
+   }
+
+   /** yylex (or the next replayed token), plus a write to the 
+    * tee streams if any are set. This is the entry point the 
+    * parser calls **/
+   int lexAndTee(cminusminus::Parser::semantic_type * const lval);
+
+   /** Time and count every token handed out into stats 
+    * (nullptr to stop) **/
+   void collectStats(CompileStats * stats){ myStats = stats; }
+
+   /** After the parser stops (possibly early on a syntax error),
+    * scan and tee whatever input remains so the token output is
+    * always complete **/
+   void finishTee();
+
+   /** Whether the end of the input has been handed out yet **/
+   bool sawEnd() const { return mySawEnd; }
+
+   /** Where the last token handed out is. After a syntax error
+    * that is the token the parser could not take **/
+   const Position& lastPos() const { return myLastPos; }
+
+   /** The arena that owns every Token this scanner creates **/
+   Arena * arena() const { return myArena; }
+
+   /** Number lines from firstLine rather than 1, for scanning
+    * one slice of a larger file **/
+   void startAtLine(size_t firstLine){ lineNum = firstLine; }
+   size_t line() const { return lineNum; }
+   size_t col() const { return colNum; }
+
 private:
    cminusminus::Parser::semantic_type *yylval = nullptr;
+   Arena * myArena;
+   const SourceFile * mySource;
+   size_t myRead;
+   std::unique_ptr<TokenWriter> myTee;
+   std::unique_ptr<BinaryTokenWriter> myBinTee;
+   const BinaryTokenReader * myReplay = nullptr;
+   size_t myReplayNext = 0;
+   CompileStats * myStats = nullptr;
+   bool mySawEnd = false;
+   Position myLastPos;
    size_t lineNum;
    size_t colNum;
+
+   int replayToken(cminusminus::Parser::semantic_type * const lval);
+   int nextToken(cminusminus::Parser::semantic_type * const lval){
+	if (myReplay != nullptr){ return replayToken(lval); }
+	return this->yylex(lval);
+   }
+
+#ifdef CMMC_HAND_SCANNER
+   /* The whole input; either borrowed from mySource or
+      copied out of the istream into myOwnedText */
+   std::string myOwnedText;
+   const char * myText;
+   size_t myTextLen;
+
+   int bareToken(cminusminus::Parser::semantic_type * const lval,
+     int kind, size_t len);
+   size_t scanString(size_t start, int * ruleOut) const;
+   int scanIntLiteral(cminusminus::Parser::semantic_type * const lval,
+     size_t start, size_t len);
+   int scanShortLiteral(cminusminus::Parser::semantic_type * const lval,
+     size_t start, size_t len);
+#else
+protected:
+   int LexerInput(char * buf, int max_size) override;
+#endif
 };
 
 } /* end namespace */
@@ -0,0 +1,228 @@
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <streambuf>
+#include <thread>
+#include "server.hpp"
+
+namespace cminusminus{
+
+enum Channel : uint8_t { OUT = 1, ERR = 2, STATUS = 3 };
+
+/* A request is a working directory and command-line arguments,
+   so anything past these is not one, and is dropped unread
+   rather than allocated for */
+static const uint32_t MAX_STRINGS = 1u << 16;
+static const uint32_t MAX_STRING_LEN = 1u << 20;
+
+static bool writeAll(int fd, const char * buf, size_t len){
+	while (len > 0){
+		ssize_t put = ::send(fd, buf, len, MSG_NOSIGNAL);
+		if (put < 0 && errno == EINTR){ continue; }
+		if (put <= 0){ return false; }
+		buf += put;
+		len -= static_cast<size_t>(put);
+	}
+	return true;
+}
+
+static bool readAll(int fd, char * buf, size_t len){
+	while (len > 0){
+		ssize_t got = ::recv(fd, buf, len, 0);
+		if (got < 0 && errno == EINTR){ continue; }
+		if (got <= 0){ return false; }
+		buf += got;
+		len -= static_cast<size_t>(got);
+	}
+	return true;
+}
+
+static bool writeU32(int fd, uint32_t n){
+	return writeAll(fd, reinterpret_cast<const char *>(&n), sizeof(n));
+}
+
+static bool readU32(int fd, uint32_t * n){
+	return readAll(fd, reinterpret_cast<char *>(n), sizeof(*n));
+}
+
+/* Both of a connection's streams share one socket, so whole
+   frames are written under a lock */
+static bool writeFrame(int fd, std::mutex& lock, Channel channel,
+  const char * buf, size_t len){
+	std::lock_guard<std::mutex> guard(lock);
+	char head[5];
+	head[0] = static_cast<char>(channel);
+	uint32_t len32 = static_cast<uint32_t>(len);
+	std::memcpy(head + 1, &len32, sizeof(len32));
+	return writeAll(fd, head, sizeof(head)) && writeAll(fd, buf, len);
+}
+
+/**
+* \class FrameBuf
+* A stream buffer that sends what is written to it back to the
+* client as frames on one channel
+**/
+class FrameBuf : public std::streambuf{
+public:
+	FrameBuf(int fdIn, std::mutex& lockIn, Channel channelIn)
+	: myFd(fdIn), myLock(lockIn), myChannel(channelIn){
+		setp(myBuf, myBuf + sizeof(myBuf));
+	}
+	~FrameBuf(){ sync(); }
+protected:
+	int overflow(int c) override {
+		if (sync() != 0){ return traits_type::eof(); }
+		if (!traits_type::eq_int_type(c, traits_type::eof())){
+			*pptr() = traits_type::to_char_type(c);
+			pbump(1);
+		}
+		return traits_type::not_eof(c);
+	}
+	int sync() override {
+		size_t len = static_cast<size_t>(pptr() - pbase());
+		setp(myBuf, myBuf + sizeof(myBuf));
+		if (len == 0){ return 0; }
+		return writeFrame(myFd, myLock, myChannel, myBuf, len) ? 0 : -1;
+	}
+private:
+	int myFd;
+	std::mutex& myLock;
+	Channel myChannel;
+	char myBuf[64 * 1024];
+};
+
+static void respond(int fd, RequestHandler handler){
+	std::string dir;
+	std::vector<std::string> args;
+	uint32_t count = 0;
+	bool ok = readU32(fd, &count) && count > 0 && count <= MAX_STRINGS;
+	for (uint32_t i = 0; ok && i < count; i++){
+		uint32_t len = 0;
+		ok = readU32(fd, &len) && len <= MAX_STRING_LEN;
+		std::string arg(ok ? len : 0, '\0');
+		ok = ok && readAll(fd, &arg[0], len);
+		if (i == 0){ dir = arg; } else { args.push_back(arg); }
+	}
+	if (!ok){ return; }
+	std::mutex lock;
+	int32_t status;
+	{
+		FrameBuf outBuf(fd, lock, OUT);
+		FrameBuf errBuf(fd, lock, ERR);
+		std::ostream out(&outBuf);
+		std::ostream err(&errBuf);
+		try {
+			status = handler(dir, args, out, err);
+		} catch (...){
+			err << "Request failed\n";
+			status = 1;
+		}
+	}
+	writeFrame(fd, lock, STATUS,
+		reinterpret_cast<const char *>(&status), sizeof(status));
+}
+
+/* Each connection has a thread of its own, where an exception
+   that got away would end the whole server, so whatever goes
+   wrong ends just this connection */
+static void answer(int fd, RequestHandler handler){
+	try {
+		respond(fd, handler);
+	} catch (...){ }
+	::close(fd);
+}
+
+static bool socketAddress(const char * socketPath, sockaddr_un * addr){
+	std::memset(addr, 0, sizeof(*addr));
+	addr->sun_family = AF_UNIX;
+	if (std::strlen(socketPath) >= sizeof(addr->sun_path)){
+		return false;
+	}
+	std::strcpy(addr->sun_path, socketPath);
+	return true;
+}
+
+int serve(const char * socketPath, RequestHandler handler){
+	sockaddr_un addr;
+	int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+	//A socket file left by an earlier server is reused
+	::unlink(socketPath);
+	if (fd < 0 || !socketAddress(socketPath, &addr)
+	  || ::bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0
+	  || ::listen(fd, 64) != 0){
+		std::cerr << "Cannot listen on " << socketPath << ": "
+		<< std::strerror(errno) << std::endl;
+		return 1;
+	}
+	while (true){
+		int conn = ::accept(fd, nullptr, nullptr);
+		if (conn < 0){
+			if (errno == EINTR || errno == ECONNABORTED){ continue; }
+			std::cerr << "Cannot accept on " << socketPath << ": "
+			<< std::strerror(errno) << std::endl;
+			::close(fd);
+			return 1;
+		}
+		std::thread(answer, conn, handler).detach();
+	}
+}
+
+static bool writeString(int fd, const std::string& s){
+	return writeU32(fd, static_cast<uint32_t>(s.size()))
+	  && writeAll(fd, s.data(), s.size());
+}
+
+int forward(const char * socketPath, const std::vector<std::string>& args){
+	sockaddr_un addr;
+	if (!socketAddress(socketPath, &addr)){ return -1; }
+	int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0){ return -1; }
+	if (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0){
+		::close(fd);
+		return -1;
+	}
+
+	char cwd[4096];
+	bool ok = ::getcwd(cwd, sizeof(cwd)) != nullptr
+	  && writeU32(fd, static_cast<uint32_t>(args.size() + 1))
+	  && writeString(fd, cwd);
+	for (size_t i = 0; ok && i < args.size(); i++){
+		ok = writeString(fd, args[i]);
+	}
+
+	std::string buf;
+	while (ok){
+		char head[5];
+		uint32_t len = 0;
+		ok = readAll(fd, head, sizeof(head));
+		std::memcpy(&len, head + 1, sizeof(len));
+		buf.resize(len);
+		ok = ok && readAll(fd, &buf[0], len);
+		if (!ok){ break; }
+		Channel channel = static_cast<Channel>(head[0]);
+		if (channel == STATUS && len == sizeof(int32_t)){
+			int32_t status;
+			std::memcpy(&status, buf.data(), sizeof(status));
+			::close(fd);
+			return status;
+		}
+		int outFd = channel == OUT ? 1 : 2;
+		for (size_t done = 0; done < len; ){
+			ssize_t put = ::write(outFd, buf.data() + done, len - done);
+			if (put < 0 && errno == EINTR){ continue; }
+			if (put <= 0){ break; }
+			done += static_cast<size_t>(put);
+		}
+	}
+	::close(fd);
+	std::cerr << "Lost the connection to the cmmc server at "
+	<< socketPath << std::endl;
+	return 1;
+}
+
+} //End namespace cminusminus
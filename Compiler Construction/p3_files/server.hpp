@@ -0,0 +1,43 @@
+#ifndef CMINUSMINUS_SERVER_HPP
+#define CMINUSMINUS_SERVER_HPP
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace cminusminus{
+
+/*
+cmmc --server keeps one process (with its interned names, arena 
+bookkeeping and warmed-up heap) alive across many compiles. 
+Clients talk to it over a Unix domain socket:
+
+   request:  uint32 count, then count strings, each a uint32
+             length and its bytes. The first string is the 
+             client's working directory, the rest its arguments.
+   response: frames of uint8 channel, uint32 length, bytes.
+             Channel 1 is stdout and 2 is stderr; channel 3 
+             carries the int32 exit status and ends the reply.
+
+All integers are in host byte order; both ends are on one host.
+A request of more than 65536 strings, or with a string longer
+than 1MB, gets no response.
+*/
+
+/** Runs one request; returns the exit status for the client **/
+typedef int (*RequestHandler)(const std::string& dir,
+  const std::vector<std::string>& args,
+  std::ostream& out, std::ostream& err);
+
+/** Answer requests on socketPath, each on its own thread, until
+ * killed. Returns only if the socket cannot be set up **/
+int serve(const char * socketPath, RequestHandler handler);
+
+/** Run args on the server at socketPath, copying its output to
+ * our stdout and stderr. Returns the server's exit status, or -1
+ * if no server is listening there **/
+int forward(const char * socketPath, const std::vector<std::string>& args);
+
+} //End namespace cminusminus
+
+#endif
@@ -0,0 +1,129 @@
+#include "ast.hpp"
+
+namespace cminusminus{
+
+/*
+Moving a subtree moves every node in it. Leaves (names, types
+and literals) use ASTNode::shiftLines, which moves just the node
+itself.
+*/
+
+template <typename T>
+static void shiftList(NodeList<T> * nodes, long lines){
+	for (auto node : *nodes){
+		node->shiftLines(lines);
+	}
+}
+
+void ProgramNode::shiftLines(long lines){
+	myPos.shiftLines(lines);
+	shiftList(myGlobals, lines);
+}
+
+void VarDeclNode::shiftLines(long lines){
+	myPos.shiftLines(lines);
+	myType->shiftLines(lines);
+	myId->shiftLines(lines);
+}
+
+void PtrTypeNode::shiftLines(long lines){
+	myPos.shiftLines(lines);
+	myBase->shiftLines(lines);
+}
+
+void FnDeclNode::shiftLines(long lines){
+	myPos.shiftLines(lines);
+	myRetType->shiftLines(lines);
+	myId->shiftLines(lines);
+	shiftList(myFormals, lines);
+	shiftList(myBody, lines);
+}
+
+void DerefNode::shiftLines(long lines){
+	myPos.shiftLines(lines);
+	myId->shiftLines(lines);
+}
+
+void RefNode::shiftLines(long lines){
+	myPos.shiftLines(lines);
+	myId->shiftLines(lines);
+}
+
+void AssignExpNode::shiftLines(long lines){
+	myPos.shiftLines(lines);
+	myDst->shiftLines(lines);
+	mySrc->shiftLines(lines);
+}
+
+void CallExpNode::shiftLines(long lines){
+	myPos.shiftLines(lines);
+	myId->shiftLines(lines);
+	shiftList(myArgs, lines);
+}
+
+void BinaryExpNode::shiftLines(long lines){
+	myPos.shiftLines(lines);
+	myLhs->shiftLines(lines);
+	myRhs->shiftLines(lines);
+}
+
+void UnaryExpNode::shiftLines(long lines){
+	myPos.shiftLines(lines);
+	myExp->shiftLines(lines);
+}
+
+void AssignStmtNode::shiftLines(long lines){
+	myPos.shiftLines(lines);
+	myExp->shiftLines(lines);
+}
+
+void PostIncStmtNode::shiftLines(long lines){
+	myPos.shiftLines(lines);
+	myLVal->shiftLines(lines);
+}
+
+void PostDecStmtNode::shiftLines(long lines){
+	myPos.shiftLines(lines);
+	myLVal->shiftLines(lines);
+}
+
+void ReadStmtNode::shiftLines(long lines){
+	myPos.shiftLines(lines);
+	myDst->shiftLines(lines);
+}
+
+void WriteStmtNode::shiftLines(long lines){
+	myPos.shiftLines(lines);
+	mySrc->shiftLines(lines);
+}
+
+void WhileStmtNode::shiftLines(long lines){
+	myPos.shiftLines(lines);
+	myCond->shiftLines(lines);
+	shiftList(myBody, lines);
+}
+
+void IfStmtNode::shiftLines(long lines){
+	myPos.shiftLines(lines);
+	myCond->shiftLines(lines);
+	shiftList(myBody, lines);
+}
+
+void IfElseStmtNode::shiftLines(long lines){
+	myPos.shiftLines(lines);
+	myCond->shiftLines(lines);
+	shiftList(myBodyTrue, lines);
+	shiftList(myBodyFalse, lines);
+}
+
+void ReturnStmtNode::shiftLines(long lines){
+	myPos.shiftLines(lines);
+	if (myExp != nullptr){ myExp->shiftLines(lines); }
+}
+
+void CallStmtNode::shiftLines(long lines){
+	myPos.shiftLines(lines);
+	myCall->shiftLines(lines);
+}
+
+} // End namespace cminusminus
@@ -0,0 +1,141 @@
+#include "simdscan.hpp"
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace cminusminus{
+
+namespace simd{
+
+static inline bool isBlank(char c){ return c == ' ' || c == '\t'; }
+static inline bool isIdCont(char c){
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')
+	  || (c >= '0' && c <= '9') || c == '_';
+}
+
+size_t blankRunScalar(const char * p, size_t n){
+	size_t i = 0;
+	while (i < n && isBlank(p[i])){ i++; }
+	return i;
+}
+
+size_t idContRunScalar(const char * p, size_t n){
+	size_t i = 0;
+	while (i < n && isIdCont(p[i])){ i++; }
+	return i;
+}
+
+#if defined(__x86_64__)
+
+/* Signed byte compares: bytes >= 0x80 compare as negative and
+   so never fall inside the ASCII ranges tested here */
+static inline __m128i inRange16(__m128i v, char lo, char hi){
+	return _mm_and_si128(
+		_mm_cmpgt_epi8(v, _mm_set1_epi8(static_cast<char>(lo - 1))),
+		_mm_cmplt_epi8(v, _mm_set1_epi8(static_cast<char>(hi + 1))));
+}
+
+static inline __m128i idMask16(__m128i v){
+	//Setting bit 5 folds A-Z onto a-z and nothing else onto a-z
+	__m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+	__m128i m = _mm_or_si128(inRange16(lower, 'a', 'z'),
+		inRange16(v, '0', '9'));
+	return _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('_')));
+}
+
+static inline __m128i blankMask16(__m128i v){
+	return _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+		_mm_cmpeq_epi8(v, _mm_set1_epi8('\t')));
+}
+
+size_t blankRunSse2(const char * p, size_t n){
+	size_t i = 0;
+	for (; i + 16 <= n; i += 16){
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+		unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(blankMask16(v)));
+		if (mask != 0xFFFFu){
+			return i + static_cast<size_t>(__builtin_ctz(~mask));
+		}
+	}
+	return i + blankRunScalar(p + i, n - i);
+}
+
+size_t idContRunSse2(const char * p, size_t n){
+	size_t i = 0;
+	for (; i + 16 <= n; i += 16){
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+		unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(idMask16(v)));
+		if (mask != 0xFFFFu){
+			return i + static_cast<size_t>(__builtin_ctz(~mask));
+		}
+	}
+	return i + idContRunScalar(p + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i inRange32(__m256i v, char lo, char hi){
+	return _mm256_and_si256(
+		_mm256_cmpgt_epi8(v, _mm256_set1_epi8(static_cast<char>(lo - 1))),
+		_mm256_cmpgt_epi8(_mm256_set1_epi8(static_cast<char>(hi + 1)), v));
+}
+
+__attribute__((target("avx2")))
+size_t blankRunAvx2(const char * p, size_t n){
+	size_t i = 0;
+	for (; i + 32 <= n; i += 32){
+		__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + i));
+		__m256i m = _mm256_or_si256(
+			_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+			_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t')));
+		unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(m));
+		if (mask != 0xFFFFFFFFu){
+			return i + static_cast<size_t>(__builtin_ctz(~mask));
+		}
+	}
+	return i + blankRunSse2(p + i, n - i);
+}
+
+__attribute__((target("avx2")))
+size_t idContRunAvx2(const char * p, size_t n){
+	size_t i = 0;
+	for (; i + 32 <= n; i += 32){
+		__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + i));
+		__m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+		__m256i m = _mm256_or_si256(inRange32(lower, 'a', 'z'),
+			inRange32(v, '0', '9'));
+		m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_')));
+		unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(m));
+		if (mask != 0xFFFFFFFFu){
+			return i + static_cast<size_t>(__builtin_ctz(~mask));
+		}
+	}
+	return i + idContRunSse2(p + i, n - i);
+}
+
+bool haveAvx2(){
+	//Also used from static initializers, so init the cpu model first
+	__builtin_cpu_init();
+	static const bool avx2 = __builtin_cpu_supports("avx2");
+	return avx2;
+}
+
+static const bool useAvx2 = haveAvx2();
+
+size_t blankRun(const char * p, size_t n){
+	return useAvx2 ? blankRunAvx2(p, n) : blankRunSse2(p, n);
+}
+
+size_t idContRun(const char * p, size_t n){
+	return useAvx2 ? idContRunAvx2(p, n) : idContRunSse2(p, n);
+}
+
+#else
+
+size_t blankRun(const char * p, size_t n){ return blankRunScalar(p, n); }
+size_t idContRun(const char * p, size_t n){ return idContRunScalar(p, n); }
+
+#endif
+
+} // End namespace simd
+
+} //End namespace cminusminus
@@ -0,0 +1,46 @@
+#ifndef CMINUSMINUS_SIMDSCAN_HPP
+#define CMINUSMINUS_SIMDSCAN_HPP
+
+#include <cstddef>
+#include <cstring>
+
+namespace cminusminus{
+
+/*
+Run-length helpers for the hand-coded scanner's hottest loops.
+Each returns how many leading bytes of [p, p+n) belong to the run;
+none of the runs can contain a newline, so callers advance the
+column by the returned count. On x86-64 the SSE2 or AVX2 version
+is picked once at startup; other targets use the scalar loops.
+*/
+namespace simd{
+
+/** Leading bytes in [ \t] **/
+size_t blankRun(const char * p, size_t n);
+
+/** Leading bytes in [A-Za-z0-9_] **/
+size_t idContRun(const char * p, size_t n);
+
+/** Leading bytes up to (not including) the next '\n' **/
+inline size_t lineRun(const char * p, size_t n){
+	const void * nl = std::memchr(p, '\n', n);
+	return nl == nullptr ? n 
+	  : static_cast<size_t>(static_cast<const char *>(nl) - p);
+}
+
+/* The individual implementations, exposed for bench/simd_bench */
+size_t blankRunScalar(const char * p, size_t n);
+size_t idContRunScalar(const char * p, size_t n);
+#if defined(__x86_64__)
+size_t blankRunSse2(const char * p, size_t n);
+size_t idContRunSse2(const char * p, size_t n);
+size_t blankRunAvx2(const char * p, size_t n);
+size_t idContRunAvx2(const char * p, size_t n);
+bool haveAvx2();
+#endif
+
+} // End namespace simd
+
+} //End namespace cminusminus
+
+#endif
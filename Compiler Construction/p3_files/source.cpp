@@ -0,0 +1,65 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <cstring>
+#include "source.hpp"
+
+namespace cminusminus{
+
+static char * readAll(int fd, size_t sizeHint, size_t * sizeOut){
+	size_t cap = sizeHint > 0 ? sizeHint + 1 : 64 * 1024;
+	size_t len = 0;
+	char * buf = static_cast<char *>(std::malloc(cap));
+	while (buf != nullptr){
+		if (len == cap){
+			cap *= 2;
+			char * bigger = static_cast<char *>(std::realloc(buf, cap));
+			if (bigger == nullptr){ std::free(buf); return nullptr; }
+			buf = bigger;
+		}
+		ssize_t got = ::read(fd, buf + len, cap - len);
+		if (got < 0){ std::free(buf); return nullptr; }
+		if (got == 0){ break; }
+		len += static_cast<size_t>(got);
+	}
+	*sizeOut = len;
+	return buf;
+}
+
+SourceFile * SourceFile::open(const char * path){
+	int fd = ::open(path, O_RDONLY);
+	if (fd < 0){ return nullptr; }
+
+	struct stat info;
+	bool regular = fstat(fd, &info) == 0 && S_ISREG(info.st_mode);
+	if (regular && info.st_size > 0){
+		size_t size = static_cast<size_t>(info.st_size);
+		void * map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (map != MAP_FAILED){
+			::close(fd);
+			madvise(map, size, MADV_SEQUENTIAL);
+			return new SourceFile(static_cast<const char *>(map),
+				size, MAPPED);
+		}
+	}
+
+	size_t hint = 0;
+	if (regular){ hint = static_cast<size_t>(info.st_size); }
+	size_t size = 0;
+	char * buf = readAll(fd, hint, &size);
+	::close(fd);
+	if (buf == nullptr){ return nullptr; }
+	return new SourceFile(buf, size, HEAP);
+}
+
+SourceFile::~SourceFile(){
+	if (myStorage == MAPPED){
+		munmap(const_cast<char *>(myData), mySize);
+	} else if (myStorage == HEAP){
+		std::free(const_cast<char *>(myData));
+	}
+}
+
+} //End namespace cminusminus
@@ -0,0 +1,43 @@
+#ifndef CMINUSMINUS_SOURCE_HPP
+#define CMINUSMINUS_SOURCE_HPP
+
+#include <cstddef>
+
+namespace cminusminus{
+
+/**
+* \class SourceFile
+* The complete text of one input file, held in a single
+* contiguous buffer. Regular files are mmapped read-only;
+* anything that cannot be mapped (pipes, empty files) is
+* read with one pass of read() into a heap buffer instead.
+* view() wraps memory owned elsewhere, such as a slice of
+* another SourceFile, without copying it.
+**/
+class SourceFile{
+public:
+	/** Returns nullptr if the file cannot be opened **/
+	static SourceFile * open(const char * path);
+	/** A SourceFile over size bytes at data, which must
+	 * outlive it **/
+	static SourceFile * view(const char * data, size_t size){
+		return new SourceFile(data, size, BORROWED);
+	}
+	~SourceFile();
+	SourceFile(const SourceFile&) = delete;
+	SourceFile& operator=(const SourceFile&) = delete;
+
+	const char * data() const { return myData; }
+	size_t size() const { return mySize; }
+private:
+	enum Storage { MAPPED, HEAP, BORROWED };
+	SourceFile(const char * dataIn, size_t sizeIn, Storage storageIn)
+	: myData(dataIn), mySize(sizeIn), myStorage(storageIn){ }
+	const char * myData;
+	size_t mySize;
+	Storage myStorage;
+};
+
+} //End namespace cminusminus
+
+#endif
@@ -0,0 +1,199 @@
+#include <sys/resource.h>
+#include <ctime>
+#include <iomanip>
+#include "json.hpp"
+#include "stats.hpp"
+#include "tokens.hpp"
+
+namespace cminusminus{
+
+/* Phase names in the text report and in the JSON */
+static const char * const PHASE_LABELS[CompileStats::PHASE_COUNT] = {
+	"read", "lex", "parse+AST", "unparse", "AST image",
+	"name analysis", "type analysis", "3AC lowering", "x86-64 codegen"
+};
+static const char * const PHASE_KEYS[CompileStats::PHASE_COUNT] = {
+	"read", "lex", "parse", "unparse", "astImage", "names",
+	"types", "lower", "codegen"
+};
+
+double CompileStats::cpuNow(){
+	struct timespec now;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+	return static_cast<double>(now.tv_sec)
+	  + static_cast<double>(now.tv_nsec) / 1e9;
+}
+
+CompileStats::Timer::Timer(CompileStats * statsIn, Phase phaseIn)
+: myStats(statsIn), myPhase(phaseIn), myWall(0), myCpu(0), myLexTime(0){
+	if (myStats == nullptr){ return; }
+	myWall = wallNow();
+	myCpu = cpuNow();
+	myLexTime = myStats->lexTime();
+}
+
+void CompileStats::Timer::stop(){
+	if (myStats == nullptr){ return; }
+	//Take out any scanning done meanwhile, which is reported
+	// under LEX instead
+	double lexTime = myStats->lexTime() - myLexTime;
+	myStats->addTime(myPhase, wallNow() - myWall - lexTime,
+		cpuNow() - myCpu - lexTime);
+	myStats = nullptr;
+}
+
+void CompileStats::addTime(Phase phase, double wall, double cpu){
+	Times& times = myTimes[phase];
+	times.ran = true;
+	times.wall += wall;
+	times.cpu += cpu;
+}
+
+void CompileStats::addArena(const Arena& arena){
+	for (auto kind : arena.kinds()){
+		//Drop the namespace from the class names
+		const std::string ns = "cminusminus::";
+		size_t at;
+		while ((at = kind.name.find(ns)) != std::string::npos){
+			kind.name.erase(at, ns.size());
+		}
+		myArenaKinds.push_back(kind);
+	}
+	myArenaUsed += arena.bytesUsed();
+	myArenaReserved += arena.bytesReserved();
+}
+
+void CompileStats::finish(bool ok){
+	myOk = ok;
+	if (myLexCalls > 0){
+		myTimes[LEX].ran = true;
+		myTimes[LEX].wall = myTimes[LEX].cpu = lexTime();
+	}
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) == 0){
+		myPeakRssKB = usage.ru_maxrss;
+	}
+}
+
+/* AST nodes are the arena classes named ...Node; the rest are
+   tokens and child lists */
+static bool isNodeClass(const std::string& name){
+	const std::string suffix = "Node";
+	return name.size() > suffix.size()
+	  && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+void CompileStats::report(std::ostream& out) const{
+	std::ios_base::fmtflags oldFlags = out.flags();
+	std::streamsize oldPrecision = out.precision();
+	out << std::fixed << std::setprecision(3);
+
+	out << "Stats for " << myFile << (myOk ? "" : " (gave up)") << ":\n";
+	out << "  " << std::left << std::setw(20) << "phase" << std::right
+	  << std::setw(14) << "wall ms" << std::setw(14) << "cpu ms" << "\n";
+	for (size_t p = 0; p < PHASE_COUNT; p++){
+		if (!myTimes[p].ran){ continue; }
+		out << "  " << std::left << std::setw(20) << PHASE_LABELS[p]
+		  << std::right << std::setw(14) << myTimes[p].wall * 1e3
+		  << std::setw(14) << myTimes[p].cpu * 1e3 << "\n";
+	}
+
+	uint64_t numTokens = 0;
+	for (auto count : myTokens){ numTokens += count; }
+	out << "  tokens: " << numTokens << "\n";
+	for (size_t k = 0; k < myTokens.size(); k++){
+		if (myTokens[k] == 0){ continue; }
+		out << "    " << std::left << std::setw(18)
+		  << tokenKindName(static_cast<int>(k))
+		  << std::right << std::setw(14) << myTokens[k] << "\n";
+	}
+
+	for (int nodes = 1; nodes >= 0; nodes--){
+		size_t count = 0;
+		size_t bytes = 0;
+		for (const auto& kind : myArenaKinds){
+			if (isNodeClass(kind.name) != (nodes == 1)){ continue; }
+			count += kind.count;
+			bytes += kind.bytes;
+		}
+		out << (nodes == 1 ? "  AST nodes: " : "  other arena objects: ")
+		  << count << " (" << bytes << " bytes)\n";
+		for (const auto& kind : myArenaKinds){
+			if (isNodeClass(kind.name) != (nodes == 1)){ continue; }
+			out << "    " << std::left << std::setw(40) << kind.name
+			  << std::right << std::setw(12) << kind.count
+			  << std::setw(14) << kind.bytes << "\n";
+		}
+	}
+	out << "  arena: " << myArenaUsed << " bytes used, "
+	  << myArenaReserved << " bytes reserved\n";
+	out << "  peak RSS: " << myPeakRssKB << " KB\n";
+
+	out.flags(oldFlags);
+	out.precision(oldPrecision);
+}
+
+void CompileStats::writeJson(std::ostream& out) const{
+	std::ios_base::fmtflags oldFlags = out.flags();
+	std::streamsize oldPrecision = out.precision();
+	out << std::fixed << std::setprecision(3);
+
+	out << "{\"file\": ";
+	putJsonString(out, myFile);
+	out << ", \"ok\": " << (myOk ? "true" : "false");
+
+	out << ", \"phases\": {";
+	const char * sep = "";
+	for (size_t p = 0; p < PHASE_COUNT; p++){
+		if (!myTimes[p].ran){ continue; }
+		out << sep << "\"" << PHASE_KEYS[p] << "\": {\"wallMs\": "
+		  << myTimes[p].wall * 1e3 << ", \"cpuMs\": "
+		  << myTimes[p].cpu * 1e3 << "}";
+		sep = ", ";
+	}
+	out << "}";
+
+	out << ", \"tokens\": {";
+	sep = "";
+	for (size_t k = 0; k < myTokens.size(); k++){
+		if (myTokens[k] == 0){ continue; }
+		out << sep;
+		putJsonString(out, tokenKindName(static_cast<int>(k)));
+		out << ": " << myTokens[k];
+		sep = ", ";
+	}
+	out << "}";
+
+	for (int nodes = 1; nodes >= 0; nodes--){
+		out << (nodes == 1 ? ", \"astNodes\": {" : ", \"otherArena\": {");
+		sep = "";
+		for (const auto& kind : myArenaKinds){
+			if (isNodeClass(kind.name) != (nodes == 1)){ continue; }
+			out << sep;
+			putJsonString(out, kind.name);
+			out << ": {\"count\": " << kind.count
+			  << ", \"bytes\": " << kind.bytes << "}";
+			sep = ", ";
+		}
+		out << "}";
+	}
+	out << ", \"arenaBytesUsed\": " << myArenaUsed
+	  << ", \"arenaBytesReserved\": " << myArenaReserved
+	  << ", \"peakRssKB\": " << myPeakRssKB << "}";
+
+	out.flags(oldFlags);
+	out.precision(oldPrecision);
+}
+
+void CompileStats::writeJson(std::ostream& out,
+  const std::vector<CompileStats>& all){
+	out << "{\"statsVersion\": 1, \"files\": [\n";
+	for (size_t i = 0; i < all.size(); i++){
+		out << "  ";
+		all[i].writeJson(out);
+		out << (i + 1 < all.size() ? ",\n" : "\n");
+	}
+	out << "]}\n";
+}
+
+} //End namespace cminusminus
@@ -0,0 +1,137 @@
+#ifndef CMINUSMINUS_STATS_HPP
+#define CMINUSMINUS_STATS_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "arena.hpp"
+
+namespace cminusminus{
+
+/**
+* \class CompileStats
+* What --stats reports about the compile of one input file: wall
+* and CPU time for each phase, the tokens scanned by kind, the
+* objects in the arena by class, and memory use.
+**/
+class CompileStats{
+public:
+	/* AST construction happens in the parser's actions, so its
+	   time is part of PARSE. LEX is the time spent in the scanner
+	   and is not part of PARSE, even though the parser is what
+	   asks for each token */
+	enum Phase { READ, LEX, PARSE, UNPARSE, AST_IMAGE, NAMES,
+	  TYPES, LOWER, CODEGEN, PHASE_COUNT };
+
+	/** Measures one stretch of a phase: wall and thread CPU time
+	 * from construction to stop() (or destruction) **/
+	class Timer{
+	public:
+		Timer(CompileStats * statsIn, Phase phaseIn);
+		~Timer(){ stop(); }
+		void stop();
+	private:
+		CompileStats * myStats;
+		Phase myPhase;
+		double myWall;
+		double myCpu;
+		double myLexTime;
+	};
+
+	static double wallNow(){
+		return std::chrono::duration<double>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+	/** CPU time used by the calling thread, in seconds **/
+	static double cpuNow();
+
+	CompileStats(const std::string& fileIn) : myFile(fileIn){ }
+
+	/** One token (or the end of the input) handed out by the
+	 * scanner **/
+	void lexed(int tokenKind){
+		myLexCalls++;
+		//Kind 0 is the end of the input rather than a token
+		if (tokenKind == 0){ return; }
+		size_t kind = static_cast<size_t>(tokenKind);
+		if (kind >= myTokens.size()){ myTokens.resize(kind + 1, 0); }
+		myTokens[kind]++;
+	}
+	/** Reading the clock around every token would cost about
+	 * as much as scanning it, so the scanner times only the 
+	 * calls for which this says yes (the first LEX_EXACT, then
+	 * one in LEX_SAMPLE) and reports each with lexSample **/
+	bool sampleToken(){
+		if (myLexCalls < LEX_EXACT){ return true; }
+		//Chosen at random (xorshift) rather than every nth call,
+		// which can fall into step with a pattern in the input
+		// or in the scanner and time only the slow tokens
+		mySampleState ^= mySampleState << 13;
+		mySampleState ^= mySampleState >> 17;
+		mySampleState ^= mySampleState << 5;
+		return (mySampleState & (LEX_SAMPLE - 1)) == 0;
+	}
+	void lexSample(double wall){
+		if (myLexCalls < LEX_EXACT){
+			myLexExactWall += wall;
+		} else {
+			myLexSamples++;
+			myLexSampleWall += wall;
+		}
+	}
+	/** Record the objects in arena; called once the phase that
+	 * filled it is done **/
+	void addArena(const Arena& arena);
+	/** The compile is over; ok is false if it gave up. Takes
+	 * the peak RSS so far **/
+	void finish(bool ok);
+
+	/** The report printed by --stats **/
+	void report(std::ostream& out) const;
+	/** The same as one JSON object, for --stats-json **/
+	void writeJson(std::ostream& out) const;
+	/** A JSON document holding every file's stats **/
+	static void writeJson(std::ostream& out,
+	  const std::vector<CompileStats>& all);
+
+private:
+	struct Times{
+		bool ran = false;
+		double wall = 0;
+		double cpu = 0;
+	};
+	void addTime(Phase phase, double wall, double cpu);
+	/* Scanning time so far, scaled up from the samples. The
+	   scanner never waits on anything (the input is already in
+	   memory), so this is CPU time as well */
+	double lexTime() const {
+		if (myLexSamples == 0){ return myLexExactWall; }
+		return myLexExactWall + myLexSampleWall
+		  * static_cast<double>(myLexCalls - LEX_EXACT)
+		  / static_cast<double>(myLexSamples);
+	}
+
+	static const uint64_t LEX_EXACT = 1024;
+	static const uint32_t LEX_SAMPLE = 64;
+
+	std::string myFile;
+	bool myOk = true;
+	Times myTimes[PHASE_COUNT];
+	/* Tokens scanned, indexed by token kind */
+	std::vector<uint64_t> myTokens;
+	uint64_t myLexCalls = 0;
+	double myLexExactWall = 0;
+	uint64_t myLexSamples = 0;
+	uint32_t mySampleState = 2463534242u;
+	double myLexSampleWall = 0;
+	std::vector<Arena::KindUsage> myArenaKinds;
+	size_t myArenaUsed = 0;
+	size_t myArenaReserved = 0;
+	long myPeakRssKB = 0;
+};
+
+} //End namespace cminusminus
+
+#endif
@@ -0,0 +1,57 @@
+#include "symbol.hpp"
+
+namespace cminusminus{
+
+Interner& Interner::global(){
+	static Interner theInterner;
+	return theInterner;
+}
+
+Interner::Interner() : myCount(0), mySlots(1024, 0){
+	//Symbol 0 is the empty name, so a default Symbol is valid
+	intern("", 0);
+}
+
+Symbol Interner::intern(const char * chars, size_t len){
+	uint32_t h = hash(chars, len);
+	std::lock_guard<std::mutex> lock(myLock);
+	size_t mask = mySlots.size() - 1;
+	size_t idx = h & mask;
+	while (mySlots[idx] != 0){
+		uint32_t id = mySlots[idx] - 1;
+		const std::string& name = str(Symbol(id));
+		if (myHashes[id] == h && name.size() == len
+		  && std::memcmp(name.data(), chars, len) == 0){
+			return Symbol(id);
+		}
+		idx = (idx + 1) & mask;
+	}
+
+	uint32_t id = static_cast<uint32_t>(myCount);
+	std::unique_ptr<std::string[]>& block = myBlocks[id >> BLOCK_BITS];
+	if (block == nullptr){
+		block.reset(new std::string[BLOCK_MASK + 1]);
+	}
+	block[id & BLOCK_MASK].assign(chars, len);
+	myCount++;
+	myHashes.push_back(h);
+	mySlots[idx] = id + 1;
+	//Keep the load factor under 1/2
+	if (myCount * 2 > mySlots.size()){ grow(); }
+	return Symbol(id);
+}
+
+void Interner::grow(){
+	std::vector<uint32_t> old;
+	old.swap(mySlots);
+	mySlots.assign(old.size() * 2, 0);
+	size_t mask = mySlots.size() - 1;
+	for (auto slot : old){
+		if (slot == 0){ continue; }
+		size_t idx = myHashes[slot - 1] & mask;
+		while (mySlots[idx] != 0){ idx = (idx + 1) & mask; }
+		mySlots[idx] = slot;
+	}
+}
+
+} //End namespace cminusminus
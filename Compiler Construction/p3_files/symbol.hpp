@@ -0,0 +1,88 @@
+#ifndef CMINUSMINUS_SYMBOL_HPP
+#define CMINUSMINUS_SYMBOL_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace cminusminus{
+
+/**
+* \class Symbol
+* A 32-bit handle for an interned identifier. Two Symbols
+* are equal exactly when their spellings are equal, so
+* comparing names is a single integer compare.
+**/
+class Symbol{
+public:
+	Symbol() : myId(0){ }
+	explicit Symbol(uint32_t idIn) : myId(idIn){ }
+	uint32_t id() const { return myId; }
+	bool operator==(Symbol other) const { return myId == other.myId; }
+	bool operator!=(Symbol other) const { return myId != other.myId; }
+	/** The spelling of this identifier **/
+	const std::string& str() const;
+private:
+	uint32_t myId;
+};
+
+/**
+* \class Interner
+* The process-wide table of identifier spellings. Each distinct
+* spelling is stored once; intern() hashes the raw characters
+* (no std::string temporary) and probes an open-addressed table
+* of Symbol ids.
+* intern() is safe to call from several threads. Spellings live
+* in fixed-size blocks that never move, so str() takes no lock.
+**/
+class Interner{
+public:
+	static Interner& global();
+
+	Symbol intern(const char * chars, size_t len);
+	Symbol intern(const std::string& s){
+		return intern(s.data(), s.size());
+	}
+	const std::string& str(Symbol sym) const {
+		return myBlocks[sym.id() >> BLOCK_BITS][sym.id() & BLOCK_MASK];
+	}
+	size_t size() const {
+		std::lock_guard<std::mutex> lock(myLock);
+		return myCount;
+	}
+
+private:
+	Interner();
+	static uint32_t hash(const char * chars, size_t len){
+		//FNV-1a
+		uint32_t h = 2166136261u;
+		for (size_t i = 0; i < len; i++){
+			h ^= static_cast<unsigned char>(chars[i]);
+			h *= 16777619u;
+		}
+		return h;
+	}
+	void grow();
+
+	static const uint32_t BLOCK_BITS = 14;
+	static const uint32_t BLOCK_MASK = (1u << BLOCK_BITS) - 1;
+	static const uint32_t MAX_BLOCKS = 1u << 14;
+
+	mutable std::mutex myLock;
+	size_t myCount;
+	std::unique_ptr<std::string[]> myBlocks[MAX_BLOCKS];
+	std::vector<uint32_t> myHashes;
+	/* Slots hold a Symbol id + 1; 0 marks an empty slot */
+	std::vector<uint32_t> mySlots;
+};
+
+inline const std::string& Symbol::str() const {
+	return Interner::global().str(*this);
+}
+
+} //End namespace cminusminus
+
+#endif
@@ -0,0 +1,71 @@
+#include <algorithm>
+#include "ast.hpp"
+#include "symindex.hpp"
+
+namespace cminusminus{
+
+static bool before(const Position& a, const Position& b){
+	return a.line() < b.line()
+	  || (a.line() == b.line() && a.col() < b.col());
+}
+
+SymbolIndex::SymbolIndex() : myFunction(NONE){
+}
+
+void SymbolIndex::build(const ProgramNode * program){
+	myDecls.clear();
+	myOccurrences.clear();
+	myScopes.clear();
+	myFunction = NONE;
+	enterScope();
+	program->index(*this);
+	leaveScope();
+	//The walk goes in text order, but make sure of it
+	std::sort(myOccurrences.begin(), myOccurrences.end(),
+		[](const Occurrence& a, const Occurrence& b){
+			return before(a.pos, b.pos);
+		});
+}
+
+const SymbolIndex::Decl * SymbolIndex::declarationAt(size_t line,
+  size_t col) const{
+	//The last name starting at or before line, col
+	Position at(line, col, line, col);
+	auto next = std::upper_bound(myOccurrences.begin(),
+		myOccurrences.end(), at,
+		[](const Position& pos, const Occurrence& o){
+			return before(pos, o.pos);
+		});
+	if (next == myOccurrences.begin()){ return nullptr; }
+	const Occurrence& o = *(next - 1);
+	if (o.pos.line() != line || col >= o.pos.endCol()
+	  || o.decl == NONE){
+		return nullptr;
+	}
+	return &myDecls[o.decl];
+}
+
+void SymbolIndex::enterScope(){
+	myScopes.enterScope();
+}
+
+void SymbolIndex::leaveScope(){
+	myScopes.leaveScope();
+}
+
+size_t SymbolIndex::declare(const IDNode * id, const ASTNode * decl,
+  Kind kind){
+	size_t n = myDecls.size();
+	myDecls.push_back({id->getName(), kind, id->pos(), decl->pos(),
+		kind == FUNCTION ? NONE : myFunction});
+	myOccurrences.push_back({id->pos(), n});
+	//A name declared again in one scope keeps its first meaning
+	myScopes.declare(id->getName(), n);
+	return n;
+}
+
+void SymbolIndex::use(const IDNode * id){
+	myOccurrences.push_back({id->pos(), myScopes.lookup(id->getName())});
+}
+
+} //End namespace cminusminus
@@ -0,0 +1,82 @@
+#ifndef CMINUSMINUS_SYMINDEX_HPP
+#define CMINUSMINUS_SYMINDEX_HPP
+
+#include <cstdint>
+#include <vector>
+#include "position.hpp"
+#include "symbol.hpp"
+#include "symtable.hpp"
+
+namespace cminusminus{
+
+class ASTNode;
+class IDNode;
+class ProgramNode;
+
+/**
+* \class SymbolIndex
+* Every declaration in a program, and every name in its text
+* along with the declaration it refers to, for the language
+* server to look things up by position. Names are resolved the
+* way C-- scopes them: a function's formals and the locals at
+* the top of its body share one scope, each while or if body
+* opens a new one, and a name refers to the nearest enclosing
+* declaration that comes before it.
+**/
+class SymbolIndex{
+public:
+	enum Kind { VARIABLE, FUNCTION, PARAMETER };
+	static const size_t NONE = SIZE_MAX;
+
+	struct Decl{
+		Symbol name;
+		Kind kind;
+		/* The declared name */
+		Position id;
+		/* The whole declaration */
+		Position whole;
+		/* The declaration of the function this one is in, or
+		   NONE for a global */
+		size_t function;
+	};
+
+	SymbolIndex();
+
+	/** Index all of program, replacing what was there **/
+	void build(const ProgramNode * program);
+
+	/** In the order they appear in the text **/
+	const std::vector<Decl>& decls() const { return myDecls; }
+
+	/** The declaration of the name at line and col (both from
+	 * 1), whether that is a use or the declaration itself.
+	 * nullptr if there is no name there or it is undeclared **/
+	const Decl * declarationAt(size_t line, size_t col) const;
+
+	/* For ASTNode::index */
+	void enterScope();
+	void leaveScope();
+	/** Declare id in the innermost scope. Returns the index of
+	 * the new Decl **/
+	size_t declare(const IDNode * id, const ASTNode * decl, Kind kind);
+	void use(const IDNode * id);
+	void enterFunction(size_t decl){ myFunction = decl; }
+	void leaveFunction(){ myFunction = NONE; }
+
+private:
+	/* A name in the text, and the Decl it is or refers to */
+	struct Occurrence{
+		Position pos;
+		size_t decl;
+	};
+
+	std::vector<Decl> myDecls;
+	std::vector<Occurrence> myOccurrences;
+	/* Name to the index of its Decl */
+	ScopeChain myScopes;
+	size_t myFunction;
+};
+
+} //End namespace cminusminus
+
+#endif
@@ -0,0 +1,102 @@
+#include <algorithm>
+#include "ast.hpp"
+#include "symtable.hpp"
+#include "types.hpp"
+
+namespace cminusminus{
+
+/* Symbol ids are small and handed out in sequence; multiplying
+   by an odd constant keeps ids that differ by a stride (say,
+   the names of one program among many) from piling up */
+static size_t hashId(uint32_t id){
+	return static_cast<size_t>(id * 2654435769u);
+}
+
+ScopeChain::ScopeChain()
+: myDepth(0), myKeys(256, 0), myHeads(256, 0), myNames(0){
+}
+
+void ScopeChain::clear(){
+	myDepth = 0;
+	myBindings.clear();
+	//The names can stay: with no bindings they are out of scope
+	std::fill(myHeads.begin(), myHeads.end(), 0);
+}
+
+void ScopeChain::leaveScope(){
+	while (!myBindings.empty() && myBindings.back().depth == myDepth){
+		const Binding& inner = myBindings.back();
+		myHeads[slotOf(inner.name)] = inner.shadowed;
+		myBindings.pop_back();
+	}
+	myDepth--;
+}
+
+size_t ScopeChain::slotOf(Symbol name) const{
+	size_t mask = myKeys.size() - 1;
+	size_t idx = hashId(name.id()) & mask;
+	uint32_t key = name.id() + 1;
+	while (myKeys[idx] != 0 && myKeys[idx] != key){
+		idx = (idx + 1) & mask;
+	}
+	return idx;
+}
+
+bool ScopeChain::declare(Symbol name, size_t value){
+	size_t slot = slotOf(name);
+	if (myKeys[slot] == 0){
+		myKeys[slot] = name.id() + 1;
+		myNames++;
+		//Keep the load factor under 1/2
+		if (myNames * 2 > myKeys.size()){
+			grow();
+			slot = slotOf(name);
+		}
+	}
+	uint32_t head = myHeads[slot];
+	if (head != 0 && myBindings[head - 1].depth == myDepth){
+		return false;
+	}
+	myBindings.push_back({name, myDepth, head, value});
+	myHeads[slot] = static_cast<uint32_t>(myBindings.size());
+	return true;
+}
+
+size_t ScopeChain::lookup(Symbol name) const{
+	size_t slot = slotOf(name);
+	uint32_t head = myHeads[slot];
+	return head == 0 ? NONE : myBindings[head - 1].value;
+}
+
+void ScopeChain::grow(){
+	std::vector<uint32_t> oldKeys;
+	std::vector<uint32_t> oldHeads;
+	oldKeys.swap(myKeys);
+	oldHeads.swap(myHeads);
+	myKeys.assign(oldKeys.size() * 2, 0);
+	myHeads.assign(oldKeys.size() * 2, 0);
+	for (size_t i = 0; i < oldKeys.size(); i++){
+		if (oldKeys[i] == 0){ continue; }
+		size_t slot = slotOf(Symbol(oldKeys[i] - 1));
+		myKeys[slot] = oldKeys[i];
+		myHeads[slot] = oldHeads[i];
+	}
+}
+
+void SemSymbol::unparseType(UnparseWriter& out) const{
+	out << myType->getString();
+}
+
+SemSymbol * SymbolTable::declare(SemSymbol::Kind kind, Symbol name,
+  const DeclNode * decl, const DataType * type){
+	if (!myScopes.declare(name, mySymbols.size())){ return nullptr; }
+	mySymbols.emplace_back(mySymbols.size(), kind, name, decl, type);
+	return &mySymbols.back();
+}
+
+SemSymbol * SymbolTable::lookup(Symbol name){
+	size_t found = myScopes.lookup(name);
+	return found == ScopeChain::NONE ? nullptr : &mySymbols[found];
+}
+
+} //End namespace cminusminus
@@ -0,0 +1,138 @@
+#ifndef CMINUSMINUS_SYMTABLE_HPP
+#define CMINUSMINUS_SYMTABLE_HPP
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+#include "symbol.hpp"
+
+namespace cminusminus{
+
+class DataType;
+class DeclNode;
+class UnparseWriter;
+
+/**
+* \class ScopeChain
+* The names in scope at one point of a walk over a program, as
+* hashed scope chains: a single open-addressed table, keyed by
+* Symbol id, whose slot for a name holds the innermost binding
+* of that name. Each binding links to the one it shadows, and
+* the bindings of every open scope sit on one stack, innermost
+* last. So a lookup is one probe however deeply scopes nest, a
+* declaration is one probe plus a push, and leaving a scope
+* pops just what the scope declared. The table and the stack
+* keep their storage from one scope (or one build) to the next.
+**/
+class ScopeChain{
+public:
+	static const size_t NONE = SIZE_MAX;
+
+	ScopeChain();
+
+	/** Forget every scope, keeping the storage **/
+	void clear();
+	void enterScope(){ myDepth++; }
+	void leaveScope();
+	/** Bind name to value in the innermost scope. If that
+	 * scope already has name, nothing changes and this returns
+	 * false **/
+	bool declare(Symbol name, size_t value);
+	/** The value of the innermost binding of name, or NONE **/
+	size_t lookup(Symbol name) const;
+
+private:
+	struct Binding{
+		Symbol name;
+		uint32_t depth;
+		/* Index + 1 of the binding this one shadows, 0 if none */
+		uint32_t shadowed;
+		size_t value;
+	};
+
+	/* The slot for name, or the empty slot where it would go */
+	size_t slotOf(Symbol name) const;
+	void grow();
+
+	uint32_t myDepth;
+	std::vector<Binding> myBindings;
+	/* Slots hold a Symbol id + 1 (0 marks an empty slot) and,
+	   in myHeads, the index + 1 of that name's innermost
+	   binding (0 when it has none in scope) */
+	std::vector<uint32_t> myKeys;
+	std::vector<uint32_t> myHeads;
+	size_t myNames;
+};
+
+/**
+* \class SemSymbol
+* What name analysis knows about one declared name: whether it
+* is a variable or a function, its declaration, and its type.
+* Each has an id, numbering the table's symbols from 0, that
+* later passes can index their own per-symbol arrays by.
+**/
+class SemSymbol{
+public:
+	enum Kind { VAR, FN };
+
+	SemSymbol(size_t idIn, Kind kindIn, Symbol nameIn,
+	  const DeclNode * declIn, const DataType * typeIn)
+	: myId(idIn), myKind(kindIn), myName(nameIn), myDecl(declIn),
+	  myType(typeIn), myAddressTaken(false){ }
+
+	size_t getId() const { return myId; }
+	Kind getKind() const { return myKind; }
+	Symbol getName() const { return myName; }
+	const DeclNode * getDecl() const { return myDecl; }
+	/** A variable's type, or a function's (a DataType::FN) **/
+	const DataType * getDataType() const { return myType; }
+	/** Whether the program takes the address of this variable
+	 * (with &) anywhere, so it has to live in memory **/
+	bool isAddressTaken() const { return myAddressTaken; }
+	void takeAddress(){ myAddressTaken = true; }
+
+	/** Write the type the way the named unparse shows it:
+	 * "int", or for a function "int,bool->void" **/
+	void unparseType(UnparseWriter& out) const;
+
+private:
+	size_t myId;
+	Kind myKind;
+	Symbol myName;
+	const DeclNode * myDecl;
+	const DataType * myType;
+	bool myAddressTaken;
+};
+
+/**
+* \class SymbolTable
+* The state of name analysis: the SemSymbol of every
+* declaration seen, and the scopes open at the current point
+* of the walk (see ScopeChain). SemSymbols stay put until the
+* table is deleted, so the IDNodes that point at them are good
+* for as long as the table is.
+**/
+class SymbolTable{
+public:
+	void enterScope(){ myScopes.enterScope(); }
+	void leaveScope(){ myScopes.leaveScope(); }
+
+	/** Make a SemSymbol for a declaration and add it to the
+	 * innermost scope. Returns nullptr, adding nothing, if the
+	 * scope already has the name **/
+	SemSymbol * declare(SemSymbol::Kind kind, Symbol name,
+	  const DeclNode * decl, const DataType * type);
+	/** The innermost declaration of name in scope, or nullptr **/
+	SemSymbol * lookup(Symbol name);
+	/** How many symbols have been declared (one more than the
+	 * largest id) **/
+	size_t size() const { return mySymbols.size(); }
+
+private:
+	ScopeChain myScopes;
+	std::deque<SemSymbol> mySymbols;
+};
+
+} //End namespace cminusminus
+
+#endif
@@ -6,7 +6,7 @@ namespace cminusminus{
 using TokenKind = cminusminus::Parser::token;
 using Lexeme = cminusminus::Parser::semantic_type;
 
-static std::string tokenKindString(int tokKind){
+const char * tokenKindName(int tokKind){
 	switch(tokKind){
 		case TokenKind::AMP: return "AMP";
 		case TokenKind::AND: return "AND";
@@ -57,70 +57,78 @@ static std::string tokenKindString(int tokKind){
 	
 }
 
-Token::Token(Position * posIn, int kindIn)
+static std::string tokenKindString(int tokKind){
+	return tokenKindName(tokKind);
+}
+
+Token::Token(const Position& posIn, int kindIn)
   : myPos(posIn), myKind(kindIn){
 }
 
 std::string Token::toString(){
 	return tokenKindString(kind())
-	+ " " + myPos->begin();
+	+ " " + myPos.begin();
 }
 
 int Token::kind() const { 
 	return this->myKind; 
 }
 
-Position * Token::pos() const {
+const Position& Token::pos() const {
 	return myPos;
 }
 
-IDToken::IDToken(Position * posIn, std::string vIn)
-  : Token(posIn, TokenKind::ID), myValue(vIn){ 
+IDToken::IDToken(const Position& posIn, Symbol symIn)
+  : Token(posIn, TokenKind::ID), mySym(symIn){ 
 }
 
 std::string IDToken::toString(){
 	return tokenKindString(kind()) + ":"
-	+ myValue + " " + myPos->begin();
+	+ value() + " " + myPos.begin();
+}
+
+Symbol IDToken::sym() const {
+	return this->mySym;
 }
 
-const std::string IDToken::value() const { 
-	return this->myValue; 
+const std::string& IDToken::value() const { 
+	return this->mySym.str(); 
 }
 
-StrToken::StrToken(Position * posIn, std::string sIn)
+StrToken::StrToken(const Position& posIn, std::string sIn)
   : Token(posIn, TokenKind::STRLITERAL), myStr(sIn){
 }
 
 std::string StrToken::toString(){
 	return tokenKindString(kind()) + ":"
-	+ this->myStr + " " + myPos->begin();
+	+ this->myStr + " " + myPos.begin();
 }
 
-const std::string StrToken::str() const {
+const std::string& StrToken::str() const {
 	return this->myStr;
 }
 
-IntLitToken::IntLitToken(Position * pos, int numIn)
+IntLitToken::IntLitToken(const Position& pos, int numIn)
   : Token(pos, TokenKind::INTLITERAL), myNum(numIn){}
 
 
 std::string IntLitToken::toString(){
 	return tokenKindString(kind()) + ":"
 	+ std::to_string(this->myNum) + " "
-	+ myPos->begin();
+	+ myPos.begin();
 }
 
 int IntLitToken::num() const {
 	return this->myNum;
 }
 
-ShortLitToken::ShortLitToken(Position * pos, int numIn)
+ShortLitToken::ShortLitToken(const Position& pos, int numIn)
   : Token(pos, TokenKind::SHORTLITERAL), myNum(numIn){}
 
 std::string ShortLitToken::toString(){
 	return tokenKindString(kind()) + ":"
 	+ std::to_string(this->myNum) + " "
-	+ myPos->begin();
+	+ myPos.begin();
 }
 
 int ShortLitToken::num() const {
@@ -3,45 +3,51 @@
 
 #include <string>
 #include "position.hpp"
+#include "symbol.hpp"
 
 namespace cminusminus{
 
+/** The name of a token kind as printed by -t (e.g. "ID") **/
+const char * tokenKindName(int tokKind);
+
 class Token{
 public:
-	Token(Position * pos, int kindIn);
+	Token(const Position& pos, int kindIn);
+	virtual ~Token(){ }
 	virtual std::string toString();
 	size_t line() const;
 	size_t col() const;
 	int kind() const;
-	Position * pos() const;
+	const Position& pos() const;
 protected:
-	Position * myPos;
+	Position myPos;
 private:
 	const int myKind;
 };
 
 class IDToken : public Token{
 public:
-	IDToken(Position * posIn, std::string valIn);
-	const std::string value() const;
+	IDToken(const Position& posIn, Symbol symIn);
+	Symbol sym() const;
+	const std::string& value() const;
 	virtual std::string toString() override;
 private:
-	const std::string myValue;
-	
+	const Symbol mySym;
+
 };
 
 class StrToken : public Token{
 public:
-	StrToken(Position * posIn, std::string valIn);
+	StrToken(const Position& posIn, std::string valIn);
 	virtual std::string toString() override;
-	const std::string str() const;
+	const std::string& str() const;
 private:
 	const std::string myStr;
 };
 
 class IntLitToken : public Token{
 public:
-	IntLitToken(Position * posIn, int numIn);
+	IntLitToken(const Position& posIn, int numIn);
 	virtual std::string toString() override;
 	int num() const;
 private:
@@ -50,7 +56,7 @@ private:
 
 class ShortLitToken : public Token{
 public:
-	ShortLitToken(Position * posIn, int numIn);
+	ShortLitToken(const Position& posIn, int numIn);
 	virtual std::string toString() override;
 	int num() const;
 private:
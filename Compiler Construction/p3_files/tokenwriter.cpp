@@ -0,0 +1,89 @@
+#include "tokenwriter.hpp"
+#include "grammar.hh" // Get the TokenKind definitions
+
+namespace cminusminus{
+
+using TokenKind = cminusminus::Parser::token;
+
+/* Longest possible " [line,col]\n" or ":<int>" suffix */
+static const size_t MAX_NUM_CHARS = 24;
+
+TokenWriter::TokenWriter(std::ostream& outIn, size_t capacity)
+: myOut(outIn), myBuf(capacity), myLen(0){
+}
+
+void TokenWriter::flush(){
+	if (myLen > 0){
+		myOut.write(myBuf.data(), static_cast<std::streamsize>(myLen));
+		myLen = 0;
+	}
+	myOut.flush();
+}
+
+void TokenWriter::putNum(long long n){
+	char digits[MAX_NUM_CHARS];
+	size_t i = MAX_NUM_CHARS;
+	unsigned long long v = n < 0 
+	  ? 0ULL - static_cast<unsigned long long>(n)
+	  : static_cast<unsigned long long>(n);
+	do {
+		digits[--i] = static_cast<char>('0' + v % 10);
+		v /= 10;
+	} while (v != 0);
+	if (n < 0){ digits[--i] = '-'; }
+	put(digits + i, MAX_NUM_CHARS - i);
+}
+
+void TokenWriter::putPos(size_t line, size_t col){
+	put(" [", 2);
+	putNum(static_cast<long long>(line));
+	put(',');
+	putNum(static_cast<long long>(col));
+	put("]\n", 2);
+}
+
+void TokenWriter::write(const Token * tok){
+	const char * name = tokenKindName(tok->kind());
+	size_t nameLen = std::strlen(name);
+	const std::string * text = nullptr;
+	switch (tok->kind()){
+	case TokenKind::ID:
+		text = &static_cast<const IDToken *>(tok)->value();
+		break;
+	case TokenKind::STRLITERAL:
+		text = &static_cast<const StrToken *>(tok)->str();
+		break;
+	default:
+		break;
+	}
+	size_t textLen = text == nullptr ? 0 : text->size();
+	reserve(nameLen + textLen + 3 * MAX_NUM_CHARS);
+
+	put(name, nameLen);
+	switch (tok->kind()){
+	case TokenKind::ID:
+	case TokenKind::STRLITERAL:
+		put(':');
+		put(text->data(), textLen);
+		break;
+	case TokenKind::INTLITERAL:
+		put(':');
+		putNum(static_cast<const IntLitToken *>(tok)->num());
+		break;
+	case TokenKind::SHORTLITERAL:
+		put(':');
+		putNum(static_cast<const ShortLitToken *>(tok)->num());
+		break;
+	default:
+		break;
+	}
+	putPos(tok->pos().line(), tok->pos().col());
+}
+
+void TokenWriter::writeEOF(size_t line, size_t col){
+	reserve(3 + 2 * MAX_NUM_CHARS);
+	put("EOF", 3);
+	putPos(line, col);
+}
+
+} //End namespace cminusminus
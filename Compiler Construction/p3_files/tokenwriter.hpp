@@ -0,0 +1,52 @@
+#ifndef CMINUSMINUS_TOKENWRITER_HPP
+#define CMINUSMINUS_TOKENWRITER_HPP
+
+#include <cstring>
+#include <ostream>
+#include <vector>
+#include "tokens.hpp"
+
+namespace cminusminus{
+
+/**
+* \class TokenWriter
+* Formats tokens in the -t format straight into a large byte
+* buffer, without building std::string temporaries or calling
+* Token::toString, and hands the buffer to the output stream
+* only when it fills up (and once more on flush()).
+**/
+class TokenWriter{
+public:
+	TokenWriter(std::ostream& outIn, size_t capacity = 1 << 20);
+	~TokenWriter(){ flush(); }
+	TokenWriter(const TokenWriter&) = delete;
+	TokenWriter& operator=(const TokenWriter&) = delete;
+
+	void write(const Token * tok);
+	/** The "EOF [line,col]" record that ends a token stream **/
+	void writeEOF(size_t line, size_t col);
+	void flush();
+
+private:
+	void reserve(size_t n){
+		if (myLen + n > myBuf.size()){
+			flush();
+			if (n > myBuf.size()){ myBuf.resize(n); }
+		}
+	}
+	void put(char c){ myBuf[myLen++] = c; }
+	void put(const char * s, size_t n){
+		std::memcpy(&myBuf[myLen], s, n);
+		myLen += n;
+	}
+	void putNum(long long n);
+	void putPos(size_t line, size_t col);
+
+	std::ostream& myOut;
+	std::vector<char> myBuf;
+	size_t myLen;
+};
+
+} //End namespace cminusminus
+
+#endif
@@ -0,0 +1,145 @@
+#include <cstring>
+#include "tokstream.hpp"
+#include "grammar.hh" // Get the TokenKind definitions
+
+namespace cminusminus{
+
+using TokenKind = cminusminus::Parser::token;
+
+static const char MAGIC[4] = {'C', 'M', 'M', 'T'};
+static const size_t HEADER_BYTES = 4 + 4 * sizeof(uint32_t);
+
+static TokenRecord makeRecord(int kind, const Position& pos, int32_t value){
+	TokenRecord rec;
+	rec.kind = kind;
+	rec.line = static_cast<uint32_t>(pos.line());
+	rec.col = static_cast<uint32_t>(pos.col());
+	rec.endLine = static_cast<uint32_t>(pos.endLine());
+	rec.endCol = static_cast<uint32_t>(pos.endCol());
+	rec.value = value;
+	return rec;
+}
+
+int32_t BinaryTokenWriter::addString(const char * chars, size_t len){
+	if (myOffsets.empty()){ myOffsets.push_back(0); }
+	myStrings.append(chars, len);
+	myOffsets.push_back(static_cast<uint32_t>(myStrings.size()));
+	return static_cast<int32_t>(myOffsets.size() - 2);
+}
+
+void BinaryTokenWriter::write(const Token * tok){
+	int32_t value = 0;
+	switch (tok->kind()){
+	case TokenKind::ID: {
+		Symbol sym = static_cast<const IDToken *>(tok)->sym();
+		if (sym.id() >= mySymIndex.size()){
+			mySymIndex.resize(sym.id() + 1, 0);
+		}
+		if (mySymIndex[sym.id()] == 0){
+			const std::string& name = sym.str();
+			int32_t idx = addString(name.data(), name.size());
+			mySymIndex[sym.id()] = static_cast<uint32_t>(idx) + 1;
+		}
+		value = static_cast<int32_t>(mySymIndex[sym.id()] - 1);
+		break;
+	}
+	case TokenKind::STRLITERAL: {
+		const std::string& s = static_cast<const StrToken *>(tok)->str();
+		value = addString(s.data(), s.size());
+		break;
+	}
+	case TokenKind::INTLITERAL:
+		value = static_cast<const IntLitToken *>(tok)->num();
+		break;
+	case TokenKind::SHORTLITERAL:
+		value = static_cast<const ShortLitToken *>(tok)->num();
+		break;
+	default:
+		break;
+	}
+	myRecords.push_back(makeRecord(tok->kind(), tok->pos(), value));
+}
+
+void BinaryTokenWriter::writeEOF(size_t line, size_t col){
+	myRecords.push_back(makeRecord(TokenKind::END,
+		Position(line, col, line, col), 0));
+}
+
+void BinaryTokenWriter::finish(){
+	if (myDone){ return; }
+	myDone = true;
+	if (myOffsets.empty()){ myOffsets.push_back(0); }
+	uint32_t header[4] = {
+		TOKSTREAM_VERSION,
+		static_cast<uint32_t>(myRecords.size()),
+		static_cast<uint32_t>(myOffsets.size() - 1),
+		static_cast<uint32_t>(myStrings.size())
+	};
+	myOut.write(MAGIC, sizeof(MAGIC));
+	myOut.write(reinterpret_cast<const char *>(header), sizeof(header));
+	myOut.write(reinterpret_cast<const char *>(myRecords.data()),
+		static_cast<std::streamsize>(myRecords.size() * sizeof(TokenRecord)));
+	myOut.write(reinterpret_cast<const char *>(myOffsets.data()),
+		static_cast<std::streamsize>(myOffsets.size() * sizeof(uint32_t)));
+	myOut.write(myStrings.data(),
+		static_cast<std::streamsize>(myStrings.size()));
+	myOut.flush();
+}
+
+bool BinaryTokenReader::isTokenStream(const SourceFile * src){
+	return src->size() >= sizeof(MAGIC)
+	  && std::memcmp(src->data(), MAGIC, sizeof(MAGIC)) == 0;
+}
+
+BinaryTokenReader * BinaryTokenReader::open(const SourceFile * src){
+	if (!isTokenStream(src) || src->size() < HEADER_BYTES){
+		return nullptr;
+	}
+	uint32_t header[4];
+	std::memcpy(header, src->data() + sizeof(MAGIC), sizeof(header));
+	if (header[0] != TOKSTREAM_VERSION){ return nullptr; }
+	size_t numRecords = header[1];
+	size_t numStrings = header[2];
+	size_t stringBytes = header[3];
+	size_t need = HEADER_BYTES
+	  + numRecords * sizeof(TokenRecord)
+	  + (numStrings + 1) * sizeof(uint32_t)
+	  + stringBytes;
+	if (numRecords == 0 || need != src->size()){ return nullptr; }
+
+	BinaryTokenReader * reader = new BinaryTokenReader();
+	const char * cur = src->data() + HEADER_BYTES;
+	reader->myRecords = reinterpret_cast<const TokenRecord *>(cur);
+	reader->myNumRecords = numRecords;
+	cur += numRecords * sizeof(TokenRecord);
+	reader->myOffsets = reinterpret_cast<const uint32_t *>(cur);
+	reader->myNumStrings = numStrings;
+	cur += (numStrings + 1) * sizeof(uint32_t);
+	reader->myStrings = cur;
+
+	//Validate once up front so replay never reads out of bounds
+	bool ok = reader->myOffsets[0] == 0
+	  && reader->myOffsets[numStrings] == stringBytes
+	  && reader->myRecords[numRecords - 1].kind == TokenKind::END;
+	for (size_t i = 0; ok && i < numStrings; i++){
+		ok = reader->myOffsets[i] <= reader->myOffsets[i + 1];
+	}
+	for (size_t i = 0; ok && i < numRecords; i++){
+		int kind = reader->myRecords[i].kind;
+		if (kind == TokenKind::ID || kind == TokenKind::STRLITERAL){
+			int32_t idx = reader->myRecords[i].value;
+			ok = idx >= 0 && static_cast<size_t>(idx) < numStrings;
+		}
+	}
+	if (!ok){
+		delete reader;
+		return nullptr;
+	}
+	return reader;
+}
+
+std::string BinaryTokenReader::str(int32_t idx) const{
+	return std::string(strChars(idx), strLen(idx));
+}
+
+} //End namespace cminusminus
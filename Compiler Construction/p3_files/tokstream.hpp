@@ -0,0 +1,99 @@
+#ifndef CMINUSMINUS_TOKSTREAM_HPP
+#define CMINUSMINUS_TOKSTREAM_HPP
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "tokens.hpp"
+#include "source.hpp"
+
+namespace cminusminus{
+
+/*
+Binary token stream (-T) layout, all fields little-endian:
+
+   char     magic[4]          "CMMT"
+   uint32   version           TOKSTREAM_VERSION
+   uint32   numRecords
+   uint32   numStrings
+   uint32   stringBytes
+   TokenRecord records[numRecords]   (the last one is END/EOF)
+   uint32   stringOffsets[numStrings + 1]
+   char     strings[stringBytes]
+
+A record's value is the literal for INTLITERAL/SHORTLITERAL and
+an index into the string table for ID/STRLITERAL. Identifiers
+with the same spelling share one string table entry.
+*/
+static const uint32_t TOKSTREAM_VERSION = 1;
+
+struct TokenRecord{
+	int32_t kind;
+	uint32_t line;
+	uint32_t col;
+	uint32_t endLine;
+	uint32_t endCol;
+	int32_t value;
+};
+
+/**
+* \class BinaryTokenWriter
+* Collects tokens as fixed-width TokenRecords and writes the
+* complete stream (header, records, string table) on finish().
+**/
+class BinaryTokenWriter{
+public:
+	BinaryTokenWriter(std::ostream& outIn) : myOut(outIn), myDone(false){ }
+	~BinaryTokenWriter(){ finish(); }
+	BinaryTokenWriter(const BinaryTokenWriter&) = delete;
+	BinaryTokenWriter& operator=(const BinaryTokenWriter&) = delete;
+
+	void write(const Token * tok);
+	void writeEOF(size_t line, size_t col);
+	void finish();
+private:
+	int32_t addString(const char * chars, size_t len);
+
+	std::ostream& myOut;
+	bool myDone;
+	std::vector<TokenRecord> myRecords;
+	std::vector<uint32_t> myOffsets;
+	std::string myStrings;
+	/* String table index + 1 for each Symbol id seen so far */
+	std::vector<uint32_t> mySymIndex;
+};
+
+/**
+* \class BinaryTokenReader
+* Read-only view of a binary token stream held in a SourceFile.
+* Records and strings are used in place; nothing is copied.
+**/
+class BinaryTokenReader{
+public:
+	/** True if src starts with the token stream magic **/
+	static bool isTokenStream(const SourceFile * src);
+	/** Returns nullptr if src is not a well-formed stream **/
+	static BinaryTokenReader * open(const SourceFile * src);
+
+	size_t size() const { return myNumRecords; }
+	const TokenRecord& record(size_t i) const { return myRecords[i]; }
+	std::string str(int32_t idx) const;
+	const char * strChars(int32_t idx) const {
+		return myStrings + myOffsets[idx];
+	}
+	size_t strLen(int32_t idx) const {
+		return myOffsets[idx + 1] - myOffsets[idx];
+	}
+private:
+	BinaryTokenReader(){ }
+	const TokenRecord * myRecords;
+	size_t myNumRecords;
+	const uint32_t * myOffsets;
+	size_t myNumStrings;
+	const char * myStrings;
+};
+
+} //End namespace cminusminus
+
+#endif
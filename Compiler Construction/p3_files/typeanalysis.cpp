@@ -0,0 +1,329 @@
+#include "ast.hpp"
+#include "errors.hpp"
+#include "symtable.hpp"
+#include "types.hpp"
+
+namespace cminusminus{
+
+/*
+Type analysis runs after name analysis has linked every IDNode
+to its SemSymbol. Each expression works out its type from its
+children's and keeps it (ExpNode::getDataType) for the passes
+after this one. An expression with a type error in it has the
+ERROR type, and nothing around it reports a second error about
+it, so each mistake in the program is reported once.
+*/
+
+void TypeAnalysis::error(const Position& pos, const char * msg){
+	Report::fatal(pos, msg);
+	myOk = false;
+}
+
+static const DataType * prim(DataType::Kind kind){
+	return DataType::prim(kind);
+}
+
+const DataType * IntTypeNode::getDataType() const{
+	return prim(DataType::INT);
+}
+
+const DataType * BoolTypeNode::getDataType() const{
+	return prim(DataType::BOOL);
+}
+
+const DataType * ShortTypeNode::getDataType() const{
+	return prim(DataType::SHORT);
+}
+
+const DataType * StringTypeNode::getDataType() const{
+	return prim(DataType::STRING);
+}
+
+const DataType * VoidTypeNode::getDataType() const{
+	return prim(DataType::VOID);
+}
+
+const DataType * PtrTypeNode::getDataType() const{
+	return DataType::ptr(myBase->getDataType());
+}
+
+template <typename T>
+static void analyzeList(NodeList<T> * nodes, TypeAnalysis * ta){
+	for (auto node : *nodes){
+		node->typeAnalysis(ta);
+	}
+}
+
+void ProgramNode::typeAnalysis(TypeAnalysis * ta){
+	analyzeList(myGlobals, ta);
+}
+
+void FnDeclNode::typeAnalysis(TypeAnalysis * ta){
+	ta->setReturnType(myRetType->getDataType());
+	analyzeList(myBody, ta);
+	ta->setReturnType(nullptr);
+}
+
+void IDNode::typeAnalysis(TypeAnalysis * ta){
+	myDataType = mySymbol->getDataType();
+}
+
+void DerefNode::typeAnalysis(TypeAnalysis * ta){
+	myId->typeAnalysis(ta);
+	const DataType * type = myId->getDataType();
+	if (type->isPtr()){
+		myDataType = type->getBase();
+		return;
+	}
+	ta->error(myId->pos(), "Invalid dereference operand");
+	myDataType = prim(DataType::ERROR);
+}
+
+void RefNode::typeAnalysis(TypeAnalysis * ta){
+	myId->typeAnalysis(ta);
+	const DataType * type = myId->getDataType();
+	if (type->isFn()){
+		ta->error(myId->pos(), "Invalid ref operand");
+		myDataType = prim(DataType::ERROR);
+		return;
+	}
+	myDataType = DataType::ptr(type);
+}
+
+void IntLitNode::typeAnalysis(TypeAnalysis * ta){
+	myDataType = prim(DataType::INT);
+}
+
+void ShortLitNode::typeAnalysis(TypeAnalysis * ta){
+	myDataType = prim(DataType::SHORT);
+}
+
+void StrLitNode::typeAnalysis(TypeAnalysis * ta){
+	myDataType = prim(DataType::STRING);
+}
+
+void TrueNode::typeAnalysis(TypeAnalysis * ta){
+	myDataType = prim(DataType::BOOL);
+}
+
+void FalseNode::typeAnalysis(TypeAnalysis * ta){
+	myDataType = prim(DataType::BOOL);
+}
+
+/* Functions and void are not values, so they cannot be stored,
+   compared or operated on */
+static bool isValue(const DataType * type){
+	return !type->isFn() && !type->isVoid();
+}
+
+void AssignExpNode::typeAnalysis(TypeAnalysis * ta){
+	myDst->typeAnalysis(ta);
+	mySrc->typeAnalysis(ta);
+	const DataType * dst = myDst->getDataType();
+	const DataType * src = mySrc->getDataType();
+	bool ok = true;
+	if (!isValue(dst)){
+		ta->error(myDst->pos(), "Invalid assignment operand");
+		ok = false;
+	}
+	if (!isValue(src)){
+		ta->error(mySrc->pos(), "Invalid assignment operand");
+		ok = false;
+	}
+	if (!ok || dst->isError() || src->isError()){
+		myDataType = prim(DataType::ERROR);
+		return;
+	}
+	if (!src->assignableTo(dst)){
+		ta->error(pos(), "Invalid assignment operation");
+		myDataType = prim(DataType::ERROR);
+		return;
+	}
+	myDataType = dst;
+}
+
+void CallExpNode::typeAnalysis(TypeAnalysis * ta){
+	myId->typeAnalysis(ta);
+	analyzeList(myArgs, ta);
+	const DataType * callee = myId->getDataType();
+	if (!callee->isFn()){
+		ta->error(myId->pos(), "Attempt to call a non-function");
+		myDataType = prim(DataType::ERROR);
+		return;
+	}
+	myDataType = callee->getBase();
+	const auto& formals = callee->getFormals();
+	if (formals.size() != myArgs->size()){
+		ta->error(myId->pos(), "Function call with wrong number of args");
+		return;
+	}
+	for (size_t i = 0; i < formals.size(); i++){
+		const DataType * actual = (*myArgs)[i]->getDataType();
+		if (!actual->isError() && !actual->assignableTo(formals[i])){
+			ta->error((*myArgs)[i]->pos(),
+				"Type of actual does not match type of formal");
+		}
+	}
+}
+
+/* The message for an operand of the wrong type, by operator */
+static const char * operandError(AstKind kind){
+	switch (kind){
+	case AST_AND: case AST_OR:
+		return "Logical operator applied to non-bool operand";
+	case AST_LESS: case AST_LESSEQ: case AST_GREATER: case AST_GREATEREQ:
+		return "Relational operator applied to non-numeric operand";
+	case AST_EQUALS: case AST_NOTEQUALS:
+		return "Invalid equality operand";
+	default:
+		return "Arithmetic operator applied to invalid operand";
+	}
+}
+
+void BinaryExpNode::typeAnalysis(TypeAnalysis * ta){
+	myLhs->typeAnalysis(ta);
+	myRhs->typeAnalysis(ta);
+	const DataType * lhs = myLhs->getDataType();
+	const DataType * rhs = myRhs->getDataType();
+	AstKind kind = imageKind();
+	bool logical = kind == AST_AND || kind == AST_OR;
+	bool equality = kind == AST_EQUALS || kind == AST_NOTEQUALS;
+
+	auto operandOk = [&](const DataType * type){
+		if (type->isError()){ return true; }
+		if (logical){ return type->isBool(); }
+		if (equality){ return isValue(type); }
+		return type->isNumeric();
+	};
+	bool ok = true;
+	if (!operandOk(lhs)){
+		ta->error(myLhs->pos(), operandError(kind));
+		ok = false;
+	}
+	if (!operandOk(rhs)){
+		ta->error(myRhs->pos(), operandError(kind));
+		ok = false;
+	}
+	if (!ok || lhs->isError() || rhs->isError()){
+		myDataType = prim(DataType::ERROR);
+		return;
+	}
+	if (equality && lhs != rhs && !(lhs->isNumeric() && rhs->isNumeric())){
+		ta->error(pos(), "Invalid equality operation");
+		myDataType = prim(DataType::ERROR);
+		return;
+	}
+	switch (kind){
+	case AST_PLUS: case AST_MINUS: case AST_TIMES: case AST_DIVIDE:
+		//A short only stays one if both sides are
+		myDataType = lhs == rhs ? lhs : prim(DataType::INT);
+		break;
+	default:
+		myDataType = prim(DataType::BOOL);
+	}
+}
+
+void UnaryExpNode::typeAnalysis(TypeAnalysis * ta){
+	myExp->typeAnalysis(ta);
+	const DataType * type = myExp->getDataType();
+	bool isNot = imageKind() == AST_NOT;
+	if (type->isError()){
+		myDataType = type;
+	} else if (isNot ? type->isBool() : type->isNumeric()){
+		myDataType = type;
+	} else {
+		ta->error(myExp->pos(), isNot
+			? "Logical operator applied to non-bool operand"
+			: "Arithmetic operator applied to invalid operand");
+		myDataType = prim(DataType::ERROR);
+	}
+}
+
+void AssignStmtNode::typeAnalysis(TypeAnalysis * ta){
+	myExp->typeAnalysis(ta);
+}
+
+static void checkIncDec(LValNode * lval, TypeAnalysis * ta){
+	lval->typeAnalysis(ta);
+	const DataType * type = lval->getDataType();
+	if (!type->isError() && !type->isNumeric()){
+		ta->error(lval->pos(), "Arithmetic operator applied to invalid operand");
+	}
+}
+
+void PostIncStmtNode::typeAnalysis(TypeAnalysis * ta){
+	checkIncDec(myLVal, ta);
+}
+
+void PostDecStmtNode::typeAnalysis(TypeAnalysis * ta){
+	checkIncDec(myLVal, ta);
+}
+
+void ReadStmtNode::typeAnalysis(TypeAnalysis * ta){
+	myDst->typeAnalysis(ta);
+	const DataType * type = myDst->getDataType();
+	if (type->isFn()){
+		ta->error(myDst->pos(), "Attempt to assign user input to function");
+	} else if (type->isPtr()){
+		ta->error(myDst->pos(), "Attempt to read a raw pointer");
+	}
+}
+
+void WriteStmtNode::typeAnalysis(TypeAnalysis * ta){
+	mySrc->typeAnalysis(ta);
+	const DataType * type = mySrc->getDataType();
+	if (type->isFn()){
+		ta->error(mySrc->pos(), "Attempt to output a function");
+	} else if (type->isVoid()){
+		ta->error(mySrc->pos(), "Attempt to output void");
+	} else if (type->isPtr()){
+		ta->error(mySrc->pos(), "Attempt to output a raw pointer");
+	}
+}
+
+static void checkCond(ExpNode * cond, TypeAnalysis * ta, const char * msg){
+	cond->typeAnalysis(ta);
+	const DataType * type = cond->getDataType();
+	if (!type->isError() && !type->isBool()){
+		ta->error(cond->pos(), msg);
+	}
+}
+
+void WhileStmtNode::typeAnalysis(TypeAnalysis * ta){
+	checkCond(myCond, ta, "Non-bool expression used as a while condition");
+	analyzeList(myBody, ta);
+}
+
+void IfStmtNode::typeAnalysis(TypeAnalysis * ta){
+	checkCond(myCond, ta, "Non-bool expression used as an if condition");
+	analyzeList(myBody, ta);
+}
+
+void IfElseStmtNode::typeAnalysis(TypeAnalysis * ta){
+	checkCond(myCond, ta, "Non-bool expression used as an if condition");
+	analyzeList(myBodyTrue, ta);
+	analyzeList(myBodyFalse, ta);
+}
+
+void ReturnStmtNode::typeAnalysis(TypeAnalysis * ta){
+	const DataType * ret = ta->getReturnType();
+	if (myExp == nullptr){
+		if (!ret->isVoid()){
+			ta->error(pos(), "Missing return value");
+		}
+		return;
+	}
+	myExp->typeAnalysis(ta);
+	const DataType * type = myExp->getDataType();
+	if (ret->isVoid()){
+		ta->error(myExp->pos(), "Return with a value in void function");
+	} else if (!type->isError() && !type->assignableTo(ret)){
+		ta->error(myExp->pos(), "Bad return value");
+	}
+}
+
+void CallStmtNode::typeAnalysis(TypeAnalysis * ta){
+	myCall->typeAnalysis(ta);
+}
+
+} // End namespace cminusminus
@@ -0,0 +1,126 @@
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include "types.hpp"
+
+namespace cminusminus{
+
+static const char * const PRIM_NAMES[] = {
+	"ERROR", "void", "bool", "short", "int", "string"
+};
+
+DataType::DataType(Kind kindIn, const DataType * baseIn,
+  const std::vector<const DataType *>& formalsIn)
+: myKind(kindIn), myBase(baseIn), myFormals(formalsIn){
+	if (myKind == PTR){
+		myString = "ptr " + myBase->myString;
+	} else if (myKind == FN){
+		for (size_t i = 0; i < myFormals.size(); i++){
+			if (i > 0){ myString += ","; }
+			myString += myFormals[i]->myString;
+		}
+		myString += "->" + myBase->myString;
+	} else {
+		myString = PRIM_NAMES[myKind];
+	}
+}
+
+/**
+* \class TypeTable
+* Every pointer and function type made so far, in an
+* open-addressed table keyed by a hash of the type's parts
+* (which are themselves interned, so they hash and compare by
+* pointer). The types with no parts are made up front.
+**/
+class TypeTable{
+public:
+	static TypeTable& global(){
+		static TypeTable theTable;
+		return theTable;
+	}
+
+	const DataType * prim(DataType::Kind kind) const {
+		return myPrims[kind].get();
+	}
+
+	const DataType * intern(DataType::Kind kind, const DataType * base,
+	  const std::vector<const DataType *>& formals){
+		size_t h = hash(kind, base, formals);
+		std::lock_guard<std::mutex> lock(myLock);
+		size_t mask = mySlots.size() - 1;
+		size_t idx = h & mask;
+		while (mySlots[idx] != nullptr){
+			const DataType * type = mySlots[idx];
+			if (type->myKind == kind && type->myBase == base
+			  && type->myFormals == formals){
+				return type;
+			}
+			idx = (idx + 1) & mask;
+		}
+		myTypes.emplace_back(new DataType(kind, base, formals));
+		const DataType * type = myTypes.back().get();
+		mySlots[idx] = type;
+		//Keep the load factor under 1/2
+		if (myTypes.size() * 2 > mySlots.size()){ grow(); }
+		return type;
+	}
+
+private:
+	TypeTable() : mySlots(256, nullptr){
+		std::vector<const DataType *> none;
+		for (int k = DataType::ERROR; k <= DataType::STRING; k++){
+			myPrims[k].reset(new DataType(static_cast<DataType::Kind>(k),
+				nullptr, none));
+		}
+	}
+
+	static size_t hash(DataType::Kind kind, const DataType * base,
+	  const std::vector<const DataType *>& formals){
+		//FNV-1a over the kind and the part pointers
+		size_t h = 14695981039346656037ull;
+		auto mix = [&h](size_t v){
+			h ^= v;
+			h *= 1099511628211ull;
+		};
+		mix(static_cast<size_t>(kind));
+		mix(reinterpret_cast<uintptr_t>(base));
+		for (auto formal : formals){ mix(reinterpret_cast<uintptr_t>(formal)); }
+		//The low bits of a pointer are all alike
+		return h ^ (h >> 29);
+	}
+
+	void grow(){
+		std::vector<const DataType *> old;
+		old.swap(mySlots);
+		mySlots.assign(old.size() * 2, nullptr);
+		size_t mask = mySlots.size() - 1;
+		for (auto type : old){
+			if (type == nullptr){ continue; }
+			size_t idx = hash(type->myKind, type->myBase, type->myFormals)
+			  & mask;
+			while (mySlots[idx] != nullptr){ idx = (idx + 1) & mask; }
+			mySlots[idx] = type;
+		}
+	}
+
+	std::unique_ptr<DataType> myPrims[DataType::STRING + 1];
+	std::mutex myLock;
+	std::vector<std::unique_ptr<DataType>> myTypes;
+	std::vector<const DataType *> mySlots;
+};
+
+const DataType * DataType::prim(Kind kind){
+	return TypeTable::global().prim(kind);
+}
+
+const DataType * DataType::ptr(const DataType * base){
+	static const std::vector<const DataType *> none;
+	return TypeTable::global().intern(PTR, base, none);
+}
+
+const DataType * DataType::fn(const std::vector<const DataType *>& formals,
+  const DataType * ret){
+	return TypeTable::global().intern(FN, ret, formals);
+}
+
+} //End namespace cminusminus
@@ -0,0 +1,93 @@
+#ifndef CMINUSMINUS_TYPES_HPP
+#define CMINUSMINUS_TYPES_HPP
+
+#include <string>
+#include <vector>
+#include "position.hpp"
+
+namespace cminusminus{
+
+/**
+* \class DataType
+* The type of a C-- value or function. Types are hash-consed:
+* there is exactly one DataType for each distinct type, made the
+* first time that type is asked for and kept for the life of the
+* process, so two types are the same exactly when their pointers
+* are equal. They are made only through prim(), ptr() and fn(),
+* which may be called from several threads.
+**/
+class DataType{
+public:
+	/* ERROR is the type of an expression that already has a
+	   type error reported in it, so the error is not reported
+	   again by everything around it */
+	enum Kind { ERROR, VOID, BOOL, SHORT, INT, STRING, PTR, FN };
+
+	/** The type of kind, for the kinds with no parts **/
+	static const DataType * prim(Kind kind);
+	/** ptr base **/
+	static const DataType * ptr(const DataType * base);
+	/** A function taking formals and returning ret **/
+	static const DataType * fn(const std::vector<const DataType *>& formals,
+	  const DataType * ret);
+
+	Kind getKind() const { return myKind; }
+	bool isError() const { return myKind == ERROR; }
+	bool isVoid() const { return myKind == VOID; }
+	bool isBool() const { return myKind == BOOL; }
+	/** int or short **/
+	bool isNumeric() const { return myKind == SHORT || myKind == INT; }
+	bool isPtr() const { return myKind == PTR; }
+	bool isFn() const { return myKind == FN; }
+
+	/** What a ptr points to, or what a function returns **/
+	const DataType * getBase() const { return myBase; }
+	/** A function's formal types **/
+	const std::vector<const DataType *>& getFormals() const {
+		return myFormals;
+	}
+	/** The type as C-- writes it ("ptr int"), or a function's
+	 * as "int,bool->void" **/
+	const std::string& getString() const { return myString; }
+
+	/** Whether a value of this type can be stored in a place of
+	 * type dst: the same type, or a short into an int **/
+	bool assignableTo(const DataType * dst) const {
+		return this == dst || (myKind == SHORT && dst->myKind == INT);
+	}
+
+	DataType(const DataType&) = delete;
+	DataType& operator=(const DataType&) = delete;
+
+private:
+	friend class TypeTable;
+	DataType(Kind kindIn, const DataType * baseIn,
+	  const std::vector<const DataType *>& formalsIn);
+
+	Kind myKind;
+	const DataType * myBase;
+	std::vector<const DataType *> myFormals;
+	std::string myString;
+};
+
+/**
+* \class TypeAnalysis
+* The state of type analysis: the return type of the function
+* being checked, and whether any error has been reported.
+**/
+class TypeAnalysis{
+public:
+	TypeAnalysis() : myRetType(nullptr), myOk(true){ }
+	/** Report msg at pos; the analysis has now failed **/
+	void error(const Position& pos, const char * msg);
+	bool passed() const { return myOk; }
+	void setReturnType(const DataType * t){ myRetType = t; }
+	const DataType * getReturnType() const { return myRetType; }
+private:
+	const DataType * myRetType;
+	bool myOk;
+};
+
+} //End namespace cminusminus
+
+#endif
@@ -1,4 +1,5 @@
 #include "ast.hpp"
+#include "symtable.hpp"
 
 namespace cminusminus{
 
@@ -6,8 +7,8 @@ namespace cminusminus{
 doIndent is declared static, which means that it can 
 only be called in this file (its symbol is not exported).
 */
-static void doIndent(std::ostream& out, int indent){
-	for (int k = 0 ; k < indent; k++){ out << "\t"; }
+static void doIndent(UnparseWriter& out, int indent){
+	out.indent(indent);
 }
 
 /*
@@ -22,7 +23,7 @@ of DeclNodes.
 */
 
 
-void ProgramNode::unparse(std::ostream& out, int indent){
+void ProgramNode::unparse(UnparseWriter& out, int indent){
 	/* Oh, hey it's a for-each loop in C++!
 	   The loop iterates over each element in a collection
 	   without that gross i++ nonsense. 
@@ -40,7 +41,7 @@ void ProgramNode::unparse(std::ostream& out, int indent){
 	}
 }
 
-void VarDeclNode::unparse(std::ostream& out, int indent){
+void VarDeclNode::unparse(UnparseWriter& out, int indent){
 	doIndent(out, indent);
 	this->myType->unparse(out, 0);
 	out << " ";
@@ -48,12 +49,230 @@ void VarDeclNode::unparse(std::ostream& out, int indent){
 	out << ";\n";
 }
 
-void IDNode::unparse(std::ostream& out, int indent){
-	out << this->name;
+/*
+After name analysis (-n) each name is followed by the type of
+its declaration, e.g. "a(int)" or "f(int,bool->void)"
+*/
+void IDNode::unparse(UnparseWriter& out, int indent){
+	out << this->name.str();
+	if (mySymbol != nullptr){
+		out << "(";
+		mySymbol->unparseType(out);
+		out << ")";
+	}
 }
 
-void IntTypeNode::unparse(std::ostream& out, int indent){
+void IntTypeNode::unparse(UnparseWriter& out, int indent){
 	out << "int";
 }
 
+void BoolTypeNode::unparse(UnparseWriter& out, int indent){
+	out << "bool";
+}
+
+void ShortTypeNode::unparse(UnparseWriter& out, int indent){
+	out << "short";
+}
+
+void StringTypeNode::unparse(UnparseWriter& out, int indent){
+	out << "string";
+}
+
+void VoidTypeNode::unparse(UnparseWriter& out, int indent){
+	out << "void";
+}
+
+void PtrTypeNode::unparse(UnparseWriter& out, int indent){
+	out << "ptr ";
+	myBase->unparse(out, 0);
+}
+
+/*
+A block is the body of a function, loop or if. The closing
+curly brace lines up with the statement that owns the block.
+*/
+static void unparseBlock(UnparseWriter& out, int indent,
+  NodeList<StmtNode> * stmts){
+	out << "{\n";
+	for (auto stmt : *stmts){
+		stmt->unparse(out, indent + 1);
+	}
+	doIndent(out, indent);
+	out << "}";
+}
+
+void FnDeclNode::unparse(UnparseWriter& out, int indent){
+	doIndent(out, indent);
+	myRetType->unparse(out, 0);
+	out << " ";
+	myId->unparse(out, 0);
+	out << "(";
+	bool firstFormal = true;
+	for (auto formal : *myFormals){
+		if (firstFormal){ firstFormal = false; }
+		else { out << ", "; }
+		formal->unparse(out, 0);
+	}
+	out << ")";
+	unparseBlock(out, indent, myBody);
+	out << "\n";
+}
+
+void FormalDeclNode::unparse(UnparseWriter& out, int indent){
+	myType->unparse(out, 0);
+	out << " ";
+	myId->unparse(out, 0);
+}
+
+void DerefNode::unparse(UnparseWriter& out, int indent){
+	out << "@";
+	myId->unparse(out, 0);
+}
+
+void RefNode::unparse(UnparseWriter& out, int indent){
+	out << "&";
+	myId->unparse(out, 0);
+}
+
+void IntLitNode::unparse(UnparseWriter& out, int indent){
+	out << myNum;
+}
+
+void ShortLitNode::unparse(UnparseWriter& out, int indent){
+	out << myNum << "S";
+}
+
+void StrLitNode::unparse(UnparseWriter& out, int indent){
+	out << *myStr;
+}
+
+void TrueNode::unparse(UnparseWriter& out, int indent){
+	out << "true";
+}
+
+void FalseNode::unparse(UnparseWriter& out, int indent){
+	out << "false";
+}
+
+/*
+Every compound expression is printed inside its own parentheses,
+so the output never depends on operator precedence and parses 
+back to the same tree.
+*/
+
+void AssignExpNode::unparse(UnparseWriter& out, int indent){
+	out << "(";
+	unparseBare(out);
+	out << ")";
+}
+
+void AssignExpNode::unparseBare(UnparseWriter& out){
+	myDst->unparse(out, 0);
+	out << " = ";
+	mySrc->unparse(out, 0);
+}
+
+void CallExpNode::unparse(UnparseWriter& out, int indent){
+	myId->unparse(out, 0);
+	out << "(";
+	bool firstArg = true;
+	for (auto arg : *myArgs){
+		if (firstArg){ firstArg = false; }
+		else { out << ", "; }
+		arg->unparse(out, 0);
+	}
+	out << ")";
+}
+
+void BinaryExpNode::unparse(UnparseWriter& out, int indent){
+	out << "(";
+	myLhs->unparse(out, 0);
+	out << " " << opStr() << " ";
+	myRhs->unparse(out, 0);
+	out << ")";
+}
+
+void UnaryExpNode::unparse(UnparseWriter& out, int indent){
+	out << "(" << opStr();
+	myExp->unparse(out, 0);
+	out << ")";
+}
+
+void AssignStmtNode::unparse(UnparseWriter& out, int indent){
+	doIndent(out, indent);
+	myExp->unparseBare(out);
+	out << ";\n";
+}
+
+void PostIncStmtNode::unparse(UnparseWriter& out, int indent){
+	doIndent(out, indent);
+	myLVal->unparse(out, 0);
+	out << "++;\n";
+}
+
+void PostDecStmtNode::unparse(UnparseWriter& out, int indent){
+	doIndent(out, indent);
+	myLVal->unparse(out, 0);
+	out << "--;\n";
+}
+
+void ReadStmtNode::unparse(UnparseWriter& out, int indent){
+	doIndent(out, indent);
+	out << "read ";
+	myDst->unparse(out, 0);
+	out << ";\n";
+}
+
+void WriteStmtNode::unparse(UnparseWriter& out, int indent){
+	doIndent(out, indent);
+	out << "write ";
+	mySrc->unparse(out, 0);
+	out << ";\n";
+}
+
+void WhileStmtNode::unparse(UnparseWriter& out, int indent){
+	doIndent(out, indent);
+	out << "while (";
+	myCond->unparse(out, 0);
+	out << ")";
+	unparseBlock(out, indent, myBody);
+	out << "\n";
+}
+
+void IfStmtNode::unparse(UnparseWriter& out, int indent){
+	doIndent(out, indent);
+	out << "if (";
+	myCond->unparse(out, 0);
+	out << ")";
+	unparseBlock(out, indent, myBody);
+	out << "\n";
+}
+
+void IfElseStmtNode::unparse(UnparseWriter& out, int indent){
+	doIndent(out, indent);
+	out << "if (";
+	myCond->unparse(out, 0);
+	out << ")";
+	unparseBlock(out, indent, myBodyTrue);
+	out << " else ";
+	unparseBlock(out, indent, myBodyFalse);
+	out << "\n";
+}
+
+void ReturnStmtNode::unparse(UnparseWriter& out, int indent){
+	doIndent(out, indent);
+	out << "return";
+	if (myExp != nullptr){
+		out << " ";
+		myExp->unparse(out, 0);
+	}
+	out << ";\n";
+}
+
+void CallStmtNode::unparse(UnparseWriter& out, int indent){
+	doIndent(out, indent);
+	myCall->unparse(out, 0);
+	out << ";\n";
+}
+
 } // End namespace cminusminus
@@ -0,0 +1,81 @@
+#include <unistd.h>
+#include <cerrno>
+#include "unparsewriter.hpp"
+
+namespace cminusminus{
+
+/* Indentation is copied out of here, this many levels at a time */
+static const char TABS[] = "\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t"
+	"\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t";
+static const size_t NUM_TABS = sizeof(TABS) - 1;
+
+/* Longest int, with its sign */
+static const size_t MAX_INT_CHARS = 12;
+
+UnparseWriter::UnparseWriter(int fdIn, size_t capacity)
+: myFd(fdIn), myOut(nullptr), myBuf(capacity), myLen(0), myFailed(false){
+}
+
+UnparseWriter::UnparseWriter(std::ostream& outIn, size_t capacity)
+: myFd(-1), myOut(&outIn), myBuf(capacity), myLen(0), myFailed(false){
+}
+
+UnparseWriter::~UnparseWriter(){
+	flush();
+}
+
+bool UnparseWriter::flush(){
+	const char * data = myBuf.data();
+	size_t left = myLen;
+	myLen = 0;
+	if (myOut != nullptr){
+		myOut->write(data, static_cast<std::streamsize>(left));
+		myOut->flush();
+		myFailed = myFailed || !myOut->good();
+		return !myFailed;
+	}
+	while (left > 0 && !myFailed){
+		ssize_t put = ::write(myFd, data, left);
+		if (put < 0 && errno == EINTR){ continue; }
+		if (put <= 0){
+			myFailed = true;
+			break;
+		}
+		data += put;
+		left -= static_cast<size_t>(put);
+	}
+	return !myFailed;
+}
+
+void UnparseWriter::grow(size_t n){
+	flush();
+	//A piece bigger than the whole buffer (a huge string
+	// literal, say) gets a buffer of its own size
+	if (n > myBuf.size()){ myBuf.resize(n); }
+}
+
+UnparseWriter& UnparseWriter::operator<<(int n){
+	char digits[MAX_INT_CHARS];
+	size_t i = MAX_INT_CHARS;
+	unsigned int v = n < 0
+	  ? 0U - static_cast<unsigned int>(n)
+	  : static_cast<unsigned int>(n);
+	do {
+		digits[--i] = static_cast<char>('0' + v % 10);
+		v /= 10;
+	} while (v != 0);
+	if (n < 0){ digits[--i] = '-'; }
+	put(digits + i, MAX_INT_CHARS - i);
+	return *this;
+}
+
+void UnparseWriter::indent(int indent){
+	size_t left = indent < 0 ? 0 : static_cast<size_t>(indent);
+	while (left > 0){
+		size_t n = left < NUM_TABS ? left : NUM_TABS;
+		put(TABS, n);
+		left -= n;
+	}
+}
+
+} //End namespace cminusminus
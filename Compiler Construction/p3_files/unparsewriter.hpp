@@ -0,0 +1,69 @@
+#ifndef CMINUSMINUS_UNPARSEWRITER_HPP
+#define CMINUSMINUS_UNPARSEWRITER_HPP
+
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace cminusminus{
+
+/**
+* \class UnparseWriter
+* Where unparse output goes. Each piece is copied straight into a
+* byte buffer (no formatted ostream calls, no temporaries), and
+* the buffer goes out in large blocks with write(2) to a file
+* descriptor or, for output that is not a file (-u --, or the
+* compile server), with one ostream::write per block.
+**/
+class UnparseWriter{
+public:
+	/** Writes to fd, which stays open when the writer is done **/
+	explicit UnparseWriter(int fdIn, size_t capacity = 1 << 20);
+	explicit UnparseWriter(std::ostream& outIn, size_t capacity = 1 << 20);
+	~UnparseWriter();
+	UnparseWriter(const UnparseWriter&) = delete;
+	UnparseWriter& operator=(const UnparseWriter&) = delete;
+
+	UnparseWriter& operator<<(char c){
+		reserve(1);
+		myBuf[myLen++] = c;
+		return *this;
+	}
+	UnparseWriter& operator<<(const char * s){
+		put(s, std::strlen(s));
+		return *this;
+	}
+	UnparseWriter& operator<<(const std::string& s){
+		put(s.data(), s.size());
+		return *this;
+	}
+	UnparseWriter& operator<<(int n);
+	void put(const char * s, size_t n){
+		reserve(n);
+		std::memcpy(&myBuf[myLen], s, n);
+		myLen += n;
+	}
+	/** indent tabs **/
+	void indent(int indent);
+
+	/** Write out everything so far. Returns false if any write
+	 * to the output has failed **/
+	bool flush();
+
+private:
+	void reserve(size_t n){
+		if (myLen + n > myBuf.size()){ grow(n); }
+	}
+	void grow(size_t n);
+
+	int myFd;
+	std::ostream * myOut;
+	std::vector<char> myBuf;
+	size_t myLen;
+	bool myFailed;
+};
+
+} //End namespace cminusminus
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef CMINUSMINUS_WORKPOOL_HPP
+#define CMINUSMINUS_WORKPOOL_HPP
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace cminusminus{
+
+/** Call work(i) for every i below count, on up to jobs threads
+ * (the calling thread included). Each thread takes the next
+ * unclaimed index as soon as it is free, so indices start in
+ * increasing order and a slow item never holds up the rest **/
+template <typename Work>
+void forEachIndex(size_t count, unsigned jobs, Work work){
+	std::atomic<size_t> next(0);
+	auto worker = [&](){
+		for (size_t i = next++; i < count; i = next++){ work(i); }
+	};
+	std::vector<std::thread> threads;
+	for (size_t t = 1; t < jobs && t < count; t++){
+		threads.emplace_back(worker);
+	}
+	worker();
+	for (auto& thread : threads){ thread.join(); }
+}
+
+} //End namespace cminusminus
+
+#endif
@@ -0,0 +1,581 @@
+#include <climits>
+#include "errors.hpp"
+#include "x64.hpp"
+
+namespace cminusminus{
+
+enum X64Reg { RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+  R8, R9, R10, R11, R12, R13, R14, R15 };
+
+static const char * const REG64[] = {
+	"%rax", "%rcx", "%rdx", "%rbx", "%rsp", "%rbp", "%rsi", "%rdi",
+	"%r8", "%r9", "%r10", "%r11", "%r12", "%r13", "%r14", "%r15"
+};
+static const char * const REG32[] = {
+	"%eax", "%ecx", "%edx", "%ebx", "%esp", "%ebp", "%esi", "%edi",
+	"%r8d", "%r9d", "%r10d", "%r11d", "%r12d", "%r13d", "%r14d", "%r15d"
+};
+static const char * const REG16[] = {
+	"%ax", "%cx", "%dx", "%bx", "%sp", "%bp", "%si", "%di",
+	"%r8w", "%r9w", "%r10w", "%r11w", "%r12w", "%r13w", "%r14w", "%r15w"
+};
+static const char * const REG8[] = {
+	"%al", "%cl", "%dl", "%bl", "%spl", "%bpl", "%sil", "%dil",
+	"%r8b", "%r9b", "%r10b", "%r11b", "%r12b", "%r13b", "%r14b", "%r15b"
+};
+
+/* Where the first six actuals go; the rest go on the stack */
+static const std::vector<uint8_t> ARG_REGS = { RDI, RSI, RDX, RCX, R8, R9 };
+static const uint32_t REG_ARGS = 6;
+
+/* The registers RegAlloc hands out. rbp is the frame pointer;
+   rax, rcx, rdx and r11 are scratch */
+static const std::vector<uint8_t> PRESERVED = { RBX, R12, R13, R14, R15 };
+static const std::vector<uint8_t> CLOBBERED = { RSI, RDI, R8, R9, R10 };
+
+/* Condition codes for IR_EQ to IR_GE, and their opposites */
+static const char * const CONDS[] = { "e", "ne", "l", "le", "g", "ge" };
+static const char * const NOT_CONDS[] = { "ne", "e", "ge", "g", "le", "l" };
+
+static const char * regName(int r, uint8_t size){
+	switch (size){
+	case 1: return REG8[r];
+	case 2: return REG16[r];
+	case 4: return REG32[r];
+	default: return REG64[r];
+	}
+}
+
+static char suffix(uint8_t size){
+	switch (size){
+	case 1: return 'b';
+	case 2: return 'w';
+	case 4: return 'l';
+	default: return 'q';
+	}
+}
+
+static bool fitsImm32(long value){
+	return value >= INT_MIN && value <= INT_MAX;
+}
+
+X64Writer::X64Writer(const IRProgram& progIn, std::ostream& outIn)
+: myProg(progIn), myOut(outIn), myAlloc(PRESERVED, CLOBBERED, ARG_REGS),
+  myFn(nullptr), myFnIndex(0), myBlock(0), mySlotBase(0), mySpillBase(0){ }
+
+void X64Writer::line(const std::string& text){
+	myText += '\t';
+	myText += text;
+	myText += '\n';
+}
+
+std::string X64Writer::label(uint32_t block) const{
+	return ".L" + std::to_string(myFnIndex) + "_" + std::to_string(block);
+}
+
+int X64Writer::reg(Opd opd) const{
+	if (!opd.isVReg()){ return -1; }
+	return myAlloc.reg(opd.index());
+}
+
+std::string X64Writer::mem(Opd opd) const{
+	int32_t offset;
+	switch (opd.kind()){
+	case Opd::GLOBAL:
+		return myProg.globals[opd.index()].name.str() + "(%rip)";
+	case Opd::SLOT:
+		offset = mySlotBase + 8 * static_cast<int32_t>(opd.index() + 1);
+		break;
+	case Opd::VREG:
+		offset = mySpillBase
+		  + 8 * static_cast<int32_t>(myAlloc.spillSlot(opd.index()) + 1);
+		break;
+	default:
+		throw new InternalError("Operand is not in memory");
+	}
+	return std::to_string(-offset) + "(%rbp)";
+}
+
+uint8_t X64Writer::memSize(Opd opd) const{
+	switch (opd.kind()){
+	case Opd::GLOBAL: return myProg.globals[opd.index()].size;
+	case Opd::SLOT: return myFn->slots[opd.index()].size;
+	default: return 8;
+	}
+}
+
+std::string X64Writer::operand64(Opd opd) const{
+	switch (opd.kind()){
+	case Opd::VREG:
+		if (reg(opd) >= 0){ return REG64[reg(opd)]; }
+		return mem(opd);
+	case Opd::IMM: {
+		long value = myProg.imms[opd.index()];
+		return fitsImm32(value) ? "$" + std::to_string(value) : "";
+	}
+	case Opd::GLOBAL: case Opd::SLOT:
+		return memSize(opd) == 8 ? mem(opd) : "";
+	default:
+		return "";
+	}
+}
+
+void X64Writer::load(Opd opd, int r){
+	std::string to = std::string(", ") + REG64[r];
+	switch (opd.kind()){
+	case Opd::VREG:
+		if (reg(opd) == r){ return; }
+		line("movq " + operand64(opd) + to);
+		return;
+	case Opd::IMM: {
+		long value = myProg.imms[opd.index()];
+		line((fitsImm32(value) ? "movq $" : "movabsq $")
+		  + std::to_string(value) + to);
+		return;
+	}
+	case Opd::GLOBAL: case Opd::SLOT:
+		switch (memSize(opd)){
+		case 1: line("movzbq " + mem(opd) + to); return;
+		case 2: line("movswq " + mem(opd) + to); return;
+		case 4: line("movslq " + mem(opd) + to); return;
+		default: line("movq " + mem(opd) + to); return;
+		}
+	case Opd::STR:
+		line("leaq .Ls" + std::to_string(opd.index()) + "(%rip)" + to);
+		return;
+	default:
+		throw new InternalError("Operand has no value to load");
+	}
+}
+
+void X64Writer::store(int r, Opd dst){
+	if (dst.isNone()){ return; }
+	if (reg(dst) >= 0){
+		if (reg(dst) != r){
+			line(std::string("movq ") + REG64[r] + ", " + REG64[reg(dst)]);
+		}
+		return;
+	}
+	uint8_t size = memSize(dst);
+	line(std::string("mov") + suffix(size) + " " + regName(r, size) + ", "
+	  + mem(dst));
+}
+
+void X64Writer::wrap(int r, uint8_t size){
+	switch (size){
+	case 2: line(std::string("movswq ") + REG16[r] + ", " + REG64[r]); return;
+	case 4: line(std::string("movslq ") + REG32[r] + ", " + REG64[r]); return;
+	default: return;
+	}
+}
+
+int X64Writer::target(Opd dst, Opd avoid) const{
+	int r = reg(dst);
+	return r >= 0 && r != reg(avoid) ? r : RAX;
+}
+
+void X64Writer::write(){
+	myText = "\t.text\n";
+	for (uint32_t f = 0; f < myProg.functions.size(); f++){
+		function(myProg.functions[f], f);
+		//Keep the text from growing with the program
+		if (myText.size() > 65536){
+			myOut << myText;
+			myText.clear();
+		}
+	}
+	if (!myProg.globals.empty()){
+		myText += "\t.bss\n";
+		for (const IRGlobal& global : myProg.globals){
+			std::string size = std::to_string(static_cast<unsigned>(global.size));
+			line(".align " + size);
+			myText += global.name.str() + ":\n";
+			line(".zero " + size);
+		}
+	}
+	if (!myProg.strings.empty()){
+		myText += "\t.section .rodata\n";
+		for (size_t i = 0; i < myProg.strings.size(); i++){
+			//C-- escapes (\n, \t, \" and \\) are also the
+			// assembler's
+			myText += ".Ls" + std::to_string(i) + ":\n";
+			line(".asciz " + *myProg.strings[i]);
+		}
+	}
+	line(".section .note.GNU-stack,\"\",@progbits");
+	myOut << myText;
+	myText.clear();
+}
+
+void X64Writer::function(const IRFunction& fn, uint32_t index){
+	myFn = &fn;
+	myFnIndex = index;
+	myAlloc.allocate(fn);
+
+	myReads.assign(fn.vregs.size(), 0);
+	myTargets.assign(fn.blocks.size(), false);
+	for (const Instr& ins : fn.code){
+		if (ins.a.isVReg()){ myReads[ins.a.index()]++; }
+		if (ins.b.isVReg()){ myReads[ins.b.index()]++; }
+		if (ins.op == IR_JMP || ins.op == IR_JZ || ins.op == IR_JNZ){
+			myTargets[ins.b.index()] = true;
+		}
+	}
+
+	//The frame, down from rbp: the preserved registers used,
+	// then the stack slots, then the spills, 8 bytes each and
+	// rounded up to keep rsp 16-byte aligned
+	std::vector<int> saved;
+	for (uint8_t r : PRESERVED){
+		if (myAlloc.preservedUsed() & (1u << r)){ saved.push_back(r); }
+	}
+	mySlotBase = 8 * static_cast<int32_t>(saved.size());
+	mySpillBase = mySlotBase + 8 * static_cast<int32_t>(fn.slots.size());
+	int32_t frame = 8 * static_cast<int32_t>(fn.slots.size()
+	  + myAlloc.spillCount());
+	if ((mySlotBase + frame) % 16 != 0){ frame += 8; }
+
+	std::string name = fn.name.str();
+	line(".globl " + name);
+	line(".type " + name + ", @function");
+	myText += name + ":\n";
+	line("pushq %rbp");
+	line("movq %rsp, %rbp");
+	for (int r : saved){ line(std::string("pushq ") + REG64[r]); }
+	if (frame > 0){ line("subq $" + std::to_string(frame) + ", %rsp"); }
+
+	for (myBlock = 0; myBlock < fn.blocks.size(); myBlock++){
+		const BasicBlock& block = fn.blocks[myBlock];
+		if (myTargets[myBlock]){ myText += label(myBlock) + ":\n"; }
+		uint32_t i = block.first;
+		while (i < block.end){ i = instr(i); }
+	}
+
+	myText += ".L" + std::to_string(index) + "_ret:\n";
+	if (frame > 0){
+		line("leaq " + std::to_string(-mySlotBase) + "(%rbp), %rsp");
+	}
+	for (size_t k = saved.size(); k > 0; k--){
+		line(std::string("popq ") + REG64[saved[k - 1]]);
+	}
+	line("popq %rbp");
+	line("ret");
+	line(".size " + name + ", .-" + name);
+	myFn = nullptr;
+}
+
+void X64Writer::jump(uint32_t block){
+	//The next block follows anyway
+	if (block != myBlock + 1){ line("jmp " + label(block)); }
+}
+
+uint32_t X64Writer::instr(uint32_t i){
+	const Instr& ins = myFn->code[i];
+	switch (ins.op){
+	case IR_MOV: {
+		int r = reg(ins.dst);
+		if (r >= 0){
+			load(ins.a, r);
+		} else if (ins.a.kind() == Opd::IMM
+		  && fitsImm32(myProg.imms[ins.a.index()])){
+			uint8_t size = memSize(ins.dst);
+			line(std::string("mov") + suffix(size) + " $"
+			  + std::to_string(myProg.imms[ins.a.index()]) + ", "
+			  + mem(ins.dst));
+		} else if (reg(ins.a) >= 0){
+			store(reg(ins.a), ins.dst);
+		} else {
+			load(ins.a, RAX);
+			store(RAX, ins.dst);
+		}
+		break;
+	}
+	case IR_ADD: case IR_SUB: case IR_MUL: case IR_DIV:
+	case IR_NEG: case IR_NOT:
+		binary(ins);
+		break;
+	case IR_EQ: case IR_NE: case IR_LT: case IR_LE: case IR_GT: case IR_GE: {
+		//A comparison only a following branch reads is the
+		// branch's flags, and is never put in a register
+		const BasicBlock& block = myFn->blocks[myBlock];
+		if (i + 1 < block.end && ins.dst.isVReg()
+		  && myReads[ins.dst.index()] == 1){
+			const Instr& next = myFn->code[i + 1];
+			if ((next.op == IR_JZ || next.op == IR_JNZ) && next.a == ins.dst){
+				compare(ins, &next);
+				return i + 2;
+			}
+		}
+		compare(ins, nullptr);
+		break;
+	}
+	case IR_ADDR: {
+		int t = target(ins.dst);
+		line("leaq " + mem(ins.a) + ", " + REG64[t]);
+		store(t, ins.dst);
+		break;
+	}
+	case IR_LOAD: {
+		int p = reg(ins.a);
+		if (p < 0){ load(ins.a, RAX); p = RAX; }
+		int t = target(ins.dst);
+		std::string from = std::string("(") + REG64[p] + "), " + REG64[t];
+		switch (ins.size){
+		case 1: line("movzbq " + from); break;
+		case 2: line("movswq " + from); break;
+		case 4: line("movslq " + from); break;
+		default: line("movq " + from);
+		}
+		store(t, ins.dst);
+		break;
+	}
+	case IR_STORE: {
+		int p = reg(ins.a);
+		if (p < 0){ load(ins.a, RAX); p = RAX; }
+		std::string to = std::string(", (") + REG64[p] + ")";
+		std::string mov = std::string("mov") + suffix(ins.size) + " ";
+		if (ins.b.kind() == Opd::IMM && fitsImm32(myProg.imms[ins.b.index()])){
+			line(mov + "$" + std::to_string(myProg.imms[ins.b.index()]) + to);
+		} else {
+			int v = reg(ins.b);
+			if (v < 0){ load(ins.b, RCX); v = RCX; }
+			line(mov + regName(v, ins.size) + to);
+		}
+		break;
+	}
+	case IR_JMP:
+		jump(ins.b.index());
+		break;
+	case IR_JZ: case IR_JNZ:
+		branch(ins);
+		break;
+	case IR_PARAM: {
+		uint32_t count = 0;
+		while (i + count < myFn->blocks[myBlock].end
+		  && myFn->code[i + count].op == IR_PARAM){
+			count++;
+		}
+		params(count);
+		return i + count;
+	}
+	case IR_ARG:
+		if (myArgs.size() <= ins.aux){ myArgs.resize(ins.aux + 1u); }
+		myArgs[ins.aux] = ins.a;
+		break;
+	case IR_CALL:
+		call(ins);
+		break;
+	case IR_RET:
+		if (!ins.a.isNone()){
+			load(ins.a, RAX);
+		} else if (myFn->name.str() == "main"){
+			//main's value is the exit status
+			line("xorl %eax, %eax");
+		}
+		if (i + 1 < myFn->code.size()){
+			line("jmp .L" + std::to_string(myFnIndex) + "_ret");
+		}
+		break;
+	case IR_READ:
+		if (ins.aux == IO_STRING){
+			line("call _cmm_read_string");
+		} else {
+			line("call _cmm_read_int");
+			if (ins.aux == IO_BOOL){
+				line("testq %rax, %rax");
+				line("setne %al");
+				line("movzbq %al, %rax");
+			} else {
+				wrap(RAX, ins.size);
+			}
+		}
+		store(RAX, ins.dst);
+		break;
+	case IR_WRITE:
+		load(ins.a, RDI);
+		line(ins.aux == IO_STRING ? "call _cmm_write_string"
+		  : "call _cmm_write_int");
+		break;
+	default:
+		throw new InternalError("Unknown IR operation");
+	}
+	return i + 1;
+}
+
+void X64Writer::binary(const Instr& ins){
+	static const char * const OPS[] = { "addq ", "subq ", "imulq " };
+	if (ins.op == IR_DIV){
+		load(ins.a, RAX);
+		std::string divisor = operand64(ins.b);
+		if (divisor.empty() || divisor[0] == '$'){
+			load(ins.b, RCX);
+			divisor = "%rcx";
+		}
+		line("cqto");
+		line("idivq " + divisor);
+		wrap(RAX, ins.size);
+		store(RAX, ins.dst);
+		return;
+	}
+	if (ins.op == IR_NEG || ins.op == IR_NOT){
+		int t = target(ins.dst);
+		load(ins.a, t);
+		line((ins.op == IR_NEG ? "negq " : "xorq $1, ") + std::string(REG64[t]));
+		wrap(t, ins.size);
+		store(t, ins.dst);
+		return;
+	}
+	Opd a = ins.a;
+	Opd b = ins.b;
+	//Work in dst's own register where b is not in it
+	if (ins.op != IR_SUB && reg(ins.dst) >= 0 && reg(ins.dst) == reg(b)){
+		std::swap(a, b);
+	}
+	int t = target(ins.dst, b);
+	load(a, t);
+	std::string src = operand64(b);
+	if (src.empty()){
+		load(b, RCX);
+		src = "%rcx";
+	}
+	line(OPS[ins.op - IR_ADD] + src + ", " + REG64[t]);
+	wrap(t, ins.size);
+	store(t, ins.dst);
+}
+
+void X64Writer::compare(const Instr& ins, const Instr * branch){
+	int lhs = reg(ins.a);
+	if (lhs < 0){
+		load(ins.a, RAX);
+		lhs = RAX;
+	}
+	std::string rhs = operand64(ins.b);
+	if (rhs.empty()){
+		load(ins.b, RCX);
+		rhs = "%rcx";
+	}
+	line("cmpq " + rhs + ", " + REG64[lhs]);
+	size_t cond = static_cast<size_t>(ins.op - IR_EQ);
+	if (branch != nullptr){
+		const char * cc = branch->op == IR_JZ ? NOT_CONDS[cond] : CONDS[cond];
+		line(std::string("j") + cc + " " + label(branch->b.index()));
+		return;
+	}
+	int t = target(ins.dst);
+	line(std::string("set") + CONDS[cond] + " %al");
+	line(std::string("movzbq %al, ") + REG64[t]);
+	store(t, ins.dst);
+}
+
+void X64Writer::branch(const Instr& ins){
+	bool ifTrue = ins.op == IR_JNZ;
+	if (ins.a.kind() == Opd::IMM){
+		if ((myProg.imms[ins.a.index()] != 0) == ifTrue){
+			line("jmp " + label(ins.b.index()));
+		}
+		return;
+	}
+	int r = reg(ins.a);
+	if (r >= 0){
+		line(std::string("testq ") + REG64[r] + ", " + REG64[r]);
+	} else {
+		line(std::string("cmp") + suffix(memSize(ins.a)) + " $0, " + mem(ins.a));
+	}
+	line((ifTrue ? "jne " : "je ") + label(ins.b.index()));
+}
+
+void X64Writer::params(uint32_t count){
+	//Formals kept in memory first, and then those in registers,
+	// which may be in each other's argument registers, all at
+	// once. Both only read the argument registers
+	myMoves.clear();
+	for (uint32_t k = 0; k < count && k < REG_ARGS; k++){
+		const Instr& param = myFn->code[k];
+		int from = ARG_REGS[param.aux];
+		if (reg(param.dst) >= 0){
+			myMoves.push_back({reg(param.dst), from, Opd()});
+		} else {
+			store(from, param.dst);
+		}
+	}
+	parallelMove(myMoves);
+	//The rest were pushed by the caller, last first, above the
+	// return address and the saved rbp
+	for (uint32_t k = REG_ARGS; k < count; k++){
+		const Instr& param = myFn->code[k];
+		std::string from = std::to_string(16 + 8 * (param.aux - REG_ARGS))
+		  + "(%rbp)";
+		int t = target(param.dst);
+		line("movq " + from + ", " + REG64[t]);
+		store(t, param.dst);
+	}
+}
+
+void X64Writer::parallelMove(std::vector<Move>& moves){
+	size_t kept = 0;
+	for (const Move& move : moves){
+		if (move.src != move.dst){ moves[kept++] = move; }
+	}
+	moves.resize(kept);
+	while (!moves.empty()){
+		//Any register nothing still has to read can be set
+		size_t ready = 0;
+		for (; ready < moves.size(); ready++){
+			bool read = false;
+			for (const Move& other : moves){
+				read = read || other.src == moves[ready].dst;
+			}
+			if (!read){ break; }
+		}
+		if (ready == moves.size()){
+			//Every register left to set is still to be read: a
+			// cycle, broken by parking one of them in rax (which
+			// is never set here, so the moves from it are ready)
+			int parked = moves[0].dst;
+			line(std::string("movq ") + REG64[parked] + ", %rax");
+			for (Move& move : moves){
+				if (move.src == parked){ move.src = RAX; }
+			}
+			continue;
+		}
+		const Move& move = moves[ready];
+		if (move.src >= 0){
+			line(std::string("movq ") + REG64[move.src] + ", "
+			  + REG64[move.dst]);
+		} else {
+			load(move.opd, move.dst);
+		}
+		moves.erase(moves.begin() + static_cast<std::ptrdiff_t>(ready));
+	}
+}
+
+void X64Writer::call(const Instr& ins){
+	uint32_t actuals = ins.aux;
+	uint32_t onStack = actuals > REG_ARGS ? actuals - REG_ARGS : 0;
+	//rsp is 16-byte aligned at every call
+	uint32_t pad = onStack % 2;
+	if (pad != 0){ line("subq $8, %rsp"); }
+	for (uint32_t k = actuals; k > REG_ARGS; k--){
+		Opd actual = myArgs[k - 1];
+		std::string src = operand64(actual);
+		if (src.empty()){
+			load(actual, RAX);
+			src = "%rax";
+		}
+		line("pushq " + src);
+	}
+	myMoves.clear();
+	for (uint32_t k = 0; k < actuals && k < REG_ARGS; k++){
+		Opd actual = myArgs[k];
+		myMoves.push_back({ARG_REGS[k], reg(actual), actual});
+	}
+	parallelMove(myMoves);
+	line("call " + myProg.functions[ins.a.index()].name.str());
+	if (onStack != 0){
+		line("addq $" + std::to_string(8 * (onStack + pad)) + ", %rsp");
+	}
+	store(RAX, ins.dst);
+	myArgs.clear();
+}
+
+} //End namespace cminusminus
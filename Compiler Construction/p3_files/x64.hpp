@@ -0,0 +1,104 @@
+#ifndef CMINUSMINUS_X64_HPP
+#define CMINUSMINUS_X64_HPP
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "ir.hpp"
+#include "regalloc.hpp"
+
+namespace cminusminus{
+
+/**
+* \class X64Writer
+* Writes an IRProgram as x86-64 assembly for the GNU assembler
+* (AT&T syntax), calling functions the System V way. Each
+* function's vregs go where RegAlloc puts them: in rbx and r12 to
+* r15 (which calls preserve), in rsi, rdi and r8 to r10 (which
+* they do not), or in the function's frame. rax, rcx, rdx and
+* r11 are never handed out, and hold values only within one
+* instruction.
+*
+* A value in a register is kept sign-extended to 64 bits (a bool
+* is 0 or 1); in memory it takes the size of its type. Arithmetic
+* is done on the whole register and the result cut back to its
+* type, so an int wraps at 32 bits and a short at 16. read and
+* write call the runtime (runtime/cmmrt.s), which also holds the
+* _start that calls main.
+**/
+class X64Writer{
+public:
+	X64Writer(const IRProgram& progIn, std::ostream& outIn);
+	void write();
+
+private:
+	/* Where an operand's value can be found, as an AT&T operand
+	   that 64-bit instructions can take, or "" if it first has
+	   to be loaded (see load()) */
+	std::string operand64(Opd opd) const;
+	/* The address of a GLOBAL or SLOT variable, or of the frame
+	   slot of a spilled vreg */
+	std::string mem(Opd opd) const;
+	/* The size in bytes of what mem(opd) holds */
+	uint8_t memSize(Opd opd) const;
+	/* The register opd is in, or -1 */
+	int reg(Opd opd) const;
+
+	void load(Opd opd, int r);
+	void store(int r, Opd dst);
+	/* Sign-extend the low size bytes of register r over the rest,
+	   so that a short or int result wraps at its own width */
+	void wrap(int r, uint8_t size);
+	/* The register to work out dst's value in: its own, if it
+	   has one that none of avoid holds, otherwise rax */
+	int target(Opd dst, Opd avoid = Opd()) const;
+
+	void function(const IRFunction& fn, uint32_t index);
+	/* Emit fn.code[i]; returns the index of the next instruction
+	   to emit (past any that this one took care of) */
+	uint32_t instr(uint32_t i);
+	void params(uint32_t count);
+	void call(const Instr& ins);
+	void binary(const Instr& ins);
+	void compare(const Instr& ins, const Instr * branch);
+	void branch(const Instr& ins);
+	void jump(uint32_t block);
+	/* One register to set in a parallelMove: from register src,
+	   or (when src is -1) from operand opd */
+	struct Move{
+		int dst;
+		int src;
+		Opd opd;
+	};
+	/* Make every move at once, so that each register gets what
+	   its source held before any of them was set */
+	void parallelMove(std::vector<Move>& moves);
+
+	std::string label(uint32_t block) const;
+	void line(const std::string& text);
+
+	const IRProgram& myProg;
+	std::ostream& myOut;
+	RegAlloc myAlloc;
+	std::string myText;
+
+	/* The function being written */
+	const IRFunction * myFn;
+	uint32_t myFnIndex;
+	uint32_t myBlock;
+	/* The offsets below rbp of the first stack slot and of the
+	   first spill */
+	int32_t mySlotBase;
+	int32_t mySpillBase;
+	/* How many times each vreg is read */
+	std::vector<uint32_t> myReads;
+	std::vector<bool> myTargets;
+	/* The actuals of the call being set up, by number */
+	std::vector<Opd> myArgs;
+	std::vector<Move> myMoves;
+};
+
+} //End namespace cminusminus
+
+#endif